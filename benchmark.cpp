@@ -0,0 +1,52 @@
+#include "benchmark.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+std::string formatNumber(double value, const char* format)
+{
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), format, value);
+    return buffer;
+}
+
+// Длина строки в символах (UTF-8)
+size_t textWidth(const std::string& text)
+{
+    size_t width = 0;
+    for (unsigned char c : text) {
+        if ((c & 0xC0) != 0x80) width++;
+    }
+    return width;
+}
+
+std::string pad(const std::string& text, size_t width)
+{
+    size_t current = textWidth(text);
+    return current >= width ? text : text + std::string(width - current, ' ');
+}
+
+} // namespace
+
+std::string formatBenchmarkResults(const std::vector<BenchmarkResult>& results)
+{
+    size_t nameWidth = textWidth("Вариант");
+    size_t paramsWidth = textWidth("Параметры");
+    for (const auto& r : results) {
+        nameWidth = std::max(nameWidth, textWidth(r.name));
+        paramsWidth = std::max(paramsWidth, textWidth(r.parameters));
+    }
+
+    std::string text = pad("Вариант", nameWidth) + "  " + pad("Параметры", paramsWidth) +
+                       "  " + pad("мс", 10) + "  Пропускная способность\n";
+    for (const auto& r : results) {
+        text += pad(r.name, nameWidth) + "  " + pad(r.parameters, paramsWidth) + "  " +
+                pad(formatNumber(r.milliseconds, "%.3f"), 10);
+        if (r.throughput > 0) {
+            text += "  " + formatNumber(r.throughput / 1e6, "%.2f") + " M " + r.unit + "/с";
+        }
+        text += "\n";
+    }
+    return text;
+}
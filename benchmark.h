@@ -0,0 +1,40 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Общая обвязка встроенных тестов производительности (без Qt)
+
+struct BenchmarkResult {
+    std::string name;        // Вариант алгоритма
+    std::string parameters;  // Параметры набора данных
+    double milliseconds;     // Среднее время одной итерации
+    double throughput;       // Элементов в секунду (0 - не измеряется)
+    std::string unit;        // Единица для throughput
+};
+
+// Среднее время одной итерации в миллисекундах: один прогрев,
+// затем повторы, пока не наберется minIterations и minTotalMs
+template <typename Body>
+double measureMilliseconds(Body&& body, int minIterations = 3, double minTotalMs = 100.0)
+{
+    using Clock = std::chrono::steady_clock;
+    body();
+
+    int iterations = 0;
+    double total = 0;
+    while (iterations < minIterations || total < minTotalMs) {
+        auto start = Clock::now();
+        body();
+        total += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        iterations++;
+    }
+    return total / iterations;
+}
+
+// Таблица результатов моноширинным текстом
+std::string formatBenchmarkResults(const std::vector<BenchmarkResult>& results);
+
+#endif // BENCHMARK_H
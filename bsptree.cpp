@@ -0,0 +1,268 @@
+#include "bsptree.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+namespace {
+
+const double planeEpsilon = 1e-7;
+
+struct Plane {
+    Point3D normal;
+    double d;
+};
+
+bool planeFromTriangle(const BspTriangle& t, Plane& plane)
+{
+    Point3D n = cross(t.v[1] - t.v[0], t.v[2] - t.v[0]);
+    double len = length(n);
+    if (len < 1e-12) return false;
+    plane.normal = n * (1.0 / len);
+    plane.d = -dot(plane.normal, t.v[0]);
+    return true;
+}
+
+// -1 - сзади, 0 - в плоскости, 1 - спереди, 2 - пересекает
+int classify(const BspTriangle& t, const Plane& plane, double dist[3])
+{
+    int front = 0, back = 0;
+    for (int k = 0; k < 3; k++) {
+        dist[k] = dot(plane.normal, t.v[k]) + plane.d;
+        if (dist[k] > planeEpsilon) front++;
+        else if (dist[k] < -planeEpsilon) back++;
+    }
+    if (front == 0 && back == 0) return 0;
+    if (back == 0) return 1;
+    if (front == 0) return -1;
+    return 2;
+}
+
+// Выбор плоскости разбиения. Кандидаты - плоскости нескольких треугольников
+// и осевые плоскости через медиану центров треугольников (такие плоскости
+// часто проходят между объектами без разрезов). Оценка по выборке:
+// штраф за разрез выше, чем за несбалансированность
+bool choosePlane(const std::vector<BspTriangle>& tris, Plane& best)
+{
+    const size_t sampleStep = std::max<size_t>(1, tris.size() / 256);
+
+    std::vector<Plane> candidates;
+    const size_t triangleCandidates = std::min<size_t>(tris.size(), 8);
+    for (size_t c = 0; c < triangleCandidates; c++) {
+        Plane plane;
+        if (planeFromTriangle(tris[c * tris.size() / triangleCandidates], plane)) {
+            candidates.push_back(plane);
+        }
+    }
+
+    if (tris.size() > 16) {
+        std::vector<double> centers;
+        for (int axis = 0; axis < 3; axis++) {
+            centers.clear();
+            for (size_t i = 0; i < tris.size(); i += sampleStep) {
+                const BspTriangle& t = tris[i];
+                Point3D c = (t.v[0] + t.v[1] + t.v[2]) * (1.0 / 3.0);
+                centers.push_back(axis == 0 ? c.x : axis == 1 ? c.y : c.z);
+            }
+            std::nth_element(centers.begin(), centers.begin() + centers.size() / 2, centers.end());
+            Plane plane;
+            plane.normal = Point3D(axis == 0, axis == 1, axis == 2);
+            plane.d = -centers[centers.size() / 2];
+            candidates.push_back(plane);
+        }
+    }
+
+    bool found = false;
+    long bestScore = 0;
+    double dist[3];
+
+    for (const Plane& plane : candidates) {
+        long front = 0, back = 0, splits = 0, onPlane = 0;
+        for (size_t i = 0; i < tris.size(); i += sampleStep) {
+            switch (classify(tris[i], plane, dist)) {
+            case 1: front++; break;
+            case -1: back++; break;
+            case 2: splits++; break;
+            default: onPlane++; break;
+            }
+        }
+        // Плоскость должна разделять множество, иначе построение не продвинется
+        if (onPlane == 0 && splits == 0 && (front == 0 || back == 0)) continue;
+
+        long score = splits * 16 + std::labs(front - back);
+        if (!found || score < bestScore) {
+            best = plane;
+            bestScore = score;
+            found = true;
+        }
+    }
+
+    if (!found) {
+        // Плоскость любого невырожденного треугольника гарантирует продвижение
+        for (const auto& t : tris) {
+            if (planeFromTriangle(t, best)) return true;
+        }
+    }
+    return found;
+}
+
+void emitPolygon(const Point3D* poly, int count, const BspTriangle& source,
+                 std::vector<BspTriangle>& out)
+{
+    for (int i = 1; i + 1 < count; i++) {
+        BspTriangle t = source;
+        t.v[0] = poly[0];
+        t.v[1] = poly[i];
+        t.v[2] = poly[i + 1];
+        out.push_back(t);
+    }
+}
+
+void splitTriangle(const BspTriangle& t, const double dist[3],
+                   std::vector<BspTriangle>& front, std::vector<BspTriangle>& back)
+{
+    Point3D frontPoly[4], backPoly[4];
+    int frontCount = 0, backCount = 0;
+
+    for (int i = 0; i < 3; i++) {
+        int j = (i + 1) % 3;
+        const Point3D& a = t.v[i];
+        const Point3D& b = t.v[j];
+        double da = dist[i], db = dist[j];
+
+        if (da >= -planeEpsilon) frontPoly[frontCount++] = a;
+        if (da <= planeEpsilon) backPoly[backCount++] = a;
+
+        // Ребро пересекает плоскость строго
+        if ((da > planeEpsilon && db < -planeEpsilon) || (da < -planeEpsilon && db > planeEpsilon)) {
+            double s = da / (da - db);
+            Point3D p = a + (b - a) * s;
+            frontPoly[frontCount++] = p;
+            backPoly[backCount++] = p;
+        }
+    }
+
+    emitPolygon(frontPoly, frontCount, t, front);
+    emitPolygon(backPoly, backCount, t, back);
+}
+
+} // namespace
+
+BspTree::BspTree()
+{
+}
+
+void BspTree::clear()
+{
+    nodes.clear();
+    triangles.clear();
+}
+
+bool BspTree::build(std::vector<BspTriangle> input, size_t maxTriangles)
+{
+    clear();
+
+    // Вырожденные треугольники не видны и не задают плоскость
+    Plane unused;
+    input.erase(std::remove_if(input.begin(), input.end(),
+                               [&](const BspTriangle& t) { return !planeFromTriangle(t, unused); }),
+                input.end());
+    if (input.empty()) return true;
+
+    // Общее число треугольников с учетом разрезов
+    size_t total = input.size();
+
+    struct BuildTask {
+        std::vector<BspTriangle> tris;
+        int node;
+    };
+
+    std::vector<BuildTask> stack;
+    nodes.push_back(Node());
+    stack.push_back({std::move(input), 0});
+
+    std::vector<BspTriangle> coplanar;
+    double dist[3];
+
+    while (!stack.empty()) {
+        BuildTask task = std::move(stack.back());
+        stack.pop_back();
+
+        Plane plane;
+        std::vector<BspTriangle> front, back;
+        coplanar.clear();
+
+        if (!choosePlane(task.tris, plane)) {
+            // Остались только вырожденные осколки разбиения: узел-лист
+            plane.normal = Point3D(0, 0, 1);
+            plane.d = 0;
+            coplanar.swap(task.tris);
+        }
+
+        for (const auto& t : task.tris) {
+            switch (classify(t, plane, dist)) {
+            case 0: coplanar.push_back(t); break;
+            case 1: front.push_back(t); break;
+            case -1: back.push_back(t); break;
+            default: {
+                size_t before = front.size() + back.size();
+                splitTriangle(t, dist, front, back);
+                total += front.size() + back.size() - before - 1;
+                break;
+            }
+            }
+        }
+        if (total > maxTriangles) {
+            // Сильно пересекающиеся объекты: разрезы растут квадратично
+            clear();
+            return false;
+        }
+        task.tris.clear();
+        task.tris.shrink_to_fit();
+
+        Node& node = nodes[task.node];
+        node.normal = plane.normal;
+        node.d = plane.d;
+        node.first = triangles.size();
+        node.count = coplanar.size();
+        node.front = -1;
+        node.back = -1;
+        triangles.insert(triangles.end(), coplanar.begin(), coplanar.end());
+
+        // nodes может перераспределиться, поэтому дальше только индексы
+        if (!front.empty()) {
+            int index = int(nodes.size());
+            nodes.push_back(Node());
+            nodes[task.node].front = index;
+            stack.push_back({std::move(front), index});
+        }
+        if (!back.empty()) {
+            int index = int(nodes.size());
+            nodes.push_back(Node());
+            nodes[task.node].back = index;
+            stack.push_back({std::move(back), index});
+        }
+    }
+    return true;
+}
+
+std::vector<BspTriangle> makeBspTriangles(const Scene& scene)
+{
+    std::vector<BspTriangle> triangles;
+    triangles.reserve(scene.triangleCount());
+
+    for (const SceneObject& object : scene.objects) {
+        if (object.shape != SceneObject::MESH) continue;
+
+        const IndexedMesh& mesh = scene.meshes[object.mesh];
+        const Point3D& albedo = scene.materials[object.material].albedo;
+        BspTriangle t;
+        t.r = float(albedo.x);
+        t.g = float(albedo.y);
+        t.b = float(albedo.z);
+        for (size_t k = 0; k + 2 < mesh.indices.size(); k += 3) {
+            for (int j = 0; j < 3; j++) t.v[j] = object.transform.apply(mesh.vertices[mesh.indices[k + j]]);
+            triangles.push_back(t);
+        }
+    }
+    return triangles;
+}
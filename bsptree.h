@@ -0,0 +1,87 @@
+#ifndef BSPTREE_H
+#define BSPTREE_H
+
+#include "geometry.h"
+#include "scene.h"
+#include <utility>
+#include <vector>
+
+struct BspTriangle {
+    Point3D v[3];
+    float r, g, b;
+};
+
+// Треугольники сеточных объектов сцены в мировых координатах, цвет - из материала.
+// Аналитические примитивы (SPHERE, BOX) пропускаются
+std::vector<BspTriangle> makeBspTriangles(const Scene& scene);
+
+// BSP-дерево для статической сцены: строится один раз, после чего
+// треугольники выдаются в порядке от дальних к ближним для любого
+// направления взгляда, и буфер глубины не нужен (алгоритм художника)
+class BspTree
+{
+public:
+    BspTree();
+
+    // Возвращает false (и пустое дерево), если после разрезов
+    // треугольников стало больше maxTriangles
+    bool build(std::vector<BspTriangle> input, size_t maxTriangles = 1000000);
+    void clear();
+
+    bool isEmpty() const { return nodes.empty(); }
+    size_t nodeCount() const { return nodes.size(); }
+    // Треугольников после разбиения плоскостями узлов
+    size_t triangleCount() const { return triangles.size(); }
+
+    // viewDirection - направление взгляда ортографической камеры
+    // (см. ViewTransform::viewDirection); visit(const BspTriangle&)
+    template <typename Visit>
+    void traverseBackToFront(const Point3D& viewDirection, Visit&& visit) const;
+
+private:
+    struct Node {
+        Point3D normal;    // плоскость dot(normal, p) + d = 0
+        double d;
+        size_t first;      // треугольники, лежащие в плоскости узла
+        size_t count;
+        int front, back;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<BspTriangle> triangles;
+};
+
+template <typename Visit>
+void BspTree::traverseBackToFront(const Point3D& viewDirection, Visit&& visit) const
+{
+    if (nodes.empty()) return;
+
+    // Явный стек: (узел, выдать ли треугольники узла)
+    std::vector<std::pair<int, bool>> stack;
+    stack.push_back({0, false});
+
+    while (!stack.empty()) {
+        std::pair<int, bool> entry = stack.back();
+        stack.pop_back();
+        const Node& node = nodes[entry.first];
+
+        if (entry.second) {
+            for (size_t i = node.first; i < node.first + node.count; i++) {
+                visit(triangles[i]);
+            }
+            continue;
+        }
+
+        // Наблюдатель на бесконечности в направлении -viewDirection
+        const bool viewerInFront = dot(node.normal, viewDirection) < 0;
+        const int nearChild = viewerInFront ? node.front : node.back;
+        const int farChild = viewerInFront ? node.back : node.front;
+
+        // Снимаются со стека в обратном порядке: дальнее, узел, ближнее
+        if (nearChild >= 0) stack.push_back({nearChild, false});
+        stack.push_back({entry.first, true});
+        if (farChild >= 0) stack.push_back({farChild, false});
+    }
+}
+
+#endif // BSPTREE_H
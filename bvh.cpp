@@ -0,0 +1,378 @@
+#include "bvh.h"
+#include <algorithm>
+#include <cmath>
+
+void Aabb::expand(const Point3D& p)
+{
+    min = Point3D(std::min(min.x, p.x), std::min(min.y, p.y), std::min(min.z, p.z));
+    max = Point3D(std::max(max.x, p.x), std::max(max.y, p.y), std::max(max.z, p.z));
+}
+
+void Aabb::expand(const Aabb& b)
+{
+    // Пустой (например, пустая корзина SAH) не расширяет: его углы - ±1e300
+    if (b.min.x > b.max.x) return;
+    expand(b.min);
+    expand(b.max);
+}
+
+double Aabb::surfaceArea() const
+{
+    if (min.x > max.x) return 0;
+    Point3D e = max - min;
+    return 2.0 * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+RtPrimitive RtPrimitive::sphere(const Point3D& center, double radius, int material)
+{
+    RtPrimitive p;
+    p.type = SPHERE;
+    p.p0 = center;
+    p.radius = radius;
+    p.material = material;
+    return p;
+}
+
+RtPrimitive RtPrimitive::box(const Point3D& min, const Point3D& max, int material)
+{
+    RtPrimitive p;
+    p.type = BOX;
+    p.p0 = min;
+    p.p1 = max;
+    p.radius = 0;
+    p.material = material;
+    return p;
+}
+
+RtPrimitive RtPrimitive::triangle(const Point3D& a, const Point3D& b, const Point3D& c, int material)
+{
+    RtPrimitive p;
+    p.type = TRIANGLE;
+    p.p0 = a;
+    p.p1 = b;
+    p.p2 = c;
+    p.radius = 0;
+    p.material = material;
+    return p;
+}
+
+Aabb RtPrimitive::bounds() const
+{
+    Aabb box;
+    switch (type) {
+    case SPHERE:
+        box.expand(p0 - Point3D(radius, radius, radius));
+        box.expand(p0 + Point3D(radius, radius, radius));
+        break;
+    case BOX:
+        box.expand(p0);
+        box.expand(p1);
+        break;
+    case TRIANGLE:
+        box.expand(p0);
+        box.expand(p1);
+        box.expand(p2);
+        break;
+    }
+    return box;
+}
+
+bool intersectAabb(const Aabb& box, const RtRay& ray, double tMin, double tMax, double& tNear)
+{
+    double tx1 = (box.min.x - ray.origin.x) * ray.invDirection.x;
+    double tx2 = (box.max.x - ray.origin.x) * ray.invDirection.x;
+    double t0 = std::max(tMin, std::min(tx1, tx2));
+    double t1 = std::min(tMax, std::max(tx1, tx2));
+
+    double ty1 = (box.min.y - ray.origin.y) * ray.invDirection.y;
+    double ty2 = (box.max.y - ray.origin.y) * ray.invDirection.y;
+    t0 = std::max(t0, std::min(ty1, ty2));
+    t1 = std::min(t1, std::max(ty1, ty2));
+
+    double tz1 = (box.min.z - ray.origin.z) * ray.invDirection.z;
+    double tz2 = (box.max.z - ray.origin.z) * ray.invDirection.z;
+    t0 = std::max(t0, std::min(tz1, tz2));
+    t1 = std::min(t1, std::max(tz1, tz2));
+
+    tNear = t0;
+    return t0 <= t1;
+}
+
+bool intersectPrimitive(const RtPrimitive& prim, const RtRay& ray, double tMin, double tMax, RtHit& hit)
+{
+    switch (prim.type) {
+    case RtPrimitive::SPHERE: {
+        Point3D oc = ray.origin - prim.p0;
+        double b = dot(oc, ray.direction);
+        double c = dot(oc, oc) - prim.radius * prim.radius;
+        double disc = b * b - c;  // направление нормировано
+        if (disc < 0) return false;
+        double sq = std::sqrt(disc);
+        double t = -b - sq;
+        if (t <= tMin || t >= tMax) {
+            t = -b + sq;
+            if (t <= tMin || t >= tMax) return false;
+        }
+        hit.t = t;
+        hit.normal = (ray.origin + ray.direction * t - prim.p0) * (1.0 / prim.radius);
+        return true;
+    }
+    case RtPrimitive::BOX: {
+        Aabb box;
+        box.min = prim.p0;
+        box.max = prim.p1;
+        double tx1 = (box.min.x - ray.origin.x) * ray.invDirection.x;
+        double tx2 = (box.max.x - ray.origin.x) * ray.invDirection.x;
+        double ty1 = (box.min.y - ray.origin.y) * ray.invDirection.y;
+        double ty2 = (box.max.y - ray.origin.y) * ray.invDirection.y;
+        double tz1 = (box.min.z - ray.origin.z) * ray.invDirection.z;
+        double tz2 = (box.max.z - ray.origin.z) * ray.invDirection.z;
+        double tEnter = std::max({std::min(tx1, tx2), std::min(ty1, ty2), std::min(tz1, tz2)});
+        double tExit = std::min({std::max(tx1, tx2), std::max(ty1, ty2), std::max(tz1, tz2)});
+        if (tEnter > tExit) return false;
+        double t = tEnter > tMin ? tEnter : tExit;
+        if (t <= tMin || t >= tMax) return false;
+
+        // Нормаль - по грани, к которой точка ближе всего
+        Point3D p = ray.origin + ray.direction * t;
+        Point3D c = box.center();
+        Point3D h = (box.max - box.min) * 0.5;
+        Point3D d((p.x - c.x) / h.x, (p.y - c.y) / h.y, (p.z - c.z) / h.z);
+        double ax = std::fabs(d.x), ay = std::fabs(d.y), az = std::fabs(d.z);
+        if (ax >= ay && ax >= az) hit.normal = Point3D(d.x > 0 ? 1 : -1, 0, 0);
+        else if (ay >= az) hit.normal = Point3D(0, d.y > 0 ? 1 : -1, 0);
+        else hit.normal = Point3D(0, 0, d.z > 0 ? 1 : -1);
+        hit.t = t;
+        return true;
+    }
+    case RtPrimitive::TRIANGLE: {
+        // Мёллер - Трумбор
+        Point3D e1 = prim.p1 - prim.p0;
+        Point3D e2 = prim.p2 - prim.p0;
+        Point3D pv = cross(ray.direction, e2);
+        double det = dot(e1, pv);
+        if (std::fabs(det) < 1e-12) return false;
+        double invDet = 1.0 / det;
+        Point3D tv = ray.origin - prim.p0;
+        double u = dot(tv, pv) * invDet;
+        if (u < 0 || u > 1) return false;
+        Point3D qv = cross(tv, e1);
+        double v = dot(ray.direction, qv) * invDet;
+        if (v < 0 || u + v > 1) return false;
+        double t = dot(e2, qv) * invDet;
+        if (t <= tMin || t >= tMax) return false;
+        hit.t = t;
+        hit.normal = normalize(cross(e1, e2));
+        return true;
+    }
+    }
+    return false;
+}
+
+void Bvh::build(const std::vector<RtPrimitive>& input)
+{
+    prims = input;
+    nodes.clear();
+    if (prims.empty()) return;
+
+    std::vector<Point3D> centroids(prims.size());
+    std::vector<Aabb> boxes(prims.size());
+    for (size_t i = 0; i < prims.size(); i++) {
+        boxes[i] = prims[i].bounds();
+        centroids[i] = boxes[i].center();
+    }
+
+    nodes.reserve(prims.size() * 2);
+    Node root;
+    root.leftFirst = 0;
+    root.count = int(prims.size());
+    nodes.push_back(root);
+    subdivide(0, centroids, boxes);
+}
+
+void Bvh::subdivide(int rootIndex, std::vector<Point3D>& centroids, std::vector<Aabb>& boxes)
+{
+    const int binCount = 12;
+    struct Pending {
+        int node, depth;
+    };
+    std::vector<Pending> stack = {{rootIndex, 0}};
+
+    while (!stack.empty()) {
+        const int nodeIndex = stack.back().node;
+        const int depth = stack.back().depth;
+        stack.pop_back();
+
+        Node& node = nodes[nodeIndex];
+        const int first = node.leftFirst;
+        const int count = node.count;
+
+        Aabb bounds, centroidBounds;
+        for (int i = first; i < first + count; i++) {
+            bounds.expand(boxes[i]);
+            centroidBounds.expand(centroids[i]);
+        }
+        node.bounds = bounds;
+        if (count <= 2 || depth >= maxDepth) continue;
+
+        // Лучшее разбиение по SAH среди корзин по всем трем осям
+        double bestCost = count * bounds.surfaceArea();
+        int bestAxis = -1;
+        double bestSplit = 0;
+
+        for (int axis = 0; axis < 3; axis++) {
+            auto coord = [axis](const Point3D& p) { return axis == 0 ? p.x : axis == 1 ? p.y : p.z; };
+            double lo = coord(centroidBounds.min), hi = coord(centroidBounds.max);
+            if (hi - lo < 1e-12) continue;
+
+            Aabb binBounds[binCount];
+            int binCounts[binCount] = {};
+            double scale = binCount / (hi - lo);
+            for (int i = first; i < first + count; i++) {
+                int b = std::min(binCount - 1, int((coord(centroids[i]) - lo) * scale));
+                binCounts[b]++;
+                binBounds[b].expand(boxes[i]);
+            }
+
+            // Площади и количества слева и справа от каждой границы корзин
+            double leftArea[binCount - 1], rightArea[binCount - 1];
+            int leftCount[binCount - 1], rightCount[binCount - 1];
+            Aabb leftBox, rightBox;
+            int leftSum = 0, rightSum = 0;
+            for (int i = 0; i < binCount - 1; i++) {
+                leftSum += binCounts[i];
+                leftCount[i] = leftSum;
+                leftBox.expand(binBounds[i]);
+                leftArea[i] = leftBox.surfaceArea();
+
+                rightSum += binCounts[binCount - 1 - i];
+                rightCount[binCount - 2 - i] = rightSum;
+                rightBox.expand(binBounds[binCount - 1 - i]);
+                rightArea[binCount - 2 - i] = rightBox.surfaceArea();
+            }
+
+            for (int i = 0; i < binCount - 1; i++) {
+                if (leftCount[i] == 0 || rightCount[i] == 0) continue;
+                double cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = lo + (i + 1) / scale;
+                }
+            }
+        }
+
+        if (bestAxis < 0) continue;  // Лист дешевле любого разбиения
+
+        // Разделяем примитивы на месте
+        auto coord = [bestAxis](const Point3D& p) { return bestAxis == 0 ? p.x : bestAxis == 1 ? p.y : p.z; };
+        int i = first, j = first + count - 1;
+        while (i <= j) {
+            if (coord(centroids[i]) < bestSplit) {
+                i++;
+            } else {
+                std::swap(centroids[i], centroids[j]);
+                std::swap(boxes[i], boxes[j]);
+                std::swap(prims[i], prims[j]);
+                j--;
+            }
+        }
+        int leftCount = i - first;
+        if (leftCount == 0 || leftCount == count) continue;
+
+        int leftIndex = int(nodes.size());
+        Node left, right;
+        left.leftFirst = first;
+        left.count = leftCount;
+        right.leftFirst = i;
+        right.count = count - leftCount;
+        nodes.push_back(left);
+        nodes.push_back(right);
+
+        // node мог стать недействительным после push_back
+        nodes[nodeIndex].leftFirst = leftIndex;
+        nodes[nodeIndex].count = 0;
+
+        stack.push_back({leftIndex, depth + 1});
+        stack.push_back({leftIndex + 1, depth + 1});
+    }
+}
+
+bool Bvh::intersect(const RtRay& ray, double tMin, double tMax, RtHit& hit) const
+{
+    if (nodes.empty()) return false;
+
+    bool found = false;
+    int stack[traversalStackSize];
+    int stackSize = 0;
+    double tNear;
+
+    if (!intersectAabb(nodes[0].bounds, ray, tMin, tMax, tNear)) return false;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const Node& node = nodes[stack[--stackSize]];
+
+        if (node.count > 0) {
+            for (int i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+                RtHit candidate;
+                if (intersectPrimitive(prims[i], ray, tMin, tMax, candidate)) {
+                    tMax = candidate.t;
+                    candidate.primitive = i;
+                    hit = candidate;
+                    found = true;
+                }
+            }
+            continue;
+        }
+
+        // Сначала ближний потомок: он снимается со стека первым
+        int left = node.leftFirst, right = node.leftFirst + 1;
+        double tLeft, tRight;
+        bool hitLeft = intersectAabb(nodes[left].bounds, ray, tMin, tMax, tLeft);
+        bool hitRight = intersectAabb(nodes[right].bounds, ray, tMin, tMax, tRight);
+        if (hitLeft && hitRight) {
+            if (tLeft > tRight) {
+                std::swap(left, right);
+            }
+            stack[stackSize++] = right;
+            stack[stackSize++] = left;
+        } else if (hitLeft) {
+            stack[stackSize++] = left;
+        } else if (hitRight) {
+            stack[stackSize++] = right;
+        }
+    }
+    return found;
+}
+
+int Bvh::occluded(const RtRay& ray, double tMin, double tMax) const
+{
+    if (nodes.empty()) return -1;
+
+    int stack[traversalStackSize];
+    int stackSize = 0;
+    double tNear;
+
+    if (!intersectAabb(nodes[0].bounds, ray, tMin, tMax, tNear)) return -1;
+    stack[stackSize++] = 0;
+
+    // Подойдет любое пересечение, поэтому потомки не сортируются по расстоянию
+    // и отрезок (tMin, tMax) не сужается
+    while (stackSize > 0) {
+        const Node& node = nodes[stack[--stackSize]];
+
+        if (node.count > 0) {
+            for (int i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+                RtHit candidate;
+                if (intersectPrimitive(prims[i], ray, tMin, tMax, candidate)) return i;
+            }
+            continue;
+        }
+
+        const int left = node.leftFirst, right = node.leftFirst + 1;
+        if (intersectAabb(nodes[right].bounds, ray, tMin, tMax, tNear)) stack[stackSize++] = right;
+        if (intersectAabb(nodes[left].bounds, ray, tMin, tMax, tNear)) stack[stackSize++] = left;
+    }
+    return -1;
+}
@@ -0,0 +1,92 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include "geometry.h"
+#include <vector>
+
+struct Aabb {
+    Point3D min, max;
+
+    Aabb() : min(1e300, 1e300, 1e300), max(-1e300, -1e300, -1e300) {}
+    void expand(const Point3D& p);
+    void expand(const Aabb& b);
+    double surfaceArea() const;
+    Point3D center() const { return (min + max) * 0.5; }
+};
+
+struct RtRay {
+    Point3D origin;
+    Point3D direction;
+    Point3D invDirection;
+
+    RtRay() {}
+    RtRay(const Point3D& o, const Point3D& d)
+        : origin(o), direction(d), invDirection(1.0 / d.x, 1.0 / d.y, 1.0 / d.z) {}
+};
+
+// Аналитические примитивы сцены трассировки лучей
+struct RtPrimitive {
+    enum Type { SPHERE, BOX, TRIANGLE };
+
+    Type type;
+    Point3D p0, p1, p2;  // SPHERE: p0 - центр; BOX: p0 - min, p1 - max; TRIANGLE: вершины
+    double radius;
+    int material;
+
+    static RtPrimitive sphere(const Point3D& center, double radius, int material);
+    static RtPrimitive box(const Point3D& min, const Point3D& max, int material);
+    // Нормаль треугольника - по правилу правой руки (p1 - p0) x (p2 - p0)
+    static RtPrimitive triangle(const Point3D& a, const Point3D& b, const Point3D& c, int material);
+
+    Aabb bounds() const;
+};
+
+struct RtHit {
+    double t;
+    Point3D normal;  // Внешняя геометрическая нормаль
+    int primitive;
+};
+
+// Пересечение с одним примитивом на отрезке (tMin, tMax)
+bool intersectPrimitive(const RtPrimitive& prim, const RtRay& ray, double tMin, double tMax, RtHit& hit);
+
+// BVH с разбиением по SAH на корзинах (binned SAH)
+class Bvh
+{
+public:
+    void build(const std::vector<RtPrimitive>& input);
+
+    // Ближайшее пересечение на отрезке (tMin, tMax)
+    bool intersect(const RtRay& ray, double tMin, double tMax, RtHit& hit) const;
+    // Есть ли хоть одно пересечение на (tMin, tMax): обход прекращается
+    // на первом найденном (теневые лучи). Возвращает примитив или -1
+    int occluded(const RtRay& ray, double tMin, double tMax) const;
+
+    // Узлы глубже maxDepth не делятся, даже если SAH выгоднее (например,
+    // много совпадающих центров): стек обхода - постоянного размера.
+    // Обход в глубину держит в стеке не больше глубины + 1 узлов
+    static const int maxDepth = 63;
+    static const int traversalStackSize = maxDepth + 1;
+
+    struct Node {
+        Aabb bounds;
+        int leftFirst;  // лист: первый примитив, иначе индекс левого потомка
+        int count;      // 0 - внутренний узел
+    };
+
+    const std::vector<RtPrimitive>& primitives() const { return prims; }
+    const std::vector<Node>& nodeList() const { return nodes; }
+    size_t nodeCount() const { return nodes.size(); }
+
+private:
+
+    void subdivide(int nodeIndex, std::vector<Point3D>& centroids, std::vector<Aabb>& boxes);
+
+    std::vector<Node> nodes;
+    std::vector<RtPrimitive> prims;  // Переупорядочены по листьям
+};
+
+// Пересечение луча с AABB методом плит; tNear - точка входа
+bool intersectAabb(const Aabb& box, const RtRay& ray, double tMin, double tMax, double& tNear);
+
+#endif // BVH_H
@@ -0,0 +1,101 @@
+#include "controlpointmodel.h"
+#include "geometry.h"
+#include <algorithm>
+
+namespace {
+
+double& coordinate(Point3D& point, int column)
+{
+    return column == 0 ? point.x : column == 1 ? point.y : point.z;
+}
+
+} // namespace
+
+ControlPointModel::ControlPointModel(QObject* parent)
+    : QAbstractTableModel(parent),
+    points(nullptr)
+{
+}
+
+void ControlPointModel::setPoints(std::vector<Point3D>* newPoints)
+{
+    beginResetModel();
+    points = newPoints;
+    endResetModel();
+}
+
+void ControlPointModel::pointsReset()
+{
+    beginResetModel();
+    endResetModel();
+}
+
+void ControlPointModel::pointsChanged(int first, int last)
+{
+    if (!points || points->empty()) return;
+    first = std::max(first, 0);
+    last = std::min(last, int(points->size()) - 1);
+    if (first > last) return;
+    // Вид перерисует только видимые из этих строк
+    emit dataChanged(index(first, 0), index(last, 2), {Qt::DisplayRole, Qt::EditRole});
+}
+
+int ControlPointModel::rowCount(const QModelIndex& parent) const
+{
+    return parent.isValid() || !points ? 0 : int(points->size());
+}
+
+int ControlPointModel::columnCount(const QModelIndex& parent) const
+{
+    return parent.isValid() ? 0 : 3;
+}
+
+QVariant ControlPointModel::data(const QModelIndex& index, int role) const
+{
+    if (!points || !index.isValid() || size_t(index.row()) >= points->size()) return QVariant();
+
+    const double value = coordinate((*points)[index.row()], index.column());
+    switch (role) {
+    case Qt::DisplayRole:
+        return QString::number(value, 'f', 2);
+    case Qt::EditRole:
+        // Редактор получает полную точность, а не округленный текст
+        return QString::number(value, 'g', 17);
+    case Qt::TextAlignmentRole:
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    default:
+        return QVariant();
+    }
+}
+
+bool ControlPointModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+    if (role != Qt::EditRole || !points || !index.isValid() || size_t(index.row()) >= points->size()) {
+        return false;
+    }
+
+    bool ok = false;
+    const double parsed = value.toDouble(&ok);
+    if (!ok) return false;
+
+    coordinate((*points)[index.row()], index.column()) = parsed;
+    emit dataChanged(index, index, {Qt::DisplayRole, Qt::EditRole});
+    emit coordinateEdited(index.row(), index.column());
+    return true;
+}
+
+Qt::ItemFlags ControlPointModel::flags(const QModelIndex& index) const
+{
+    if (!index.isValid()) return Qt::NoItemFlags;
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsEditable;
+}
+
+QVariant ControlPointModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (role != Qt::DisplayRole) return QVariant();
+    if (orientation == Qt::Horizontal) {
+        static const char* const names[] = {"X", "Y", "Z"};
+        return section >= 0 && section < 3 ? QVariant(names[section]) : QVariant();
+    }
+    return section + 1;
+}
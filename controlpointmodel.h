@@ -0,0 +1,40 @@
+#ifndef CONTROLPOINTMODEL_H
+#define CONTROLPOINTMODEL_H
+
+#include <QAbstractTableModel>
+#include <vector>
+
+struct Point3D;
+
+// Таблица X, Y, Z поверх массива контрольных точек без копии: строки не
+// хранятся, текст ячейки форматируется только когда вид ее рисует
+// (видимые строки), правка пишет число прямо в массив
+class ControlPointModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    explicit ControlPointModel(QObject* parent = nullptr);
+
+    // Массив принадлежит вызывающему и должен жить дольше модели
+    void setPoints(std::vector<Point3D>* points);
+    // Массив изменился вне модели: число точек или точки first..last
+    void pointsReset();
+    void pointsChanged(int first, int last);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+
+signals:
+    // Координата column (0 - X, 1 - Y, 2 - Z) точки row уже записана в массив
+    void coordinateEdited(int row, int column);
+
+private:
+    std::vector<Point3D>* points;
+};
+
+#endif // CONTROLPOINTMODEL_H
@@ -0,0 +1,97 @@
+#include "framebudget.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+struct BudgetStep {
+    double scale;  // Доля разрешения окна по каждой оси
+    int samplesPerPixel;
+    int maxDepth;
+};
+
+// Ступени по возрастанию стоимости: сначала разрешение до половины окна
+// и глубина, затем выборки и полное разрешение. Остальные выборки добавит
+// адаптивное накопление там, где изображение шумит
+const BudgetStep budgetSteps[] = {
+    {0.25, 1, 1},
+    {0.35, 1, 2},
+    {0.5, 1, 2},
+    {0.5, 1, 3},
+    {0.5, 2, 3},
+    {0.71, 2, 3},
+    {0.71, 4, 4},
+    {1.0, 4, 4},
+    {1.0, 8, 4},
+    {1.0, 16, 6},
+};
+
+// Вес новых измерений: сглаживает скачки, но быстро догоняет смену ракурса
+const double measurementWeight = 0.3;
+
+} // namespace
+
+FrameBudget::FrameBudget()
+    : budgetMilliseconds(0),
+    millisecondsPerRay(1e-4),
+    continuation(0.2),
+    shadowRaysPerSample(2.0),
+    measured(false)
+{
+}
+
+void FrameBudget::setBudget(double milliseconds)
+{
+    budgetMilliseconds = std::max(milliseconds, 0.0);
+}
+
+void FrameBudget::addMeasurement(uint64_t samples, uint64_t rays, uint64_t shadowRays, int maxDepth,
+                                 double milliseconds)
+{
+    if (samples == 0 || rays == 0 || shadowRays > rays || milliseconds <= 0) return;
+
+    double msPerRay = milliseconds / double(rays);
+    double shadowPerSample = double(shadowRays) / double(samples);
+    // Путь глубины maxDepth выпускает 1 + continuation * maxDepth лучей продолжения;
+    // лучи прямого освещения (по два на диффузную точку) в долю не входят
+    double bouncePerSample = double(rays - shadowRays) / double(samples);
+    double fraction = std::clamp((bouncePerSample - 1.0) / std::max(maxDepth, 1), 0.0, 1.0);
+
+    if (!measured) {
+        millisecondsPerRay = msPerRay;
+        continuation = fraction;
+        shadowRaysPerSample = shadowPerSample;
+        measured = true;
+        return;
+    }
+    millisecondsPerRay += measurementWeight * (msPerRay - millisecondsPerRay);
+    continuation += measurementWeight * (fraction - continuation);
+    shadowRaysPerSample += measurementWeight * (shadowPerSample - shadowRaysPerSample);
+}
+
+double FrameBudget::predictMilliseconds(const RtSettings& settings) const
+{
+    double rays = double(settings.width) * settings.height * settings.samplesPerPixel *
+                  (1.0 + continuation * settings.maxDepth + shadowRaysPerSample);
+    return rays * millisecondsPerRay;
+}
+
+RtSettings FrameBudget::choose(int fullWidth, int fullHeight) const
+{
+    RtSettings chosen;
+    bool first = true;
+    for (const BudgetStep& step : budgetSteps) {
+        RtSettings settings;
+        settings.width = std::max(int(std::lround(fullWidth * step.scale)), 1);
+        settings.height = std::max(int(std::lround(fullHeight * step.scale)), 1);
+        settings.samplesPerPixel = step.samplesPerPixel;
+        settings.maxDepth = step.maxDepth;
+        settings.seed = 1;
+
+        // Самая дешевая ступень берется, даже если не укладывается в бюджет
+        if (!first && predictMilliseconds(settings) > budgetMilliseconds) break;
+        chosen = settings;
+        first = false;
+    }
+    return chosen;
+}
@@ -0,0 +1,40 @@
+#ifndef FRAMEBUDGET_H
+#define FRAMEBUDGET_H
+
+#include "raytracer.h"
+
+// Подбор разрешения, числа выборок и глубины трассировки под бюджет
+// времени кадра. Модель: время = пиксели * выборки * лучей на выборку *
+// мс на луч, где лучей на выборку = 1 + continuation * глубина + лучи прямого
+// освещения; мс на луч, доля продолжаемых путей и число лучей освещения
+// на выборку измеряются на прошлых проходах
+class FrameBudget
+{
+public:
+    FrameBudget();
+
+    // 0 - режим выключен
+    void setBudget(double milliseconds);
+    double budget() const { return budgetMilliseconds; }
+
+    // Итог прохода: samples путей глубины не больше maxDepth выпустили rays лучей,
+    // из них shadowRays - лучи прямого освещения (RtTileStats::shadowRays)
+    void addMeasurement(uint64_t samples, uint64_t rays, uint64_t shadowRays, int maxDepth,
+                        double milliseconds);
+
+    // Самые качественные настройки, укладывающиеся в бюджет, для окна fullWidth x fullHeight
+    RtSettings choose(int fullWidth, int fullHeight) const;
+    double predictMilliseconds(const RtSettings& settings) const;
+
+    double raysPerSecond() const { return 1000.0 / millisecondsPerRay; }
+    bool hasMeasurements() const { return measured; }
+
+private:
+    double budgetMilliseconds;
+    double millisecondsPerRay;
+    double continuation;  // Доля путей, которые продолжаются на каждом отражении
+    double shadowRaysPerSample;  // Лучей прямого освещения на выборку, от глубины не зависит
+    bool measured;
+};
+
+#endif // FRAMEBUDGET_H
@@ -0,0 +1,89 @@
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include <cmath>
+
+// Базовые геометрические типы без зависимостей от Qt и OpenGL
+
+struct Point3D {
+    double x, y, z;
+    Point3D(double x = 0, double y = 0, double z = 0) : x(x), y(y), z(z) {}
+};
+
+inline Point3D operator+(const Point3D& a, const Point3D& b) { return Point3D(a.x + b.x, a.y + b.y, a.z + b.z); }
+inline Point3D operator-(const Point3D& a, const Point3D& b) { return Point3D(a.x - b.x, a.y - b.y, a.z - b.z); }
+inline Point3D operator*(const Point3D& a, double s) { return Point3D(a.x * s, a.y * s, a.z * s); }
+inline double dot(const Point3D& a, const Point3D& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline Point3D cross(const Point3D& a, const Point3D& b)
+{
+    return Point3D(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
+}
+inline double length(const Point3D& a) { return std::sqrt(dot(a, a)); }
+inline Point3D normalize(const Point3D& a)
+{
+    double len = length(a);
+    return len > 0 ? a * (1.0 / len) : a;
+}
+
+struct Line {
+    Point3D start, end;
+    bool visible;
+    Line(Point3D s, Point3D e, bool v = true) : start(s), end(e), visible(v) {}
+};
+
+// Повторяет преобразования paintGL/resizeGL на CPU:
+// glRotatef(rotationX, 1, 0, 0), glRotatef(rotationY, 0, 1, 0)
+// и glOrtho(-8 * aspect, 8 * aspect, -8, 8, -20, 20)
+struct ViewTransform {
+    double m[3][3];
+    double halfWidth, halfHeight, halfDepth;
+
+    static ViewTransform fromAngles(double rotationX, double rotationY, double aspect)
+    {
+        const double ax = rotationX * M_PI / 180.0;
+        const double ay = rotationY * M_PI / 180.0;
+        const double cx = cos(ax), sx = sin(ax);
+        const double cy = cos(ay), sy = sin(ay);
+
+        // Rx * Ry
+        ViewTransform v;
+        v.m[0][0] = cy;       v.m[0][1] = 0;   v.m[0][2] = sy;
+        v.m[1][0] = sx * sy;  v.m[1][1] = cx;  v.m[1][2] = -sx * cy;
+        v.m[2][0] = -cx * sy; v.m[2][1] = sx;  v.m[2][2] = cx * cy;
+        v.halfWidth = 8.0 * aspect;
+        v.halfHeight = 8.0;
+        v.halfDepth = 20.0;
+        return v;
+    }
+
+    // Координаты в системе наблюдателя (камера смотрит вдоль -Z)
+    Point3D toEye(const Point3D& p) const
+    {
+        return Point3D(m[0][0] * p.x + m[0][1] * p.y + m[0][2] * p.z,
+                       m[1][0] * p.x + m[1][1] * p.y + m[1][2] * p.z,
+                       m[2][0] * p.x + m[2][1] * p.y + m[2][2] * p.z);
+    }
+
+    // Обратное к toEye (матрица поворота ортогональна)
+    Point3D toWorld(const Point3D& e) const
+    {
+        return Point3D(m[0][0] * e.x + m[1][0] * e.y + m[2][0] * e.z,
+                       m[0][1] * e.x + m[1][1] * e.y + m[2][1] * e.z,
+                       m[0][2] * e.x + m[1][2] * e.y + m[2][2] * e.z);
+    }
+
+    // Направление взгляда в мировых координатах
+    Point3D viewDirection() const
+    {
+        return Point3D(-m[2][0], -m[2][1], -m[2][2]);
+    }
+
+    // Нормализованные координаты: x, y в [-1, 1], z - глубина в [0, 1] (0 - ближе)
+    Point3D toNdc(const Point3D& p) const
+    {
+        Point3D e = toEye(p);
+        return Point3D(e.x / halfWidth, e.y / halfHeight, 0.5 - 0.5 * e.z / halfDepth);
+    }
+};
+
+#endif // GEOMETRY_H
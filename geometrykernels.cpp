@@ -0,0 +1,331 @@
+#include "geometrykernels.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Элементы [0, count) блоками по randomBlockSize: body(block, begin, end, rng)
+// с генератором streams.stream(block). Разбиение не зависит от пула.
+// После отмены оставшиеся блоки пропускаются
+template <typename Body>
+void forEachRandomBlock(size_t count, const RandomStreams& streams, ThreadPool* pool,
+                        const std::atomic<bool>* cancel, const Body& body)
+{
+    const size_t blocks = (count + randomBlockSize - 1) / randomBlockSize;
+    auto run = [&](size_t block, int) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) return;
+        Pcg32 rng = streams.stream(block);
+        body(block, block * randomBlockSize, std::min(count, (block + 1) * randomBlockSize), rng);
+    };
+    if (pool && blocks > 1) {
+        pool->parallelFor(blocks, run);
+    } else {
+        for (size_t block = 0; block < blocks; block++) run(block, 0);
+    }
+}
+
+} // namespace
+
+Point3D evaluateCubicBezier(const Point3D* p, double t)
+{
+    double u = 1 - t;
+    double tt = t * t;
+    double uu = u * u;
+    double uuu = uu * u;
+    double ttt = tt * t;
+
+    Point3D point;
+    point.x = uuu * p[0].x + 3 * uu * t * p[1].x + 3 * u * tt * p[2].x + ttt * p[3].x;
+    point.y = uuu * p[0].y + 3 * uu * t * p[1].y + 3 * u * tt * p[2].y + ttt * p[3].y;
+    point.z = uuu * p[0].z + 3 * uu * t * p[1].z + 3 * u * tt * p[2].z + ttt * p[3].z;
+    return point;
+}
+
+void evaluateBezierCurve(const std::vector<Point3D>& controlPoints, int segments, std::vector<Point3D>& curve)
+{
+    curve.clear();
+    if (controlPoints.size() < 4) return;
+
+    const size_t segmentCount = (controlPoints.size() - 1) / 3;
+    curve.reserve(segmentCount * (segments + 1));
+    for (size_t startIndex = 0; startIndex + 3 < controlPoints.size(); startIndex += 3) {
+        for (int j = 0; j <= segments; j++) {
+            curve.push_back(evaluateCubicBezier(&controlPoints[startIndex], double(j) / segments));
+        }
+    }
+}
+
+void applyBezierSmoothness(std::vector<Point3D>& controlPoints)
+{
+    if (controlPoints.empty()) return;
+    applyBezierSmoothness(controlPoints, 0, controlPoints.size() - 1);
+}
+
+size_t applyBezierSmoothness(std::vector<Point3D>& controlPoints, size_t first, size_t last)
+{
+    // Соединения в точках 3, 6, ...: P(k+1) = P(k) - (P(k-1) - P(k)).
+    // Соединение k читает точки k-1, k и пишет k+1, поэтому от точек
+    // first..last зависят соединения first-1..last+1. Последнее соединение
+    // обрабатывается, только если за ним есть целый сегмент
+    size_t joint = std::max<size_t>(3, (first + 1) / 3 * 3);
+    size_t changed = last;
+    for (; joint <= last + 1 && joint + 4 <= controlPoints.size(); joint += 3) {
+        const Point3D direction = controlPoints[joint - 1] - controlPoints[joint];
+        controlPoints[joint + 1] = controlPoints[joint] - direction;
+        changed = std::max(changed, joint + 1);
+    }
+    return changed;
+}
+
+void updateBezierCurve(const std::vector<Point3D>& controlPoints, int segments, size_t first, size_t last,
+                       std::vector<Point3D>& curve)
+{
+    const size_t segmentCount = controlPoints.size() < 4 ? 0 : (controlPoints.size() - 1) / 3;
+    const size_t stride = size_t(segments) + 1;
+    if (curve.size() != segmentCount * stride) {
+        evaluateBezierCurve(controlPoints, segments, curve);
+        return;
+    }
+    if (segmentCount == 0 || first > last) return;
+
+    // Сегмент s - точки 3s..3s+3: точку p содержат сегменты (p-1)/3..p/3
+    const size_t firstSegment = first == 0 ? 0 : (first - 1) / 3;
+    const size_t lastSegment = std::min(last / 3, segmentCount - 1);
+    for (size_t segment = firstSegment; segment <= lastSegment; segment++) {
+        for (int j = 0; j <= segments; j++) {
+            curve[segment * stride + j] = evaluateCubicBezier(&controlPoints[segment * 3], double(j) / segments);
+        }
+    }
+}
+
+void generateBSplineControlNet(int order, std::vector<std::vector<Point3D>>& net)
+{
+    net.clear();
+
+    int size = 4 + (order - 2); // Сетка тем больше, чем выше порядок
+    for (int i = 0; i < size; i++) {
+        std::vector<Point3D> row;
+        row.reserve(size);
+        for (int j = 0; j < size; j++) {
+            double x = (i - size / 2.0) * 1.5;
+            double y = (j - size / 2.0) * 1.5;
+            // Разная форма поверхности в зависимости от порядка
+            double z = 0;
+            switch (order) {
+            case 2: z = sin(i * 0.5) * cos(j * 0.5) * 1.0; break;
+            case 3: z = sin(i * 0.8) * cos(j * 0.8) * 1.5; break;
+            case 4: z = cos(i * 1.0) * sin(j * 1.0) * 2.0; break;
+            case 5: z = (sin(i * 1.2) + cos(j * 1.2)) * 1.0; break;
+            default: z = sin(i * 0.8) * cos(j * 0.8) * 1.5;
+            }
+            row.push_back(Point3D(x, y, z));
+        }
+        net.push_back(std::move(row));
+    }
+}
+
+void generateBSplineSurface(int order, int divisions, std::vector<Point3D>& surface)
+{
+    surface.clear();
+    surface.reserve(size_t(divisions + 1) * (divisions + 1));
+
+    for (int i = 0; i <= divisions; i++) {
+        double u = double(i) / divisions;
+        for (int j = 0; j <= divisions; j++) {
+            double v = double(j) / divisions;
+
+            double x = (u - 0.5) * 6.0;
+            double y = (v - 0.5) * 6.0;
+            double z = 0;
+
+            // Разная сложность поверхности в зависимости от порядка
+            switch (order) {
+            case 2: z = sin(x * 0.3) * cos(y * 0.3) * 1.0; break;
+            case 3: z = sin(x * 0.5) * cos(y * 0.5) * 1.5; break;
+            case 4: z = (sin(x * 0.7) + cos(y * 0.7)) * 1.0; break;
+            case 5: z = sin(x * 1.0) * cos(y * 1.0) * 0.8 + cos(x * 0.5) * sin(y * 0.5) * 0.5; break;
+            default: z = sin(x * 0.5) * cos(y * 0.5) * 1.5;
+            }
+
+            surface.push_back(Point3D(x, y, z));
+        }
+    }
+}
+
+int computeRegionCode(const ClipWindow& window, double x, double y)
+{
+    int code = 0;
+    if (x < window.left) code |= 1;     // LEFT
+    if (x > window.right) code |= 2;    // RIGHT
+    if (y < window.bottom) code |= 4;   // BOTTOM
+    if (y > window.top) code |= 8;      // TOP
+    return code;
+}
+
+bool clipLine(const ClipWindow& window, Line& line)
+{
+    double x1 = line.start.x, y1 = line.start.y;
+    double x2 = line.end.x, y2 = line.end.y;
+
+    int code1 = computeRegionCode(window, x1, y1);
+    int code2 = computeRegionCode(window, x2, y2);
+
+    while (true) {
+        if (!(code1 | code2)) {
+            // Оба конца внутри окна
+            line = Line(Point3D(x1, y1, 0), Point3D(x2, y2, 0), true);
+            return true;
+        }
+        if (code1 & code2) {
+            // Оба конца с одной стороны окна
+            return false;
+        }
+
+        // Точка пересечения с границей, за которой лежит внешний конец
+        double x = 0, y = 0;
+        int codeOut = code1 ? code1 : code2;
+        if (codeOut & 8) {           // TOP
+            x = x1 + (x2 - x1) * (window.top - y1) / (y2 - y1);
+            y = window.top;
+        } else if (codeOut & 4) {    // BOTTOM
+            x = x1 + (x2 - x1) * (window.bottom - y1) / (y2 - y1);
+            y = window.bottom;
+        } else if (codeOut & 2) {    // RIGHT
+            y = y1 + (y2 - y1) * (window.right - x1) / (x2 - x1);
+            x = window.right;
+        } else if (codeOut & 1) {    // LEFT
+            y = y1 + (y2 - y1) * (window.left - x1) / (x2 - x1);
+            x = window.left;
+        }
+
+        if (codeOut == code1) {
+            x1 = x; y1 = y;
+            code1 = computeRegionCode(window, x1, y1);
+        } else {
+            x2 = x; y2 = y;
+            code2 = computeRegionCode(window, x2, y2);
+        }
+    }
+}
+
+void clipLines(const ClipWindow& window, const std::vector<Line>& lines, std::vector<Line>& clipped)
+{
+    clipped.clear();
+    for (Line line : lines) {
+        if (clipLine(window, line)) {
+            clipped.push_back(line);
+        }
+    }
+}
+
+void generateRandomLines(int count, double extent, const RandomStreams& streams, std::vector<Line>& lines,
+                         ThreadPool* pool, const std::atomic<bool>* cancel)
+{
+    lines.assign(count, Line(Point3D(), Point3D()));
+    forEachRandomBlock(count, streams, pool, cancel, [&](size_t, size_t begin, size_t end, Pcg32& rng) {
+        auto coordinate = [&] { return extent * (2.0 * rng.nextDouble() - 1.0); };
+        for (size_t i = begin; i < end; i++) {
+            double x1 = coordinate(), y1 = coordinate();
+            double x2 = coordinate(), y2 = coordinate();
+            lines[i] = Line(Point3D(x1, y1, 0), Point3D(x2, y2, 0));
+        }
+    });
+}
+
+void addZBufferMaterials(Scene& scene)
+{
+    static const Point3D colors[zbufferMaterialCount] = {
+        Point3D(1.0, 0.0, 0.0),                       // Красный
+        Point3D(0.0, 1.0, 0.0),                       // Зеленый
+        Point3D(0.0, 0.0, 1.0),                       // Синий
+        Point3D(1.0, 1.0, 0.0),                       // Желтый
+        Point3D(1.0, 0.0, 1.0),                       // Пурпурный
+        Point3D(0.0, 1.0, 1.0),                       // Голубой
+        Point3D(1.0, 165 / 255.0, 0.0),               // Оранжевый
+        Point3D(128 / 255.0, 0.0, 128 / 255.0),       // Фиолетовый
+        Point3D(165 / 255.0, 42 / 255.0, 42 / 255.0), // Коричневый
+        Point3D(0.0, 128 / 255.0, 0.0)                // Темно-зеленый
+    };
+    for (const Point3D& color : colors) {
+        scene.addMaterial({color, SceneMaterial::DIFFUSE, 1.0});
+    }
+}
+
+int generatePyramidScene(Scene& scene, int count, const RandomStreams& streams, ThreadPool* pool,
+                         const std::atomic<bool>* cancel)
+{
+    scene.clear();
+    addZBufferMaterials(scene);
+    const int pyramidMesh = scene.addMesh(cachedPrimitiveMesh({PrimitiveMeshKey::PYRAMID, 0, 0}));
+
+    scene.objects.resize(count);
+    forEachRandomBlock(count, streams, pool, cancel, [&](size_t, size_t begin, size_t end, Pcg32& rng) {
+        for (size_t i = begin; i < end; i++) {
+            double x = -3.0 + 6.0 * rng.nextDouble();
+            double y = -3.0 + 6.0 * rng.nextDouble();
+            double z = (i % 10) * 0.8; // Разная глубина для демонстрации Z-буфера
+            double size = 0.5 + rng.nextDouble();
+            scene.objects[i] = {SceneObject::MESH, pyramidMesh, {Point3D(x, y, z), size},
+                                int(i % zbufferMaterialCount)};
+        }
+    });
+    scene.touch();
+    return pyramidMesh;
+}
+
+void traceVisualizationRays(const RayTracer& tracer, int count, bool withHits, bool withReflections,
+                            const RandomStreams& streams, VisualizationRays& result, ThreadPool* pool,
+                            const std::atomic<bool>* cancel)
+{
+    // Число попаданий заранее неизвестно: блоки пишут в свои части,
+    // которые затем склеиваются по порядку блоков
+    std::vector<VisualizationRays> blocks((count + randomBlockSize - 1) / randomBlockSize);
+    forEachRandomBlock(count, streams, pool, cancel, [&](size_t block, size_t begin, size_t end, Pcg32& rng) {
+        VisualizationRays& part = blocks[block];
+        part.rays.reserve((end - begin) * 2);
+        for (size_t i = begin; i < end; i++) {
+            Point3D start(-4.0 + 8.0 * rng.nextDouble(), -4.0 + 8.0 * rng.nextDouble(), 5.0);
+            double angle = 2 * M_PI * rng.nextDouble();
+            Point3D finish(start.x + sin(angle) * 10.0, start.y + cos(angle) * 10.0, -5.0);
+            Point3D direction = normalize(finish - start);
+
+            // Настоящее пересечение со сценой; луч обрезается в точке попадания
+            RtHit hit;
+            bool found = tracer.intersect(RtRay(start, direction), hit);
+            if (found) {
+                finish = start + direction * hit.t;
+            }
+            part.rays.push_back(start);
+            part.rays.push_back(finish);
+            if (!found) continue;
+
+            if (withHits) {
+                part.hits.push_back(finish);
+                part.hitColors.push_back(tracer.hitMaterial(hit).albedo);
+            }
+
+            // Зеркальное отражение до следующего попадания
+            if (withReflections) {
+                Point3D normal = dot(direction, hit.normal) > 0 ? hit.normal * -1.0 : hit.normal;
+                Point3D reflected = direction - normal * (2.0 * dot(direction, normal));
+                Point3D from = finish + normal * 1e-4;
+                RtHit next;
+                double length = tracer.intersect(RtRay(from, reflected), next) ? next.t : 3.0;
+                part.reflections.push_back(finish);
+                part.reflections.push_back(from + reflected * length);
+            }
+        }
+    });
+
+    result.rays.clear();
+    result.hits.clear();
+    result.hitColors.clear();
+    result.reflections.clear();
+    result.rays.reserve(size_t(count) * 2);
+    for (const VisualizationRays& part : blocks) {
+        result.rays.insert(result.rays.end(), part.rays.begin(), part.rays.end());
+        result.hits.insert(result.hits.end(), part.hits.begin(), part.hits.end());
+        result.hitColors.insert(result.hitColors.end(), part.hitColors.begin(), part.hitColors.end());
+        result.reflections.insert(result.reflections.end(), part.reflections.begin(), part.reflections.end());
+    }
+}
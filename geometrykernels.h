@@ -0,0 +1,77 @@
+#ifndef GEOMETRYKERNELS_H
+#define GEOMETRYKERNELS_H
+
+#include <atomic>
+#include <vector>
+#include "geometry.h"
+#include "raytracer.h"
+#include "rng.h"
+#include "scene.h"
+#include "threadpool.h"
+
+// Вычислительные ядра тем без Qt и OpenGL. GLWidget только вызывает их и
+// загружает результат в буферы GPU; kernelbenchmark замеряет их отдельно.
+// Случайные генераторы берут числа из RandomStreams блоками по
+// randomBlockSize: с пулом и без, при любом числе потоков результат одинаков.
+// cancel - флаг отмены фоновой задачи (jobsystem.h): после него генератор
+// пропускает оставшиеся блоки, и результат неполон
+
+// Кубический сегмент Безье по точкам p[0..3]
+Point3D evaluateCubicBezier(const Point3D* p, double t);
+// Составная кривая из сегментов с общими концами (точки 0-3, 3-6, ...):
+// segments + 1 точек на сегмент
+void evaluateBezierCurve(const std::vector<Point3D>& controlPoints, int segments, std::vector<Point3D>& curve);
+// C¹-непрерывность в точках соединения: точка после соединения - на
+// продолжении отрезка от предыдущей точки через соединение
+void applyBezierSmoothness(std::vector<Point3D>& controlPoints);
+// То же только для соединений, которые зависят от точек first..last.
+// Соединения независимы, поэтому результат совпадает с полным проходом.
+// Возвращает последнюю точку, которую мог изменить проход
+size_t applyBezierSmoothness(std::vector<Point3D>& controlPoints, size_t first, size_t last);
+// Пересчитывает в curve только сегменты с точками first..last; если
+// число точек изменилось, вычисляет кривую заново
+void updateBezierCurve(const std::vector<Point3D>& controlPoints, int segments, size_t first, size_t last,
+                       std::vector<Point3D>& curve);
+
+// Контрольная сетка (4 + order - 2)^2 и поверхность (divisions + 1)^2
+// точек; форма зависит от порядка B-сплайна
+void generateBSplineControlNet(int order, std::vector<std::vector<Point3D>>& net);
+void generateBSplineSurface(int order, int divisions, std::vector<Point3D>& surface);
+
+// Отсечение отрезков окном (Коэн - Сазерленд)
+struct ClipWindow {
+    double left, right, bottom, top;
+};
+
+// 4-битный код области: 1 - левее, 2 - правее, 4 - ниже, 8 - выше окна
+int computeRegionCode(const ClipWindow& window, double x, double y);
+// Отсекает отрезок в плоскости XY; false - отрезок целиком вне окна
+bool clipLine(const ClipWindow& window, Line& line);
+// Видимые части отрезков в clipped (по порядку, z = 0)
+void clipLines(const ClipWindow& window, const std::vector<Line>& lines, std::vector<Line>& clipped);
+// Случайные отрезки в квадрате [-extent, extent]^2 плоскости XY
+void generateRandomLines(int count, double extent, const RandomStreams& streams, std::vector<Line>& lines,
+                         ThreadPool* pool = nullptr, const std::atomic<bool>* cancel = nullptr);
+
+// Сцена темы Z-буфера: материалы - цвета пирамид по порядку
+const size_t zbufferMaterialCount = 10;
+void addZBufferMaterials(Scene& scene);
+// Материалы и count пирамид - экземпляров общей сетки единичного размера,
+// со случайными положением и размером. Возвращает номер сетки пирамиды
+int generatePyramidScene(Scene& scene, int count, const RandomStreams& streams, ThreadPool* pool = nullptr,
+                         const std::atomic<bool>* cancel = nullptr);
+
+// Лучи для показа поверх сцены трассировки: из случайных точек сверху
+// в случайных направлениях до первого пересечения со сценой
+struct VisualizationRays {
+    std::vector<Point3D> rays;         // Пары начало - конец
+    std::vector<Point3D> hits;         // Точки попадания
+    std::vector<Point3D> hitColors;    // Цвет материала в точке попадания
+    std::vector<Point3D> reflections;  // Пары: зеркальное отражение до следующего попадания
+};
+
+void traceVisualizationRays(const RayTracer& tracer, int count, bool withHits, bool withReflections,
+                            const RandomStreams& streams, VisualizationRays& result, ThreadPool* pool = nullptr,
+                            const std::atomic<bool>* cancel = nullptr);
+
+#endif // GEOMETRYKERNELS_H
@@ -0,0 +1,423 @@
+#include "glrenderer.h"
+#include <QOpenGLExtraFunctions>
+#include <algorithm>
+
+#ifndef GL_PROGRAM_POINT_SIZE
+#define GL_PROGRAM_POINT_SIZE 0x8642
+#endif
+#ifndef GL_ALIASED_LINE_WIDTH_RANGE
+#define GL_ALIASED_LINE_WIDTH_RANGE 0x846E
+#endif
+
+namespace {
+
+const char* colorVertexShaderSource = R"(
+#version 330
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 vertexColor;
+uniform mat4 mvp;
+uniform vec4 model;      // Перенос xyz и масштаб w объекта
+uniform float pointSize;
+out vec3 color;
+void main()
+{
+    color = vertexColor;
+    gl_PointSize = pointSize;
+    gl_Position = mvp * vec4(position * model.w + model.xyz, 1.0);
+}
+)";
+
+const char* colorFragmentShaderSource = R"(
+#version 330
+in vec3 color;
+out vec4 fragColor;
+void main()
+{
+    fragColor = vec4(color, 1.0);
+}
+)";
+
+// Четыре вершины полосы треугольников без буфера: координаты из gl_VertexID
+const char* textureVertexShaderSource = R"(
+#version 330
+out vec2 uv;
+void main()
+{
+    uv = vec2(float(gl_VertexID & 1), float((gl_VertexID >> 1) & 1));
+    gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+
+const char* textureFragmentShaderSource = R"(
+#version 330
+in vec2 uv;
+uniform sampler2D image;
+out vec4 fragColor;
+void main()
+{
+    fragColor = texture(image, uv);
+}
+)";
+
+// Сетка аналитического примитива сцены на уровне детализации level
+PrimitiveMeshKey primitiveKey(const SceneObject& object, int level)
+{
+    if (object.shape == SceneObject::BOX) return {PrimitiveMeshKey::BOX, 0, 0};
+    return {PrimitiveMeshKey::SPHERE, primitiveLodSlices[level], primitiveLodSlices[level]};
+}
+
+} // namespace
+
+void appendColoredVertex(std::vector<float>& data, const Point3D& p, const Point3D& color)
+{
+    data.push_back(float(p.x));
+    data.push_back(float(p.y));
+    data.push_back(float(p.z));
+    data.push_back(float(color.x));
+    data.push_back(float(color.y));
+    data.push_back(float(color.z));
+}
+
+GeometryBuffer::GeometryBuffer()
+    : gl(nullptr),
+    vertexBuffer(QOpenGLBuffer::VertexBuffer),
+    indexBuffer(QOpenGLBuffer::IndexBuffer),
+    indexed(false)
+{
+}
+
+bool GeometryBuffer::create(QOpenGLExtraFunctions* functions)
+{
+    if (!vao.create() || !vertexBuffer.create()) {
+        return false;
+    }
+    gl = functions;
+    return true;
+}
+
+void GeometryBuffer::destroy()
+{
+    vao.destroy();
+    vertexBuffer.destroy();
+    indexBuffer.destroy();
+    ranges.clear();
+    indexed = false;
+    gl = nullptr;
+}
+
+void GeometryBuffer::setColoredVertices(const std::vector<float>& vertices, QOpenGLBuffer::UsagePattern usage)
+{
+    QOpenGLVertexArrayObject::Binder binder(&vao);
+    vertexBuffer.bind();
+    vertexBuffer.setUsagePattern(usage);
+    vertexBuffer.allocate(vertices.data(), int(vertices.size() * sizeof(float)));
+
+    // Раскладка атрибутов запоминается в VAO
+    gl->glEnableVertexAttribArray(0);
+    gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), nullptr);
+    gl->glEnableVertexAttribArray(1);
+    gl->glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float),
+                              reinterpret_cast<void*>(3 * sizeof(float)));
+    indexed = false;
+    ranges.clear();
+}
+
+void GeometryBuffer::setMeshes(const std::vector<float>& positions, const std::vector<unsigned int>& indices)
+{
+    QOpenGLVertexArrayObject::Binder binder(&vao);
+    vertexBuffer.bind();
+    vertexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+    vertexBuffer.allocate(positions.data(), int(positions.size() * sizeof(float)));
+
+    // Атрибут цвета выключен: берется значение glVertexAttrib3f из setColor
+    gl->glEnableVertexAttribArray(0);
+    gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+    gl->glDisableVertexAttribArray(1);
+
+    // Буфер индексов привязан к VAO
+    if (!indexBuffer.isCreated()) {
+        indexBuffer.create();
+    }
+    indexBuffer.bind();
+    indexBuffer.allocate(indices.data(), int(indices.size() * sizeof(unsigned int)));
+    indexed = true;
+    ranges.clear();
+}
+
+int GeometryBuffer::addRange(GLenum mode, int first, int count, float size)
+{
+    ranges.push_back({mode, first, count, size});
+    return int(ranges.size()) - 1;
+}
+
+void GeometryBuffer::bind()
+{
+    vao.bind();
+}
+
+void GeometryBuffer::release()
+{
+    vao.release();
+}
+
+void GeometryBuffer::drawRange(GLRenderer& renderer, int range)
+{
+    const DrawRange& r = ranges[range];
+    if (r.count <= 0) return;
+
+    if (r.mode == GL_POINTS) {
+        renderer.setPointSize(r.size);
+    } else if (r.mode == GL_LINES || r.mode == GL_LINE_STRIP || r.mode == GL_LINE_LOOP) {
+        renderer.setLineWidth(r.size);
+    }
+    if (indexed) {
+        gl->glDrawElements(r.mode, r.count, GL_UNSIGNED_INT,
+                           reinterpret_cast<void*>(size_t(r.first) * sizeof(unsigned int)));
+    } else {
+        gl->glDrawArrays(r.mode, r.first, r.count);
+    }
+}
+
+void GeometryBuffer::draw(GLRenderer& renderer)
+{
+    if (ranges.empty()) return;
+
+    bind();
+    for (int i = 0; i < int(ranges.size()); i++) {
+        drawRange(renderer, i);
+    }
+    release();
+}
+
+bool PrimitiveMeshCache::create(QOpenGLExtraFunctions* functions)
+{
+    ranges.clear();
+    positions.clear();
+    indices.clear();
+    spans.clear();
+    return geometry.create(functions);
+}
+
+void PrimitiveMeshCache::destroy()
+{
+    geometry.destroy();
+    ranges.clear();
+    positions.clear();
+    indices.clear();
+    spans.clear();
+}
+
+int PrimitiveMeshCache::range(const PrimitiveMeshKey& key)
+{
+    auto it = ranges.find(key);
+    if (it != ranges.end()) return it->second;
+
+    const IndexedMesh& mesh = cachedPrimitiveMesh(key);
+    const unsigned int base = unsigned(positions.size() / 3);
+    spans.push_back({int(indices.size()), int(mesh.indices.size())});
+    for (const Point3D& v : mesh.vertices) {
+        positions.push_back(float(v.x));
+        positions.push_back(float(v.y));
+        positions.push_back(float(v.z));
+    }
+    for (unsigned int index : mesh.indices) {
+        indices.push_back(base + index);
+    }
+
+    // Тесселяций немного, поэтому буфер проще загрузить заново целиком
+    geometry.setMeshes(positions, indices);
+    for (const auto& span : spans) {
+        geometry.addRange(GL_TRIANGLES, span.first, span.second);
+    }
+    int result = int(spans.size()) - 1;
+    ranges[key] = result;
+    return result;
+}
+
+SceneGeometry::SceneGeometry()
+    : version(0),
+    uploaded(false)
+{
+}
+
+bool SceneGeometry::create(QOpenGLExtraFunctions* functions)
+{
+    uploaded = false;
+    return buffer.create(functions);
+}
+
+void SceneGeometry::destroy()
+{
+    buffer.destroy();
+    meshRanges.clear();
+    lodLevels.clear();
+    uploaded = false;
+}
+
+void SceneGeometry::update(const Scene& scene)
+{
+    if (uploaded && version == scene.version) return;
+
+    std::vector<float> positions;
+    std::vector<unsigned int> indices;
+    std::vector<int> meshFirst;
+    for (const IndexedMesh& mesh : scene.meshes) {
+        const unsigned int base = unsigned(positions.size() / 3);
+        meshFirst.push_back(int(indices.size()));
+        for (const Point3D& v : mesh.vertices) {
+            positions.push_back(float(v.x));
+            positions.push_back(float(v.y));
+            positions.push_back(float(v.z));
+        }
+        for (unsigned int index : mesh.indices) {
+            indices.push_back(base + index);
+        }
+    }
+    meshFirst.push_back(int(indices.size()));
+
+    buffer.setMeshes(positions, indices);
+    meshRanges.clear();
+    for (size_t i = 0; i + 1 < meshFirst.size(); i++) {
+        meshRanges.push_back(buffer.addRange(GL_TRIANGLES, meshFirst[i], meshFirst[i + 1] - meshFirst[i]));
+    }
+    lodLevels.assign(scene.objects.size(), -1);
+    version = scene.version;
+    uploaded = true;
+}
+
+void SceneGeometry::draw(GLRenderer& renderer, PrimitiveMeshCache& primitives, const Scene& scene,
+                         double pixelsPerUnit, const std::vector<size_t>* objects)
+{
+    update(scene);
+
+    const size_t count = objects ? objects->size() : scene.objects.size();
+    if (count == 0) return;
+
+    // Два прохода: сначала сетки сцены, затем примитивы - по одной привязке VAO на проход
+    for (int pass = 0; pass < 2; pass++) {
+        GeometryBuffer& geometry = pass == 0 ? buffer : primitives.buffer();
+        bool bound = false;
+        for (size_t i = 0; i < count; i++) {
+            const size_t index = objects ? (*objects)[i] : i;
+            const SceneObject& object = scene.objects[index];
+            if ((object.shape == SceneObject::MESH) != (pass == 0)) continue;
+
+            // В ортографической проекции размер на экране не зависит от глубины
+            if (object.shape == SceneObject::SPHERE) {
+                lodLevels[index] = (signed char)selectPrimitiveLod(2.0 * object.transform.scale * pixelsPerUnit,
+                                                                   lodLevels[index]);
+            }
+
+            // Новая тесселяция догружает буфер примитивов и снимает привязку VAO
+            const int knownRanges = geometry.rangeCount();
+            const int range = pass == 0 ? meshRanges[object.mesh]
+                                        : primitives.range(primitiveKey(object, std::max<int>(lodLevels[index], 0)));
+            if (!bound || geometry.rangeCount() != knownRanges) {
+                geometry.bind();
+                bound = true;
+            }
+            renderer.setModel(object.transform);
+            renderer.setColor(scene.materials[object.material].albedo);
+            geometry.drawRange(renderer, range);
+        }
+        if (bound) geometry.release();
+    }
+    renderer.resetModel();
+}
+
+GLRenderer::GLRenderer()
+    : gl(nullptr),
+    mvpLocation(-1),
+    modelLocation(-1),
+    pointSizeLocation(-1),
+    lineWidthLimit(1.0f)
+{
+}
+
+bool GLRenderer::initialize(QOpenGLExtraFunctions* functions)
+{
+    gl = functions;
+
+    if (!colorProgram.addShaderFromSourceCode(QOpenGLShader::Vertex, colorVertexShaderSource) ||
+        !colorProgram.addShaderFromSourceCode(QOpenGLShader::Fragment, colorFragmentShaderSource) ||
+        !colorProgram.link() ||
+        !textureProgram.addShaderFromSourceCode(QOpenGLShader::Vertex, textureVertexShaderSource) ||
+        !textureProgram.addShaderFromSourceCode(QOpenGLShader::Fragment, textureFragmentShaderSource) ||
+        !textureProgram.link()) {
+        return false;
+    }
+    mvpLocation = colorProgram.uniformLocation("mvp");
+    modelLocation = colorProgram.uniformLocation("model");
+    pointSizeLocation = colorProgram.uniformLocation("pointSize");
+
+    emptyVao.create();
+    gl->glEnable(GL_PROGRAM_POINT_SIZE);
+
+    GLfloat widthRange[2] = {1.0f, 1.0f};
+    gl->glGetFloatv(GL_ALIASED_LINE_WIDTH_RANGE, widthRange);
+    lineWidthLimit = std::max(1.0f, widthRange[1]);
+    return true;
+}
+
+void GLRenderer::destroy()
+{
+    emptyVao.destroy();
+    colorProgram.removeAllShaders();
+    textureProgram.removeAllShaders();
+}
+
+void GLRenderer::beginColored(const QMatrix4x4& mvp)
+{
+    colorProgram.bind();
+    colorProgram.setUniformValue(mvpLocation, mvp);
+    colorProgram.setUniformValue(pointSizeLocation, 1.0f);
+    resetModel();
+}
+
+void GLRenderer::setModel(const SceneTransform& transform)
+{
+    colorProgram.setUniformValue(modelLocation, float(transform.translation.x), float(transform.translation.y),
+                                 float(transform.translation.z), float(transform.scale));
+}
+
+void GLRenderer::resetModel()
+{
+    colorProgram.setUniformValue(modelLocation, 0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+void GLRenderer::setColor(const Point3D& color)
+{
+    gl->glVertexAttrib3f(1, float(color.x), float(color.y), float(color.z));
+}
+
+void GLRenderer::setPointSize(float size)
+{
+    colorProgram.setUniformValue(pointSizeLocation, size);
+}
+
+void GLRenderer::setLineWidth(float width)
+{
+    gl->glLineWidth(std::min(width, lineWidthLimit));
+}
+
+void GLRenderer::endColored()
+{
+    colorProgram.release();
+}
+
+void GLRenderer::drawFullscreenTexture(GLuint texture)
+{
+    gl->glDisable(GL_DEPTH_TEST);
+    textureProgram.bind();
+    textureProgram.setUniformValue("image", 0);
+    gl->glActiveTexture(GL_TEXTURE0);
+    gl->glBindTexture(GL_TEXTURE_2D, texture);
+
+    emptyVao.bind();
+    gl->glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    emptyVao.release();
+
+    gl->glBindTexture(GL_TEXTURE_2D, 0);
+    textureProgram.release();
+    gl->glEnable(GL_DEPTH_TEST);
+}
@@ -0,0 +1,150 @@
+#ifndef GLRENDERER_H
+#define GLRENDERER_H
+
+#include <QMatrix4x4>
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include <map>
+#include <vector>
+#include "mesh.h"
+#include "scene.h"
+
+class QOpenGLExtraFunctions;
+class GLRenderer;
+
+// Добавляет вершину x, y, z, r, g, b (формат GeometryBuffer::setColoredVertices)
+void appendColoredVertex(std::vector<float>& data, const Point3D& p, const Point3D& color);
+
+// Постоянная геометрия в буферах GPU: VAO, вершины, необязательные индексы
+// и список вызовов отрисовки. Данные загружаются только в set*, поэтому
+// кадр без изменений стоит несколько glDraw* на буфер
+class GeometryBuffer
+{
+public:
+    GeometryBuffer();
+
+    // Вызываются при текущем контексте OpenGL
+    bool create(QOpenGLExtraFunctions* functions);
+    void destroy();
+    bool isCreated() const { return gl != nullptr; }
+
+    // Вершины x, y, z, r, g, b. usage = StreamDraw для данных, меняющихся каждый кадр
+    void setColoredVertices(const std::vector<float>& vertices,
+                            QOpenGLBuffer::UsagePattern usage = QOpenGLBuffer::StaticDraw);
+    // Вершины x, y, z и индексы; цвет задается GLRenderer::setColor
+    void setMeshes(const std::vector<float>& positions, const std::vector<unsigned int>& indices);
+
+    // Вызов отрисовки: count вершин с first (или индексов, если буфер с индексами).
+    // size - толщина линий или размер точек. Возвращает номер диапазона
+    int addRange(GLenum mode, int first, int count, float size = 1.0f);
+    void clearRanges() { ranges.clear(); }
+    int rangeCount() const { return int(ranges.size()); }
+
+    void bind();
+    void release();
+    // Между bind и release, при активной программе цвета renderer
+    void drawRange(GLRenderer& renderer, int range);
+    // Все диапазоны по порядку
+    void draw(GLRenderer& renderer);
+
+private:
+    struct DrawRange {
+        GLenum mode;
+        int first;
+        int count;
+        float size;
+    };
+
+    QOpenGLExtraFunctions* gl;
+    QOpenGLVertexArrayObject vao;
+    QOpenGLBuffer vertexBuffer;
+    QOpenGLBuffer indexBuffer;
+    bool indexed;
+    std::vector<DrawRange> ranges;
+};
+
+// Сетки стандартных примитивов (cachedPrimitiveMesh) в одном буфере GPU.
+// Каждая тесселяция загружается один раз, при первом запросе ее диапазона;
+// рисование примитива - перенос/масштаб и один вызов отрисовки
+class PrimitiveMeshCache
+{
+public:
+    bool create(QOpenGLExtraFunctions* functions);
+    void destroy();
+
+    // Номер диапазона в buffer(); новая тесселяция догружает буфер целиком
+    int range(const PrimitiveMeshKey& key);
+    GeometryBuffer& buffer() { return geometry; }
+
+private:
+    GeometryBuffer geometry;
+    std::map<PrimitiveMeshKey, int> ranges;
+    std::vector<float> positions;        // Копия содержимого буфера для догрузки
+    std::vector<unsigned int> indices;
+    std::vector<std::pair<int, int>> spans; // Первый индекс и число индексов диапазона
+};
+
+// Все сетки сцены в одном буфере с индексами. Буфер загружается заново
+// только при смене версии сцены; объект рисуется диапазоном своей сетки
+// (сфера и куб - из PrimitiveMeshCache) под переносом/масштабом и цветом материала
+class SceneGeometry
+{
+public:
+    SceneGeometry();
+
+    bool create(QOpenGLExtraFunctions* functions);
+    void destroy();
+
+    void update(const Scene& scene);
+    // objects - номера объектов сцены; nullptr - все объекты.
+    // pixelsPerUnit - масштаб ортографической проекции: по нему сферы
+    // получают уровень детализации (selectPrimitiveLod)
+    void draw(GLRenderer& renderer, PrimitiveMeshCache& primitives, const Scene& scene,
+              double pixelsPerUnit, const std::vector<size_t>* objects = nullptr);
+
+private:
+    GeometryBuffer buffer;
+    uint64_t version;
+    bool uploaded;
+    std::vector<int> meshRanges;
+    std::vector<signed char> lodLevels;  // Текущий уровень детализации объекта; -1 - не выбран
+};
+
+// Набор шейдеров вместо фиксированного конвейера: цвет вершин или
+// постоянный цвет под матрицей камеры и переносом/масштабом объекта,
+// и текстура на весь экран
+class GLRenderer
+{
+public:
+    GLRenderer();
+
+    bool initialize(QOpenGLExtraFunctions* functions);
+    void destroy();
+
+    // Программа цвета; модель сбрасывается в единичную
+    void beginColored(const QMatrix4x4& mvp);
+    void setModel(const SceneTransform& transform);
+    void resetModel();
+    // Цвет для буферов без цвета вершин (GeometryBuffer::setMeshes)
+    void setColor(const Point3D& color);
+    void setPointSize(float size);
+    // Толщина больше 1 в core profile поддерживается не везде - ограничивается
+    void setLineWidth(float width);
+    void endColored();
+
+    // Текстура на весь экран без теста глубины
+    void drawFullscreenTexture(GLuint texture);
+
+private:
+    QOpenGLExtraFunctions* gl;
+    QOpenGLShaderProgram colorProgram;
+    QOpenGLShaderProgram textureProgram;
+    QOpenGLVertexArrayObject emptyVao;  // Core profile не рисует без VAO
+    int mvpLocation;
+    int modelLocation;
+    int pointSizeLocation;
+    float lineWidthLimit;
+};
+
+#endif // GLRENDERER_H
@@ -1,12 +1,58 @@
 #include "glwidget.h"
+#include "geometrykernels.h"
 #include <QMouseEvent>
 #include <cmath>
 #include <algorithm>
-#include <random>
+#include <cstdint>
+#include <cstdlib>
 #include <QColor>
+#include <QPainter>
+#include <QScreen>
+#include <QTimer>
+
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
 
 GLWidget::GLWidget(QWidget* parent)
     : QOpenGLWidget(parent),
+    rendererReady(false),
+    bspBufferDirty(true),
+    bufferDirtyLayers(~0u),
+    frameScheduled(false),
+    showProfilerOverlay(true),
+    gpuTimers(false),
+    gpuTimerQueries{},
+    gpuTimerPending{},
+    gpuTimerNext(0),
+    gpuTimerActive(false),
+    linesGeneration(0),
+    zbufferGeneration(0),
+    builtThemes(0),
+    themePrewarmEnabled(false),
+    themePrewarmStarted(false),
+    jobs(jobChannelCount), // По потоку на канал: каналы не ждут друг друга
+    controlPointBatchDepth(0),
+    controlPointBatchFirst(SIZE_MAX),
+    controlPointBatchLast(0),
+    controlPointBatchResized(false),
+    linesClipped(false),
+    instancedRendererReady(false),
+    instancedMeshVersion(0),
+    visibilityMode(VISIBILITY_ZBUFFER),
+    bspSceneVersion(0),
+    bspBuildFailed(false),
+    zbufferCulledCount(0),
+    zbufferOutsideCount(0),
+    rayVisualizationGeneration(0),
+    rayVisualizationCount(0),
+    progressiveRenderer(rayTracingPool),
+    showTileTimings(false),
+    rayTracedTexture(0),
+    rayTracedImageDirty(true),
+    rayTracedTextureDirty(false),
+    showRayTracedImage(true),
+    requestedRotationX(0), requestedRotationY(0),
     rotationX(15.0f), rotationY(15.0f),
     isRotating(false),
     showControlPolygon(true),
@@ -19,94 +65,214 @@ GLWidget::GLWidget(QWidget* parent)
     maxRays(50),
     showRays(true)
 {
+    // Кривая Безье - тема по умолчанию, и ее точки сразу нужны таблице окна;
+    // остальные темы строятся при первом показе (ensureThemeData)
     initializeControlPoints();
     calculateBezierCurve();
-    generateLines();
-    generateZBufferScene();
-    generateBSplineSurface(); // Генерируем B-spline по умолчанию
-    generateRayTracingScene();
-}
+    builtThemes = 1u << BEZIER_CURVE;
 
+    // Проход завершается в фоновом потоке, перерисовка - в потоке интерфейса
+    progressiveRenderer.setPassFinishedCallback([this] {
+        QMetaObject::invokeMethod(this, [this] { markDirty(LAYER_RAY_TRACED_IMAGE); }, Qt::QueuedConnection);
+    });
+    progressiveRenderer.setProfiler(&profiler);
+}
 
-void GLWidget::calculateBezierCurve()
+GLWidget::~GLWidget()
 {
-    bezierCurve.clear();
-    int segments = 50; // Уменьшаем для лучшей производительности
+    // Задачи пишут в снимки: останавливаются первыми
+    jobs.cancelAll(true);
+    progressiveRenderer.cancel(true);
+    makeCurrent();
+    instancedRenderer.destroy();
+    axesBuffer.destroy();
+    bezierBuffer.destroy();
+    bsplineBuffer.destroy();
+    clippingBuffer.destroy();
+    bspBuffer.destroy();
+    primitiveMeshes.destroy();
+    zbufferGeometry.destroy();
+    rayTracingGeometry.destroy();
+    rayBuffer.destroy();
+    renderer.destroy();
+    if (rayTracedTexture) {
+        glDeleteTextures(1, &rayTracedTexture);
+    }
+    if (gpuTimerQueries[0]) {
+        glDeleteQueries(gpuTimerQueryCount, gpuTimerQueries);
+    }
+    doneCurrent();
+}
 
-    // Рисуем 3 сегмента кубических кривых Безье
-    for (int seg = 0; seg < 3; seg++) {
-        int startIndex = seg * 3;
-        if (startIndex + 3 >= controlPoints.size()) break;
+namespace {
 
-        for (int j = 0; j <= segments; j++) {
-            double t = double(j) / segments;
-            Point3D point = calculateBezierPoint(startIndex, t);
-            bezierCurve.push_back(point);
-        }
+// Цвет лучей по уровню качества трассировки
+Point3D rayColorForQuality(int quality)
+{
+    switch (quality) {
+    case 1: return Point3D(1.0, 0.0, 0.0); // Красный - низкое качество
+    case 2: return Point3D(1.0, 1.0, 0.0); // Желтый - среднее качество
+    case 3: return Point3D(0.0, 1.0, 0.0); // Зеленый - хорошее качество
+    case 4: return Point3D(0.0, 1.0, 1.0); // Голубой - высокое качество
+    case 5: return Point3D(1.0, 0.0, 1.0); // Пурпурный - максимальное качество
+    default: return Point3D(1.0, 1.0, 1.0);
     }
 }
-void GLWidget::drawControlPoints()
+
+// Отрезков кривой Безье на сегмент
+const int bezierCurveSteps = 50;
+
+// Отрезки темы отсечения и разбиение поверхности B-spline
+const int clippingLineCount = 15;
+const double clippingLineExtent = 5.0;
+const int bsplineSurfaceDivisions = 20;
+
+} // namespace
+
+
+void GLWidget::calculateBezierCurve()
+{
+    ScopedTimer timer(profiler, "calculateBezierCurve");
+
+    evaluateBezierCurve(controlPoints, bezierCurveSteps, bezierCurve);
+    markDirty(LAYER_CONTROL_POLYGON | LAYER_CURVE);
+}
+void GLWidget::updateBezierBuffer()
 {
-    glPointSize(8.0f);
-    glBegin(GL_POINTS);
+    if (!takeBufferDirty(LAYER_CONTROL_POLYGON | LAYER_CURVE)) return;
+    ScopedTimer timer(profiler, "updateBezierBuffer");
+
+    std::vector<float> data;
+    data.reserve((controlPoints.size() * 3 + bezierCurve.size()) * 6);
 
     for (size_t i = 0; i < controlPoints.size(); i++) {
         // Разные цвета для разных типов точек
+        Point3D color;
         if (i % 3 == 0) {
-            glColor3f(1.0f, 0.0f, 0.0f); // Красные - начальные точки сегментов
-        } else if (i % 3 == 1 || i % 3 == 2) {
-            glColor3f(0.0f, 1.0f, 0.0f); // Зеленые - контрольные точки
+            color = Point3D(1.0, 0.0, 0.0); // Красные - начальные точки сегментов
+        } else {
+            color = Point3D(0.0, 1.0, 0.0); // Зеленые - контрольные точки
         }
 
         // Точки соединения сегментов (индексы 3, 6) выделяем особым цветом
         if (i == 3 || i == 6) {
-            glColor3f(0.0f, 0.0f, 1.0f); // Синие - точки соединения
+            color = Point3D(0.0, 0.0, 1.0); // Синие - точки соединения
         }
-
-        glVertex3f(controlPoints[i].x, controlPoints[i].y, controlPoints[i].z);
+        appendColoredVertex(data, controlPoints[i], color);
     }
-    glEnd();
-    glPointSize(1.0f);
-}
+    const int pointCount = int(controlPoints.size());
 
-Point3D GLWidget::calculateBezierPoint(int startIndex, double t)
-{
-    double u = 1 - t;
-    double tt = t * t;
-    double uu = u * u;
-    double uuu = uu * u;
-    double ttt = tt * t;
+    const Point3D polygonColor(0.5, 0.5, 0.5);
+    for (size_t i = 0; i + 1 < controlPoints.size(); i++) {
+        appendColoredVertex(data, controlPoints[i], polygonColor);
+        appendColoredVertex(data, controlPoints[i + 1], polygonColor);
+    }
+    const int polygonCount = int(data.size() / 6) - pointCount;
 
-    Point3D p0 = controlPoints[startIndex];
-    Point3D p1 = controlPoints[startIndex + 1];
-    Point3D p2 = controlPoints[startIndex + 2];
-    Point3D p3 = controlPoints[startIndex + 3];
+    for (const auto& point : bezierCurve) {
+        appendColoredVertex(data, point, Point3D(0.0, 1.0, 1.0));
+    }
 
-    Point3D point;
-    point.x = uuu * p0.x + 3 * uu * t * p1.x + 3 * u * tt * p2.x + ttt * p3.x;
-    point.y = uuu * p0.y + 3 * uu * t * p1.y + 3 * u * tt * p2.y + ttt * p3.y;
-    point.z = uuu * p0.z + 3 * uu * t * p1.z + 3 * u * tt * p2.z + ttt * p3.z;
+    // Диапазоны: 0 - точки, 1 - многоугольник, 2 - кривая
+    bezierBuffer.setColoredVertices(data);
+    bezierBuffer.addRange(GL_POINTS, 0, pointCount, 8.0f);
+    bezierBuffer.addRange(GL_LINES, pointCount, polygonCount, 1.0f);
+    bezierBuffer.addRange(GL_LINE_STRIP, pointCount + polygonCount, int(bezierCurve.size()), 3.0f);
+}
 
-    return point;
+void GLWidget::drawControlPoints()
+{
+    updateBezierBuffer();
+    bezierBuffer.bind();
+    bezierBuffer.drawRange(renderer, 0);
+    bezierBuffer.release();
 }
 
 void GLWidget::updateControlPoint(int index, double x, double y, double z)
 {
     if (index >= 0 && index < controlPoints.size()) {
+        sessionLog.record(SESSION_CONTROL_POINT, index, x, y, z);
         controlPoints[index] = Point3D(x, y, z);
+        controlPointsEdited(index, index, false);
+    }
+}
 
-        // Автоматически применяем условия гладкости при изменении контрольных точек
-        if (index == 2 || index == 3 || index == 4) {
-            // Если изменили точки вокруг первого соединения
-            applySmoothnessConditions();
-        } else if (index == 5 || index == 6 || index == 7) {
-            // Если изменили точки вокруг второго соединения
-            applySmoothnessConditions();
-        } else {
-            calculateBezierCurve();
-        }
+void GLWidget::updateControlPointCoordinate(int index, int axis, double value)
+{
+    if (index < 0 || index >= int(controlPoints.size()) || axis < 0 || axis > 2) return;
 
-        update();
+    Point3D& point = controlPoints[index];
+    (axis == 0 ? point.x : axis == 1 ? point.y : point.z) = value;
+    sessionLog.record(SESSION_CONTROL_POINT, index, point.x, point.y, point.z);
+    controlPointsEdited(index, index, false);
+}
+
+void GLWidget::updateControlPoints(int first, const std::vector<Point3D>& points)
+{
+    if (first < 0 || first > int(controlPoints.size()) || points.empty()) return;
+
+    beginControlPointUpdate();
+    // Точки за концом массива добавляются
+    const bool resized = first + points.size() > controlPoints.size();
+    if (resized) {
+        controlPoints.resize(first + points.size());
+    }
+    for (size_t i = 0; i < points.size(); i++) {
+        const Point3D& point = points[i];
+        sessionLog.record(SESSION_CONTROL_POINT, double(first + i), point.x, point.y, point.z);
+        controlPoints[first + i] = point;
+    }
+    controlPointsEdited(first, first + points.size() - 1, resized);
+    endControlPointUpdate();
+}
+
+void GLWidget::beginControlPointUpdate()
+{
+    controlPointBatchDepth++;
+}
+
+void GLWidget::endControlPointUpdate()
+{
+    if (controlPointBatchDepth == 0 || --controlPointBatchDepth > 0) return;
+    if (controlPointBatchFirst > controlPointBatchLast) return;
+
+    applyControlPointEdits(controlPointBatchFirst, controlPointBatchLast, controlPointBatchResized);
+    controlPointBatchFirst = SIZE_MAX;
+    controlPointBatchLast = 0;
+    controlPointBatchResized = false;
+}
+
+void GLWidget::controlPointsEdited(size_t first, size_t last, bool resized)
+{
+    if (controlPointBatchDepth == 0) {
+        applyControlPointEdits(first, last, resized);
+        return;
+    }
+    // В пакете правки только копятся: один проход в endControlPointUpdate
+    controlPointBatchFirst = std::min(controlPointBatchFirst, first);
+    controlPointBatchLast = std::max(controlPointBatchLast, last);
+    controlPointBatchResized = controlPointBatchResized || resized;
+}
+
+void GLWidget::applyControlPointEdits(size_t first, size_t last, bool resized)
+{
+    ScopedTimer timer(profiler, "applyControlPointEdits");
+
+    // Условия гладкости и кривая - только для затронутых соединений и
+    // сегментов: правка одной ячейки не зависит от числа точек. Новые
+    // точки делают полными сегменты перед ними - тогда проход по всем
+    if (resized) {
+        first = 0;
+        last = controlPoints.size() - 1;
+    }
+    last = applyBezierSmoothness(controlPoints, first, last);
+    updateBezierCurve(controlPoints, bezierCurveSteps, first, last, bezierCurve);
+    markDirty(LAYER_CONTROL_POLYGON | LAYER_CURVE);
+
+    if (resized) {
+        emit controlPointCountChanged();
+    } else {
+        emit controlPointsChanged(int(first), int(last));
     }
 }
 
@@ -117,257 +283,639 @@ std::vector<Point3D> GLWidget::getControlPoints() const
 
 void GLWidget::setShowControlPolygon(bool show)
 {
+    sessionLog.record(SESSION_SHOW_POLYGON, show);
     showControlPolygon = show;
-    update();
+    markDirty(LAYER_VIEW);
 }
 
 void GLWidget::setCurrentTheme(Theme theme)
 {
+    sessionLog.record(SESSION_THEME, theme);
     currentTheme = theme;
-    update();
+    ensureThemeData(currentTheme);
+    if (currentTheme != RAY_TRACING) {
+        progressiveRenderer.cancel();
+        rayTracedImageDirty = true;
+    }
+    markDirty(LAYER_VIEW);
 }
 
 void GLWidget::setBSplineOrder(int order)
 {
+    sessionLog.record(SESSION_BSPLINE_ORDER, order);
     bsplineOrder = order;
     currentBSplineOrder = order; // Сохраняем текущий порядок
-    generateBSplineSurface(); // Перегенерируем поверхность при изменении порядка
-    update();
+    // Перегенерируем поверхность при изменении порядка; непостроенная
+    // построится с ним при показе темы
+    if (isThemeBuilt(BSPLINE_SURFACE)) {
+        buildBSplineSurface();
+    }
 }
 
 void GLWidget::setClippingWindow(double left, double right, double bottom, double top)
 {
+    sessionLog.record(SESSION_CLIP_WINDOW, left, right, bottom, top);
     clipLeft = left;
     clipRight = right;
     clipBottom = bottom;
     clipTop = top;
-    update();
+    markDirty(LAYER_CLIPPING);
 }
 
 void GLWidget::setZBufferObjectsCount(int count)
 {
+    sessionLog.record(SESSION_ZBUFFER_OBJECTS, count);
     zbufferObjectsCount = count;
-    update();
+    markDirty(LAYER_ZBUFFER);
 }
 void GLWidget::generateRayTracingScene()
 {
-    rays.clear();
-    rayHits.clear();
-
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> posDis(-4.0, 4.0);
-    std::uniform_real_distribution<> angleDis(0, 2 * M_PI);
-
-    // Генерируем лучи из случайных точек в случайных направлениях
-    for (int i = 0; i < maxRays * rayTracingQuality; i++) {
-        Point3D start(posDis(gen), posDis(gen), 5.0); // Лучи идут сверху
-        double angle = angleDis(gen);
-        Point3D end(start.x + sin(angle) * 10.0, start.y + cos(angle) * 10.0, -5.0);
-        rays.push_back(start);
-        rays.push_back(end);
-
-        // Случайные точки "попадания" лучей
-        double t = static_cast<double>(rand()) / RAND_MAX;
-        Point3D hit(
-            start.x + t * (end.x - start.x),
-            start.y + t * (end.y - start.y),
-            start.z + t * (end.z - start.z)
-            );
-        rayHits.push_back(hit);
-    }
+    // Лучи трассируются по готовой сцене; пока она строится, задачу
+    // поставит acquireSnapshots, когда сцена станет текущей
+    const std::shared_ptr<const RayTracingSceneSnapshot> scene = raySceneSnapshots.currentShared();
+    if (!scene) return;
+
+    // Лучи меняются только по кнопке "Обновить трассировку"
+    const RandomStreams streams = randomStreams.split(RANDOM_STREAM_VISUALIZATION_RAYS)
+                                              .split(rayVisualizationGeneration);
+    const int count = rayVisualizationCount > 0 ? rayVisualizationCount : maxRays * rayTracingQuality;
+    const int quality = rayTracingQuality;
+
+    // Задача держит снимок сцены: поток интерфейса может тем временем
+    // перейти к следующему
+    jobs.submit(JOB_RAY_VISUALIZATION, [this, scene, streams, count, quality](const std::atomic<bool>& cancelled) {
+        ScopedTimer timer(profiler, "generateRayTracingScene");
+
+        const Point3D rayColor = rayColorForQuality(quality);
+        const Point3D reflectionColor(0.5, 0.5, 1.0);
+
+        VisualizationRays rays;
+        traceVisualizationRays(scene->tracer, count, quality >= 3, quality >= 4, streams, rays, nullptr, &cancelled);
+        if (cancelled) return;
+
+        // Лучи, точки попадания цветом материала (с качества 3) и отражения (с качества 4)
+        std::unique_ptr<RayVisualizationSnapshot> snapshot(new RayVisualizationSnapshot);
+        std::vector<float>& data = snapshot->vertexData;
+        data.reserve((rays.rays.size() + rays.hits.size() + rays.reflections.size()) * 6);
+        for (const Point3D& point : rays.rays) {
+            appendColoredVertex(data, point, rayColor);
+        }
+        for (size_t i = 0; i < rays.hits.size(); i++) {
+            appendColoredVertex(data, rays.hits[i], rays.hitColors[i]);
+        }
+        for (const Point3D& point : rays.reflections) {
+            appendColoredVertex(data, point, reflectionColor);
+        }
+        snapshot->lineVertices = int(rays.rays.size());
+        snapshot->hitVertices = int(rays.hits.size());
+        snapshot->reflectionVertices = int(rays.reflections.size());
+
+        // Рамка с числом штрихов по уровню качества
+        const Point3D white(1.0, 1.0, 1.0);
+        const size_t qualityStart = data.size();
+        const Point3D frame[] = {Point3D(3, 3, 0), Point3D(4.5, 3, 0), Point3D(4.5, 4, 0), Point3D(3, 4, 0)};
+        for (int i = 0; i < 4; i++) {
+            appendColoredVertex(data, frame[i], white);
+            appendColoredVertex(data, frame[(i + 1) % 4], white);
+        }
+        for (int i = 0; i < quality; i++) {
+            appendColoredVertex(data, Point3D(3.2 + i * 0.3, 3.3, 0), white);
+            appendColoredVertex(data, Point3D(3.2 + i * 0.3, 3.7, 0), white);
+        }
+        snapshot->qualityInfoVertices = int((data.size() - qualityStart) / 6);
 
-    update();
+        raySnapshots.publish(std::move(snapshot));
+        snapshotPublished(LAYER_RAYS);
+    });
 }
 void GLWidget::setRayTracingQuality(int quality)
 {
+    sessionLog.record(SESSION_RAY_QUALITY, quality);
     rayTracingQuality = quality;
     maxRays = 20 * quality; // Больше качества = больше лучей
+    rayTracedImageDirty = true;
     generateRayTracingScene(); // Перегенерируем сцену
-    update();
 }
 
-void GLWidget::generateBSplineSurface()
+void GLWidget::setRayVisualizationCount(int count)
 {
-    bsplineControlNet.clear();
-    bsplineSurface.clear();
-
-    // Создаем контрольную сетку 4x4 с учетом порядка
-    int size = 4 + (currentBSplineOrder - 2); // Увеличиваем сетку для более высоких порядков
-    for (int i = 0; i < size; i++) {
-        std::vector<Point3D> row;
-        for (int j = 0; j < size; j++) {
-            double x = (i - size/2.0) * 1.5;
-            double y = (j - size/2.0) * 1.5;
-            // Разная форма поверхности в зависимости от порядка
-            double z = 0;
-            switch(currentBSplineOrder) {
-            case 2: z = sin(i * 0.5) * cos(j * 0.5) * 1.0; break;
-            case 3: z = sin(i * 0.8) * cos(j * 0.8) * 1.5; break;
-            case 4: z = cos(i * 1.0) * sin(j * 1.0) * 2.0; break;
-            case 5: z = (sin(i * 1.2) + cos(j * 1.2)) * 1.0; break;
-            default: z = sin(i * 0.8) * cos(j * 0.8) * 1.5;
-            }
-            row.push_back(Point3D(x, y, z));
-        }
-        bsplineControlNet.push_back(row);
-    }
-
-    // Генерируем поверхность с учетом порядка
-    int divisions = 20;
-    for (int i = 0; i <= divisions; i++) {
-        double u = double(i) / divisions;
-        for (int j = 0; j <= divisions; j++) {
-            double v = double(j) / divisions;
-
-            // Более сложная интерполяция с учетом порядка
-            double x = (u - 0.5) * 6.0;
-            double y = (v - 0.5) * 6.0;
-            double z = 0;
-
-            // Разная сложность поверхности в зависимости от порядка
-            switch(currentBSplineOrder) {
-            case 2: z = sin(x * 0.3) * cos(y * 0.3) * 1.0; break;
-            case 3: z = sin(x * 0.5) * cos(y * 0.5) * 1.5; break;
-            case 4: z = (sin(x * 0.7) + cos(y * 0.7)) * 1.0; break;
-            case 5: z = sin(x * 1.0) * cos(y * 1.0) * 0.8 + cos(x * 0.5) * sin(y * 0.5) * 0.5; break;
-            default: z = sin(x * 0.5) * cos(y * 0.5) * 1.5;
-            }
+    sessionLog.record(SESSION_RAY_COUNT, count);
+    rayVisualizationCount = count;
+    generateRayTracingScene();
+}
 
-            bsplineSurface.push_back(Point3D(x, y, z));
-        }
+void GLWidget::setRandomSeed(uint64_t seed)
+{
+    // Все генераторы начинают свои последовательности заново
+    randomStreams = RandomStreams(seed);
+    linesGeneration = 0;
+    zbufferGeneration = 0;
+    rayVisualizationGeneration = 0;
+    // При повторе то же событие сбрасывает генерации и перестраивает темы так же
+    sessionLog.recordText(SESSION_RANDOM_STATE, std::to_string(randomStreams.seed()),
+                          double(linesGeneration), double(zbufferGeneration), double(rayVisualizationGeneration));
+    // Непостроенные темы получат новый seed при показе
+    if (isThemeBuilt(LINE_CLIPPING)) {
+        buildLines();
+    }
+    if (isThemeBuilt(ZBUFFER)) {
+        buildZBufferScene();
     }
+    generateRayTracingScene();
+    rayTracedImageDirty = true;
+    markDirty(LAYER_RAY_TRACED_IMAGE);
+}
 
-    update();
+void GLWidget::setFrameBudget(double milliseconds)
+{
+    sessionLog.record(SESSION_FRAME_BUDGET, milliseconds);
+    frameBudget.setBudget(milliseconds);
+    rayTracedImageDirty = true;
+    markDirty(LAYER_RAY_TRACED_IMAGE);
 }
 
-void GLWidget::generateLines()
+void GLWidget::setShowRayTracedImage(bool show)
 {
-    originalLines.clear();
-    clippedLines.clear();
+    sessionLog.record(SESSION_SHOW_RAY_IMAGE, show);
+    showRayTracedImage = show;
+    markDirty(LAYER_VIEW);
+}
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> dis(-5.0, 5.0);
+void GLWidget::setShowTileTimings(bool show)
+{
+    sessionLog.record(SESSION_SHOW_TILE_TIMINGS, show);
+    showTileTimings = show;
+    markDirty(LAYER_VIEW);
+}
 
-    // Генерируем случайные отрезки
-    for (int i = 0; i < 15; i++) {
-        Point3D start(dis(gen), dis(gen), 0);
-        Point3D end(dis(gen), dis(gen), 0);
-        originalLines.push_back(Line(start, end));
+void GLWidget::setProfilingEnabled(bool enabled, bool showOverlay)
+{
+    if (enabled && !profiler.isEnabled()) {
+        profiler.clear();
     }
+    profiler.setEnabled(enabled);
+    showProfilerOverlay = showOverlay;
+    markDirty(LAYER_VIEW);
+}
 
-    update();
+std::vector<Profiler::StageStats> GLWidget::profileStages() const
+{
+    return profiler.stages();
 }
 
-bool GLWidget::isPointInsideWindow(double x, double y)
+void GLWidget::setViewRotation(float x, float y)
 {
-    return x >= clipLeft && x <= clipRight && y >= clipBottom && y <= clipTop;
+    sessionLog.record(SESSION_ROTATE, x, y);
+    rotationX = x;
+    rotationY = y;
+    markDirty(LAYER_VIEW);
 }
 
-int GLWidget::computeRegionCode(double x, double y)
+void GLWidget::setGpuTimers(bool enabled)
 {
-    int code = 0;
-    if (x < clipLeft) code |= 1;      // LEFT
-    if (x > clipRight) code |= 2;     // RIGHT
-    if (y < clipBottom) code |= 4;    // BOTTOM
-    if (y > clipTop) code |= 8;       // TOP
-    return code;
+    gpuTimers = enabled;
+    markDirty(LAYER_VIEW);
 }
 
-void GLWidget::performClipping()
+bool GLWidget::exportTrace(const QString& fileName, QString* error)
 {
-    clippedLines.clear();
+    std::string message;
+    if (!profiler.exportChromeTrace(fileName.toStdString(), &message)) {
+        if (error) *error = QString::fromStdString(message);
+        return false;
+    }
+    return true;
+}
 
-    for (const auto& line : originalLines) {
-        double x1 = line.start.x, y1 = line.start.y;
-        double x2 = line.end.x, y2 = line.end.y;
-
-        int code1 = computeRegionCode(x1, y1);
-        int code2 = computeRegionCode(x2, y2);
-
-        bool accept = false;
-
-        while (true) {
-            if (!(code1 | code2)) {
-                // Оба конца внутри окна
-                accept = true;
-                break;
-            } else if (code1 & code2) {
-                // Оба конца с одной стороны окна
-                break;
-            } else {
-                // Нужно отсекать
-                double x, y;
-                int codeOut = code1 ? code1 : code2;
-
-                // Находим точку пересечения
-                if (codeOut & 8) {           // TOP
-                    x = x1 + (x2 - x1) * (clipTop - y1) / (y2 - y1);
-                    y = clipTop;
-                } else if (codeOut & 4) {    // BOTTOM
-                    x = x1 + (x2 - x1) * (clipBottom - y1) / (y2 - y1);
-                    y = clipBottom;
-                } else if (codeOut & 2) {    // RIGHT
-                    y = y1 + (y2 - y1) * (clipRight - x1) / (x2 - x1);
-                    x = clipRight;
-                } else if (codeOut & 1) {    // LEFT
-                    y = y1 + (y2 - y1) * (clipLeft - x1) / (x2 - x1);
-                    x = clipLeft;
-                }
+void GLWidget::startSessionRecording()
+{
+    sessionLog.start();
+
+    // Состояние на момент начала записи: повтор начинается с него же.
+    // Число объектов и окно отсечения - до генераторов, которые их используют
+    sessionLog.record(SESSION_ZBUFFER_OBJECTS, zbufferObjectsCount);
+    sessionLog.record(SESSION_CLIP_WINDOW, clipLeft, clipRight, clipBottom, clipTop);
+    sessionLog.record(SESSION_RAY_COUNT, rayVisualizationCount);
+    sessionLog.record(SESSION_RAY_QUALITY, rayTracingQuality);
+    sessionLog.recordText(SESSION_RANDOM_STATE, std::to_string(randomStreams.seed()),
+                          double(linesGeneration), double(zbufferGeneration), double(rayVisualizationGeneration));
+    if (linesClipped) {
+        sessionLog.record(SESSION_PERFORM_CLIPPING);
+    }
+    if (!zbufferModelFile.isEmpty()) {
+        sessionLog.recordText(SESSION_LOAD_MODEL, zbufferModelFile.toStdString());
+    }
+    sessionLog.record(SESSION_BSPLINE_ORDER, currentBSplineOrder);
+    sessionLog.record(SESSION_VISIBILITY, visibilityMode);
+    sessionLog.record(SESSION_FRAME_BUDGET, frameBudget.budget());
+    sessionLog.record(SESSION_SHOW_POLYGON, showControlPolygon);
+    sessionLog.record(SESSION_SHOW_RAY_IMAGE, showRayTracedImage);
+    sessionLog.record(SESSION_SHOW_TILE_TIMINGS, showTileTimings);
+    // Сброс перед точками: при повторе их станет ровно столько же,
+    // сколько было при записи, даже если точки добавлялись вставкой
+    sessionLog.record(SESSION_RESET_POINTS);
+    for (size_t i = 0; i < controlPoints.size(); i++) {
+        sessionLog.record(SESSION_CONTROL_POINT, double(i), controlPoints[i].x, controlPoints[i].y, controlPoints[i].z);
+    }
+    sessionLog.record(SESSION_ROTATE, rotationX, rotationY);
+    sessionLog.record(SESSION_THEME, currentTheme);
+}
 
-                if (codeOut == code1) {
-                    x1 = x; y1 = y;
-                    code1 = computeRegionCode(x1, y1);
-                } else {
-                    x2 = x; y2 = y;
-                    code2 = computeRegionCode(x2, y2);
-                }
-            }
-        }
+void GLWidget::stopSessionRecording()
+{
+    sessionLog.stop();
+}
+
+bool GLWidget::saveSession(const QString& fileName, QString* error) const
+{
+    std::string message;
+    if (!sessionLog.save(fileName.toStdString(), &message)) {
+        if (error) *error = QString::fromStdString(message);
+        return false;
+    }
+    return true;
+}
 
-        if (accept) {
-            clippedLines.push_back(Line(Point3D(x1, y1, 0), Point3D(x2, y2, 0), true));
+void GLWidget::applySessionEvent(const SessionEvent& event)
+{
+    const double* v = event.values;
+    switch (event.type) {
+    case SESSION_ROTATE: setViewRotation(float(v[0]), float(v[1])); break;
+    case SESSION_THEME: setCurrentTheme(Theme(int(v[0]))); break;
+    case SESSION_CONTROL_POINT:
+        // Вставка за концом таблицы пишет добавленные точки по возрастанию
+        // номеров, поэтому точка с номером size() добавляется, как в updateControlPoints
+        updateControlPoints(int(v[0]), {Point3D(v[1], v[2], v[3])});
+        break;
+    case SESSION_RESET_POINTS:
+        initializeControlPoints();
+        calculateBezierCurve();
+        break;
+    case SESSION_SHOW_POLYGON: setShowControlPolygon(v[0] != 0); break;
+    case SESSION_BSPLINE_ORDER: setBSplineOrder(int(v[0])); break;
+    case SESSION_GENERATE_BSPLINE: generateBSplineSurface(); break;
+    case SESSION_CLIP_WINDOW: setClippingWindow(v[0], v[1], v[2], v[3]); break;
+    case SESSION_GENERATE_LINES: generateLines(); break;
+    case SESSION_PERFORM_CLIPPING: performClipping(); break;
+    case SESSION_ZBUFFER_OBJECTS: setZBufferObjectsCount(int(v[0])); break;
+    case SESSION_GENERATE_ZBUFFER: generateZBufferScene(); break;
+    case SESSION_LOAD_MODEL: loadZBufferModel(QString::fromStdString(event.text)); break;
+    case SESSION_VISIBILITY: setVisibilityMode(VisibilityMode(int(v[0]))); break;
+    case SESSION_RAY_QUALITY: setRayTracingQuality(int(v[0])); break;
+    case SESSION_FRAME_BUDGET: setFrameBudget(v[0]); break;
+    case SESSION_RAY_COUNT: setRayVisualizationCount(int(v[0])); break;
+    case SESSION_RENDER_RAY_TRACING: renderRayTracing(); break;
+    case SESSION_SHOW_RAY_IMAGE: setShowRayTracedImage(v[0] != 0); break;
+    case SESSION_SHOW_TILE_TIMINGS: setShowTileTimings(v[0] != 0); break;
+    case SESSION_RANDOM_STATE:
+        // Номер генерации - следующей; текущие данные созданы предыдущей
+        randomStreams = RandomStreams(std::strtoull(event.text.c_str(), nullptr, 10));
+        linesGeneration = std::max<uint64_t>(uint64_t(v[0]), 1) - 1;
+        zbufferGeneration = std::max<uint64_t>(uint64_t(v[1]), 1) - 1;
+        rayVisualizationGeneration = uint64_t(v[2]);
+        if (isThemeBuilt(LINE_CLIPPING)) {
+            buildLines();
+        }
+        if (isThemeBuilt(ZBUFFER)) {
+            buildZBufferScene();
         }
+        generateRayTracingScene();
+        rayTracedImageDirty = true;
+        markDirty(LAYER_RAY_TRACED_IMAGE);
+        break;
+    case SESSION_EVENT_TYPE_COUNT: break;
     }
+}
 
-    update();
+void GLWidget::generateBSplineSurface()
+{
+    sessionLog.record(SESSION_GENERATE_BSPLINE);
+    buildBSplineSurface();
+}
+
+void GLWidget::buildBSplineSurface()
+{
+    const int order = currentBSplineOrder;
+    builtThemes |= 1u << BSPLINE_SURFACE;
+
+    jobs.submit(JOB_BSPLINE, [this, order](const std::atomic<bool>& cancelled) {
+        ScopedTimer timer(profiler, "generateBSplineSurface");
+
+        std::unique_ptr<BSplineSnapshot> snapshot(new BSplineSnapshot);
+        ::generateBSplineControlNet(order, snapshot->controlNet);
+        if (cancelled) return;
+        ::generateBSplineSurface(order, bsplineSurfaceDivisions, snapshot->surface);
+        if (cancelled) return;
+
+        bsplineSnapshots.publish(std::move(snapshot));
+        snapshotPublished(LAYER_SURFACE);
+    });
+}
+
+void GLWidget::generateLines()
+{
+    sessionLog.record(SESSION_GENERATE_LINES);
+    buildLines();
+}
+
+void GLWidget::buildLines()
+{
+    // Каждая генерация - следующий поток: новые отрезки, но та же
+    // последовательность наборов при том же seed
+    linesGeneration++;
+    linesClipped = false;
+    builtThemes |= 1u << LINE_CLIPPING;
+    submitLinesJob(false);
+}
+
+void GLWidget::submitLinesJob(bool clip)
+{
+    // Отрезки последней генерации: задача берет их из текущего снимка, а
+    // если он от другой генерации (новая еще не опубликована) - генерирует
+    // заново тем же потоком, с тем же результатом
+    const RandomStreams streams = randomStreams.split(RANDOM_STREAM_LINES).split(linesGeneration - 1);
+    const ClipWindow window = {clipLeft, clipRight, clipBottom, clipTop};
+    const std::shared_ptr<const ClippingSnapshot> base = clippingSnapshots.currentShared();
+
+    jobs.submit(JOB_CLIPPING, [this, streams, window, base, clip](const std::atomic<bool>& cancelled) {
+        ScopedTimer timer(profiler, clip ? "performClipping" : "generateLines");
+
+        std::unique_ptr<ClippingSnapshot> snapshot(new ClippingSnapshot);
+        snapshot->linesSeed = streams.seed();
+        if (base && base->linesSeed == streams.seed()) {
+            snapshot->lines = base->lines;
+        } else {
+            generateRandomLines(clippingLineCount, clippingLineExtent, streams, snapshot->lines,
+                                nullptr, &cancelled);
+        }
+        if (cancelled) return;
+        if (clip) {
+            clipLines(window, snapshot->lines, snapshot->clipped);
+        }
+
+        clippingSnapshots.publish(std::move(snapshot));
+        snapshotPublished(LAYER_CLIPPING);
+    });
+}
+
+void GLWidget::performClipping()
+{
+    sessionLog.record(SESSION_PERFORM_CLIPPING);
+
+    ensureThemeData(LINE_CLIPPING);
+    linesClipped = true;
+    submitLinesJob(true);
 }
 
 void GLWidget::generateZBufferScene()
 {
-    zbufferObjects.clear();
+    sessionLog.record(SESSION_GENERATE_ZBUFFER);
+    buildZBufferScene();
+}
+
+void GLWidget::buildZBufferScene()
+{
+    const int count = zbufferObjectsCount;
+    const RandomStreams streams = randomStreams.split(RANDOM_STREAM_ZBUFFER_SCENE).split(zbufferGeneration++);
+    zbufferModelFile.clear();
+    builtThemes |= 1u << ZBUFFER;
+
+    jobs.submit(JOB_ZBUFFER, [this, count, streams](const std::atomic<bool>& cancelled) {
+        ScopedTimer timer(profiler, "generateZBufferScene");
+
+        std::unique_ptr<ZBufferSnapshot> snapshot(new ZBufferSnapshot);
+        snapshot->pyramidMesh = generatePyramidScene(snapshot->scene, count, streams, nullptr, &cancelled);
+        if (cancelled) return;
+
+        zbufferSnapshots.publish(std::move(snapshot));
+        snapshotPublished(LAYER_ZBUFFER);
+    });
+}
+
+void GLWidget::buildRayTracingScene()
+{
+    builtThemes |= 1u << RAY_TRACING;
+
+    // Сцена и BVH строятся в задаче в собственный трассировщик снимка;
+    // поток интерфейса переключается на него в acquireSnapshots
+    jobs.submit(JOB_RAY_SCENE, [this](const std::atomic<bool>& cancelled) {
+        ScopedTimer timer(profiler, "buildRayTracingScene");
+
+        std::unique_ptr<RayTracingSceneSnapshot> snapshot(new RayTracingSceneSnapshot);
+        snapshot->scene = makeRayTracingRoomScene();
+        if (cancelled) return;
+        snapshot->tracer.setScene(snapshot->scene);
+        if (cancelled) return;
+
+        raySceneSnapshots.publish(std::move(snapshot));
+        snapshotPublished(LAYER_RAYS | LAYER_RAY_TRACED_IMAGE);
+    });
+}
+
+void GLWidget::ensureThemeData(Theme theme)
+{
+    if (isThemeBuilt(theme)) return;
+
+    switch (theme) {
+    case BEZIER_CURVE: break; // Строится в конструкторе
+    case BSPLINE_SURFACE: buildBSplineSurface(); break;
+    case LINE_CLIPPING: buildLines(); break;
+    case ZBUFFER:
+        // Пока грузится первая модель, пирамиды не строятся: они отменили бы загрузку
+        if (zbufferModelFile.isEmpty()) buildZBufferScene();
+        break;
+    case RAY_TRACING: buildRayTracingScene(); break;
+    }
+}
+
+void GLWidget::setThemePrewarm(bool enabled)
+{
+    themePrewarmEnabled = enabled;
+}
+
+void GLWidget::startThemePrewarm()
+{
+    if (!themePrewarmEnabled || themePrewarmStarted) return;
+    themePrewarmStarted = true;
 
-    std::random_device rd;
-    std::mt19937 gen(rd());
-    std::uniform_real_distribution<> posDis(-3.0, 3.0);
-    std::uniform_real_distribution<> sizeDis(0.5, 1.5);
+    // Постановка задач не ждет их: темы строятся в потоках JobSystem
+    for (int theme = 0; theme < themeCount; theme++) {
+        ensureThemeData(Theme(theme));
+    }
+}
 
-    for (int i = 0; i < zbufferObjectsCount; i++) {
-        std::vector<Point3D> object;
-        double x = posDis(gen);
-        double y = posDis(gen);
-        double z = i * 0.8; // Разная глубина для демонстрации Z-буфера
-        double size = sizeDis(gen);
+void GLWidget::waitForJobs()
+{
+    // Готовая сцена трассировки ставит задачу лучей - ждем и ее
+    do {
+        jobs.waitIdle();
+    } while (acquireSnapshots());
+}
 
-        // Создаем пирамиду
-        object.push_back(Point3D(x - size, y - size, z)); // основание
-        object.push_back(Point3D(x + size, y - size, z));
-        object.push_back(Point3D(x + size, y + size, z));
-        object.push_back(Point3D(x - size, y + size, z));
-        object.push_back(Point3D(x, y, z + size * 2));    // вершина
+void GLWidget::snapshotPublished(unsigned layers)
+{
+    QMetaObject::invokeMethod(this, [this, layers] { markDirty(layers); }, Qt::QueuedConnection);
+}
 
-        zbufferObjects.push_back(object);
+bool GLWidget::acquireSnapshots()
+{
+    // Буфер GPU слоя перестраивается из нового снимка
+    if (bsplineSnapshots.acquire()) bufferDirtyLayers |= LAYER_SURFACE;
+    if (clippingSnapshots.acquire()) bufferDirtyLayers |= LAYER_CLIPPING;
+    if (zbufferSnapshots.acquire()) {
+        bufferDirtyLayers |= LAYER_ZBUFFER;
+        builtThemes |= 1u << ZBUFFER;
     }
+    if (raySnapshots.acquire()) bufferDirtyLayers |= LAYER_RAYS;
 
-    update();
+    // Новая сцена трассировки: прогрессивный рендер начинает накопление
+    // с ее трассировщиком (прежний снимок он отпустит сам), лучи - заново
+    if (!raySceneSnapshots.acquire()) return false;
+    rayTracedImageDirty = true;
+    generateRayTracingScene();
+    return true;
 }
 
+void GLWidget::loadZBufferModel(const QString& fileName)
+{
+    sessionLog.recordText(SESSION_LOAD_MODEL, fileName.toStdString());
+    submitZBufferModel(fileName, zbufferModelFile);
+}
+
+void GLWidget::submitZBufferModel(const QString& fileName, const QString& previousModelFile)
+{
+    // Бит темы ставит acquireSnapshots, когда снимок модели опубликован
+    zbufferModelFile = fileName;
+
+    // Чтение и разбор файла - в задаче канала сцены Z-буфера: генерация
+    // пирамид, если она еще идет, отменяется и не заменит модель
+    jobs.submit(JOB_ZBUFFER, [this, fileName, previousModelFile](const std::atomic<bool>& cancelled) {
+        ScopedTimer timer(profiler, "loadZBufferModel");
+
+        IndexedMesh mesh;
+        std::string message;
+        if (!loadObjMesh(fileName.toStdString(), mesh, &message)) {
+            const QString error = QString::fromStdString(message);
+            QMetaObject::invokeMethod(this, [this, fileName, previousModelFile, error] {
+                // Задача отменила прежнюю задачу канала, поэтому прежняя сцена
+                // строится заново: модель, пирамиды или ничего, если темы еще нет
+                if (zbufferModelFile == fileName) {
+                    if (!previousModelFile.isEmpty()) {
+                        submitZBufferModel(previousModelFile, QString());
+                    } else if (isThemeBuilt(ZBUFFER) || currentTheme == ZBUFFER) {
+                        buildZBufferScene();
+                    } else {
+                        zbufferModelFile.clear();
+                    }
+                }
+                emit zbufferModelLoadFailed(fileName, error);
+            }, Qt::QueuedConnection);
+            return;
+        }
+        if (cancelled) return;
+
+        // Вписываем модель в область сцены
+        mesh.fitToSize(8.0);
+
+        std::unique_ptr<ZBufferSnapshot> snapshot(new ZBufferSnapshot);
+        addZBufferMaterials(snapshot->scene);
+        snapshot->scene.addObject(SceneObject::MESH, snapshot->scene.addMesh(std::move(mesh)), SceneTransform(), 0);
+
+        zbufferSnapshots.publish(std::move(snapshot));
+        snapshotPublished(LAYER_ZBUFFER);
+    });
+}
+
+void GLWidget::setVisibilityMode(VisibilityMode mode)
+{
+    sessionLog.record(SESSION_VISIBILITY, mode);
+    visibilityMode = mode;
+    markDirty(LAYER_ZBUFFER);
+}
 
 
+
+void GLWidget::markDirty(unsigned layers)
+{
+    bufferDirtyLayers |= layers;
+    // Изменения невидимых тем ждут переключения на них
+    if (layers & themeLayers(currentTheme)) {
+        scheduleFrame();
+    }
+}
+
+unsigned GLWidget::themeLayers(Theme theme) const
+{
+    switch (theme) {
+    case BEZIER_CURVE: return LAYER_VIEW | LAYER_CONTROL_POLYGON | LAYER_CURVE;
+    case BSPLINE_SURFACE: return LAYER_VIEW | LAYER_SURFACE;
+    case LINE_CLIPPING: return LAYER_VIEW | LAYER_CLIPPING;
+    case ZBUFFER: return LAYER_VIEW | LAYER_ZBUFFER;
+    case RAY_TRACING: return LAYER_VIEW | LAYER_RAYS | LAYER_RAY_TRACED_IMAGE;
+    }
+    return ~0u;
+}
+
+void GLWidget::scheduleFrame()
+{
+    if (frameScheduled) return;
+    frameScheduled = true;
+
+    // События между кадрами сливаются: следующий кадр - не раньше, чем через
+    // период обновления экрана после предыдущего
+    double refreshRate = screen() ? screen()->refreshRate() : 60.0;
+    int interval = int(1000.0 / std::max(refreshRate, 1.0));
+    int delay = lastFrameTimer.isValid() ? std::max(0, interval - int(lastFrameTimer.elapsed())) : 0;
+    if (delay == 0) {
+        update();
+    } else {
+        QTimer::singleShot(delay, this, [this] { update(); });
+    }
+}
+
+bool GLWidget::takeBufferDirty(unsigned layers)
+{
+    if (!(bufferDirtyLayers & layers)) return false;
+    bufferDirtyLayers &= ~layers;
+    return true;
+}
+
 void GLWidget::initializeGL()
 {
     initializeOpenGLFunctions();
+
+    // Буферы создаются заново вместе с контекстом и заполняются при первой отрисовке
+    rendererReady = renderer.initialize(this) &&
+                    axesBuffer.create(this) &&
+                    bezierBuffer.create(this) &&
+                    bsplineBuffer.create(this) &&
+                    clippingBuffer.create(this) &&
+                    bspBuffer.create(this) &&
+                    primitiveMeshes.create(this) &&
+                    zbufferGeometry.create(this) &&
+                    rayTracingGeometry.create(this) &&
+                    rayBuffer.create(this);
+    bufferDirtyLayers = ~0u;
+    bspBufferDirty = true;
+    // Запросы таймера принадлежат прежнему контексту
+    std::fill(gpuTimerQueries, gpuTimerQueries + gpuTimerQueryCount, 0);
+    std::fill(gpuTimerPending, gpuTimerPending + gpuTimerQueryCount, false);
+
+    if (rendererReady) {
+        std::vector<float> axes;
+        appendColoredVertex(axes, Point3D(-10, 0, 0), Point3D(1, 0, 0));
+        appendColoredVertex(axes, Point3D(10, 0, 0), Point3D(1, 0, 0));
+        appendColoredVertex(axes, Point3D(0, -10, 0), Point3D(0, 1, 0));
+        appendColoredVertex(axes, Point3D(0, 10, 0), Point3D(0, 1, 0));
+        appendColoredVertex(axes, Point3D(0, 0, -10), Point3D(0, 0, 1));
+        appendColoredVertex(axes, Point3D(0, 0, 10), Point3D(0, 0, 1));
+        axesBuffer.setColoredVertices(axes);
+        axesBuffer.addRange(GL_LINES, 0, 6, 2.0f);
+    }
+
+    // Сетка для инстансинга загружается в drawZBuffer при смене сцены
+    instancedRendererReady = instancedRenderer.initialize(this);
+    instancedMeshVersion = 0;
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_LINE_SMOOTH);
@@ -377,21 +925,33 @@ void GLWidget::initializeGL()
 void GLWidget::resizeGL(int w, int h)
 {
     glViewport(0, 0, w, h);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    float aspect = float(w) / float(h);
-    glOrtho(-8 * aspect, 8 * aspect, -8, 8, -20, 20);
-    glMatrixMode(GL_MODELVIEW);
 }
 
 void GLWidget::paintGL()
 {
+    ScopedTimer timer(profiler, "paintGL");
+    ensureThemeData(currentTheme);
+    acquireSnapshots();
+    frameScheduled = false;
+    lastFrameTimer.restart();
+
+    // QPainter в drawOverlay сбрасывает состояние GL, поэтому восстанавливаем его каждый кадр
+    glEnable(GL_DEPTH_TEST);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    glLoadIdentity();
+    if (!rendererReady) {
+        drawOverlay(QStringList() << QString("Нужен OpenGL 3.3 core profile"));
+        return;
+    }
+    beginGpuTimer();
 
-    glRotatef(rotationX, 1.0f, 0.0f, 0.0f);
-    glRotatef(rotationY, 0.0f, 1.0f, 0.0f);
+    // Камера - униформа шейдеров: ortho и поворот, как в ViewTransform::fromAngles
+    float aspect = float(width()) / float(std::max(height(), 1));
+    camera.setToIdentity();
+    camera.ortho(-8 * aspect, 8 * aspect, -8, 8, -20, 20);
+    camera.rotate(rotationX, 1.0f, 0.0f, 0.0f);
+    camera.rotate(rotationY, 0.0f, 1.0f, 0.0f);
 
+    renderer.beginColored(camera);
     drawCoordinateAxes();
 
     switch(currentTheme) {
@@ -415,6 +975,182 @@ void GLWidget::paintGL()
         drawRayTracing();
         break;
     }
+    renderer.endColored();
+    endGpuTimer();
+
+    QStringList overlay;
+    const ZBufferSnapshot* zbuffer = zbufferSnapshots.current();
+    if (currentTheme == ZBUFFER && zbuffer) {
+        overlay << QString("Треугольников: %1").arg(zbuffer->scene.triangleCount());
+        if (visibilityMode == VISIBILITY_ZBUFFER) {
+            overlay << QString("Hi-Z: отсечено %1 из %2 объектов, вне экрана %3")
+                           .arg(zbufferCulledCount)
+                           .arg(zbuffer->scene.objects.size())
+                           .arg(zbufferOutsideCount);
+        } else {
+            if (bspBuildFailed) {
+                overlay << QString("BSP: превышен лимит разрезов, дерево не построено");
+            } else {
+                overlay << QString("BSP: %1 узлов, %2 треугольников после разрезов")
+                               .arg(bspTree.nodeCount())
+                               .arg(bspTree.triangleCount());
+            }
+        }
+    }
+    if (currentTheme == RAY_TRACING && showRayTracedImage && !rayTracedImage.rgba.empty()) {
+        const RtSettings& settings = rayTracedProgress.settings;
+        if (rayTracedProgress.adaptive) {
+            overlay << QString("Бюджет кадра: %1 мс, прогноз %2 мс, масштаб %3%")
+                           .arg(frameBudget.budget(), 0, 'f', 0)
+                           .arg(frameBudget.predictMilliseconds(settings), 0, 'f', 1)
+                           .arg(100.0 * settings.width / std::max(width(), 1), 0, 'f', 0);
+            overlay << QString("Трассировка: %1x%2, первый проход %3 выб./пикс., глубина %4, в среднем %5 выб./пикс.")
+                           .arg(settings.width)
+                           .arg(settings.height)
+                           .arg(settings.samplesPerPixel)
+                           .arg(settings.maxDepth)
+                           .arg(rayTracedProgress.samples, 0, 'f', 2);
+            overlay << QString("Досчитано шумных пикселей: %1")
+                           .arg(rayTracedProgress.refinedPixels);
+        } else {
+            overlay << QString("Трассировка: %1x%2, накоплено %3 из %4 выб./пикс., глубина %5")
+                           .arg(settings.width)
+                           .arg(settings.height)
+                           .arg(rayTracedProgress.samples, 0, 'f', 0)
+                           .arg(settings.samplesPerPixel)
+                           .arg(settings.maxDepth);
+        }
+        overlay << QString("Проход: %1 мс, всего: %2 мс, %3 млн лучей/с")
+                       .arg(rayTracedProgress.passMilliseconds, 0, 'f', 1)
+                       .arg(rayTracedProgress.totalMilliseconds, 0, 'f', 1)
+                       .arg(frameBudget.raysPerSecond() / 1e6, 0, 'f', 2);
+        const RayTracingSceneSnapshot* raySceneSnapshot = raySceneSnapshots.current();
+        if (raySceneSnapshot && raySceneSnapshot->tracer.simdLevel() != SIMD_SCALAR) {
+            overlay << QString("SIMD: %1, пакеты по %2 лучей")
+                           .arg(raySceneSnapshot->tracer.simdName())
+                           .arg(raySceneSnapshot->tracer.simdLanes());
+        }
+
+        const RtTileStats& stats = rayTracedProgress.tileStats;
+        if (!stats.tileMilliseconds.empty()) {
+            auto tiles = std::minmax_element(stats.tileMilliseconds.begin(), stats.tileMilliseconds.end());
+            double tileSum = 0;
+            for (float ms : stats.tileMilliseconds) tileSum += ms;
+            auto workers = std::minmax_element(stats.workerMilliseconds.begin(), stats.workerMilliseconds.end());
+
+            overlay << QString("Плиток: %1 по %2x%2, потоков: %3, перехвачено: %4")
+                           .arg(stats.tileMilliseconds.size())
+                           .arg(stats.tileSize)
+                           .arg(stats.workerMilliseconds.size())
+                           .arg(stats.stolenTiles);
+            overlay << QString("Плитка: мин %1 / сред %2 / макс %3 мс")
+                           .arg(*tiles.first, 0, 'f', 2)
+                           .arg(tileSum / stats.tileMilliseconds.size(), 0, 'f', 2)
+                           .arg(*tiles.second, 0, 'f', 2);
+            overlay << QString("Загрузка потоков: %1 - %2 мс")
+                           .arg(*workers.first, 0, 'f', 1)
+                           .arg(*workers.second, 0, 'f', 1);
+        }
+        if (showTileTimings) {
+            drawTileTimings();
+        }
+    }
+    if (profiler.isEnabled() && showProfilerOverlay) {
+        appendProfilerOverlay(overlay);
+        drawProfilerHistogram();
+    }
+    drawOverlay(overlay);
+
+    // Первый кадр показан - остальные темы готовятся в фоне
+    if (themePrewarmEnabled && !themePrewarmStarted) {
+        QTimer::singleShot(0, this, [this] { startThemePrewarm(); });
+    }
+}
+
+void GLWidget::appendProfilerOverlay(QStringList& overlay) const
+{
+    overlay << QString("Стадия: сред / p95 / макс, мс");
+    for (const Profiler::StageStats& stats : profiler.stages()) {
+        overlay << QString("%1: %2 / %3 / %4")
+                       .arg(QString::fromStdString(stats.name))
+                       .arg(stats.average, 0, 'f', 2)
+                       .arg(stats.p95, 0, 'f', 2)
+                       .arg(stats.max, 0, 'f', 2);
+    }
+}
+
+void GLWidget::drawProfilerHistogram()
+{
+    // Текущий кадр еще не закончен - показываются предыдущие
+    const Profiler::StageStats frames = profiler.stage("paintGL");
+    if (frames.history.empty()) return;
+
+    // Столбец на кадр в правом нижнем углу; линия - период обновления экрана
+    const int barWidth = 2;
+    const int histogramHeight = 80;
+    const int left = width() - 10 - barWidth * int(frames.history.size());
+    const int bottom = height() - 10;
+    const double refreshPeriod = 1000.0 / std::max(screen() ? screen()->refreshRate() : 60.0, 1.0);
+    const double scale = histogramHeight / std::max(2.0 * refreshPeriod, frames.max);
+
+    QPainter painter(this);
+    for (size_t i = 0; i < frames.history.size(); i++) {
+        const double ms = frames.history[i];
+        QColor color = ms > refreshPeriod ? QColor(255, 80, 80, 200) : QColor(80, 220, 80, 200);
+        painter.fillRect(QRectF(left + int(i) * barWidth, bottom - ms * scale, barWidth, ms * scale), color);
+    }
+    const int budgetY = bottom - int(refreshPeriod * scale);
+    painter.setPen(QColor(255, 255, 255, 160));
+    painter.drawLine(left, budgetY, width() - 10, budgetY);
+    painter.drawText(left, bottom - histogramHeight - 4,
+                     QString("Кадр CPU: %1 мс").arg(frames.last, 0, 'f', 1));
+}
+
+void GLWidget::beginGpuTimer()
+{
+    if (!gpuTimers || !profiler.isEnabled()) return;
+    if (!gpuTimerQueries[0]) {
+        glGenQueries(gpuTimerQueryCount, gpuTimerQueries);
+    }
+
+    for (int i = 0; i < gpuTimerQueryCount; i++) {
+        if (!gpuTimerPending[i]) continue;
+        GLuint available = 0;
+        glGetQueryObjectuiv(gpuTimerQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) continue;
+        GLuint nanoseconds = 0;
+        glGetQueryObjectuiv(gpuTimerQueries[i], GL_QUERY_RESULT, &nanoseconds);
+        profiler.recordDuration("gpuFrame", nanoseconds / 1e6);
+        gpuTimerPending[i] = false;
+    }
+
+    // Все запросы ждут результата - кадр пропускается
+    if (gpuTimerPending[gpuTimerNext]) return;
+    glBeginQuery(GL_TIME_ELAPSED, gpuTimerQueries[gpuTimerNext]);
+    gpuTimerActive = true;
+}
+
+void GLWidget::endGpuTimer()
+{
+    if (!gpuTimerActive) return;
+    glEndQuery(GL_TIME_ELAPSED);
+    gpuTimerPending[gpuTimerNext] = true;
+    gpuTimerNext = (gpuTimerNext + 1) % gpuTimerQueryCount;
+    gpuTimerActive = false;
+}
+
+void GLWidget::drawOverlay(const QStringList& lines)
+{
+    if (lines.isEmpty()) return;
+
+    QPainter painter(this);
+    painter.setPen(Qt::white);
+    const int lineHeight = painter.fontMetrics().lineSpacing();
+    int y = 10 + painter.fontMetrics().ascent();
+    for (const QString& line : lines) {
+        painter.drawText(10, y, line);
+        y += lineHeight;
+    }
 }
 
 void GLWidget::mousePressEvent(QMouseEvent* event)
@@ -433,7 +1169,10 @@ void GLWidget::mouseMoveEvent(QMouseEvent* event)
         rotationY += delta.x() * 0.5f;
         rotationX += delta.y() * 0.5f;
         lastMousePos = event->pos();
-        update();
+        sessionLog.record(SESSION_ROTATE, rotationX, rotationY);
+        // Событие только копит поворот: кадр (и перезапуск трассировки
+        // нового ракурса) - не чаще раза за обновление экрана
+        markDirty(LAYER_VIEW);
     }
 }
 
@@ -447,237 +1186,361 @@ void GLWidget::mouseReleaseEvent(QMouseEvent* event)
 
 void GLWidget::drawCoordinateAxes()
 {
-    glLineWidth(2.0f);
-    glBegin(GL_LINES);
-
-    glColor3f(1.0f, 0.0f, 0.0f);
-    glVertex3f(-10.0f, 0.0f, 0.0f);
-    glVertex3f(10.0f, 0.0f, 0.0f);
-
-    glColor3f(0.0f, 1.0f, 0.0f);
-    glVertex3f(0.0f, -10.0f, 0.0f);
-    glVertex3f(0.0f, 10.0f, 0.0f);
-
-    glColor3f(0.0f, 0.0f, 1.0f);
-    glVertex3f(0.0f, 0.0f, -10.0f);
-    glVertex3f(0.0f, 0.0f, 10.0f);
-
-    glEnd();
-    glLineWidth(1.0f);
+    axesBuffer.draw(renderer);
 }
 
 
 void GLWidget::drawControlPolygon()
 {
-    glLineWidth(1.0f);
-    glBegin(GL_LINES);
-    glColor3f(0.5f, 0.5f, 0.5f);
-    for (size_t i = 0; i < controlPoints.size() - 1; i++) {
-        glVertex3f(controlPoints[i].x, controlPoints[i].y, controlPoints[i].z);
-        glVertex3f(controlPoints[i + 1].x, controlPoints[i + 1].y, controlPoints[i + 1].z);
-    }
-    glEnd();
+    updateBezierBuffer();
+    bezierBuffer.bind();
+    bezierBuffer.drawRange(renderer, 1);
+    bezierBuffer.release();
 }
 
 void GLWidget::drawBezierCurve()
 {
-    glLineWidth(3.0f);
-    glBegin(GL_LINE_STRIP);
-    glColor3f(0.0f, 1.0f, 1.0f);
-    for (const auto& point : bezierCurve) {
-        glVertex3f(point.x, point.y, point.z);
-    }
-    glEnd();
-    glLineWidth(1.0f);
+    updateBezierBuffer();
+    bezierBuffer.bind();
+    bezierBuffer.drawRange(renderer, 2);
+    bezierBuffer.release();
 }
 
-void GLWidget::drawBSplineSurface()
+void GLWidget::updateBSplineBuffer()
 {
-    // Если поверхность не сгенерирована, генерируем её
-    if (bsplineControlNet.empty()) {
-        generateBSplineSurface();
-        return;
-    }
+    if (!takeBufferDirty(LAYER_SURFACE)) return;
+    const BSplineSnapshot* bspline = bsplineSnapshots.current();
+    if (!bspline) return;
+    ScopedTimer timer(profiler, "updateBSplineBuffer");
+
+    const std::vector<std::vector<Point3D>>& bsplineControlNet = bspline->controlNet;
+    const std::vector<Point3D>& bsplineSurface = bspline->surface;
 
-    // Рисуем контрольную сетку
-    glColor3f(1.0f, 0.0f, 0.0f);
-    glPointSize(6.0f);
-    glBegin(GL_POINTS);
+    std::vector<float> data;
+
+    // Контрольная сетка: точки
     for (const auto& row : bsplineControlNet) {
         for (const auto& point : row) {
-            glVertex3f(point.x, point.y, point.z);
+            appendColoredVertex(data, point, Point3D(1.0, 0.0, 0.0));
         }
     }
-    glEnd();
-
-    // Рисуем линии контрольной сетки
-    glColor3f(0.7f, 0.7f, 0.7f);
-    glLineWidth(1.5f);
-    glBegin(GL_LINES);
+    const int pointCount = int(data.size() / 6);
 
+    // Линии контрольной сетки
+    const Point3D netColor(0.7, 0.7, 0.7);
     // Горизонтальные линии
     for (size_t i = 0; i < bsplineControlNet.size(); i++) {
-        for (size_t j = 0; j < bsplineControlNet[i].size() - 1; j++) {
-            glVertex3f(bsplineControlNet[i][j].x, bsplineControlNet[i][j].y, bsplineControlNet[i][j].z);
-            glVertex3f(bsplineControlNet[i][j+1].x, bsplineControlNet[i][j+1].y, bsplineControlNet[i][j+1].z);
+        for (size_t j = 0; j + 1 < bsplineControlNet[i].size(); j++) {
+            appendColoredVertex(data, bsplineControlNet[i][j], netColor);
+            appendColoredVertex(data, bsplineControlNet[i][j + 1], netColor);
         }
     }
-
     // Вертикальные линии
     if (!bsplineControlNet.empty()) {
         for (size_t j = 0; j < bsplineControlNet[0].size(); j++) {
-            for (size_t i = 0; i < bsplineControlNet.size() - 1; i++) {
-                glVertex3f(bsplineControlNet[i][j].x, bsplineControlNet[i][j].y, bsplineControlNet[i][j].z);
-                glVertex3f(bsplineControlNet[i+1][j].x, bsplineControlNet[i+1][j].y, bsplineControlNet[i+1][j].z);
+            for (size_t i = 0; i + 1 < bsplineControlNet.size(); i++) {
+                appendColoredVertex(data, bsplineControlNet[i][j], netColor);
+                appendColoredVertex(data, bsplineControlNet[i + 1][j], netColor);
             }
         }
     }
-    glEnd();
-    glLineWidth(1.0f);
-
-    // Рисуем поверхность
-    if (!bsplineSurface.empty()) {
-        glColor3f(0.0f, 0.8f, 0.0f);
-        glBegin(GL_QUADS);
-        int divisions = 20;
-        for (int i = 0; i < divisions; i++) {
-            for (int j = 0; j < divisions; j++) {
-                int idx1 = i * (divisions + 1) + j;
-                int idx2 = i * (divisions + 1) + j + 1;
-                int idx3 = (i + 1) * (divisions + 1) + j + 1;
-                int idx4 = (i + 1) * (divisions + 1) + j;
-
-                if (idx1 < bsplineSurface.size() && idx2 < bsplineSurface.size() &&
-                    idx3 < bsplineSurface.size() && idx4 < bsplineSurface.size()) {
-                    // Добавляем небольшую нормаль для лучшего вида
-                    glVertex3f(bsplineSurface[idx1].x, bsplineSurface[idx1].y, bsplineSurface[idx1].z);
-                    glVertex3f(bsplineSurface[idx2].x, bsplineSurface[idx2].y, bsplineSurface[idx2].z);
-                    glVertex3f(bsplineSurface[idx3].x, bsplineSurface[idx3].y, bsplineSurface[idx3].z);
-                    glVertex3f(bsplineSurface[idx4].x, bsplineSurface[idx4].y, bsplineSurface[idx4].z);
-                }
+    const int netCount = int(data.size() / 6) - pointCount;
+
+    // Поверхность: каждый четырехугольник сетки - два треугольника
+    const Point3D surfaceColor(0.0, 0.8, 0.0);
+    const int divisions = bsplineSurfaceDivisions;
+    for (int i = 0; i < divisions; i++) {
+        for (int j = 0; j < divisions; j++) {
+            size_t idx1 = i * (divisions + 1) + j;
+            size_t idx2 = i * (divisions + 1) + j + 1;
+            size_t idx3 = (i + 1) * (divisions + 1) + j + 1;
+            size_t idx4 = (i + 1) * (divisions + 1) + j;
+            if (idx3 >= bsplineSurface.size()) continue;
+
+            for (size_t idx : {idx1, idx2, idx3, idx1, idx3, idx4}) {
+                appendColoredVertex(data, bsplineSurface[idx], surfaceColor);
             }
         }
-        glEnd();
     }
+    const int surfaceCount = int(data.size() / 6) - pointCount - netCount;
 
-    // Отображаем информацию о порядке
-    glColor3f(1.0f, 1.0f, 1.0f);
-    glBegin(GL_LINES);
     // Простые линии для демонстрации сложности
     for (int i = -3; i <= 3; i++) {
-        glVertex3f(i, -3, -2);
-        glVertex3f(i, 3, -2);
+        appendColoredVertex(data, Point3D(i, -3, -2), Point3D(1.0, 1.0, 1.0));
+        appendColoredVertex(data, Point3D(i, 3, -2), Point3D(1.0, 1.0, 1.0));
     }
-    glEnd();
+
+    bsplineBuffer.setColoredVertices(data);
+    bsplineBuffer.addRange(GL_POINTS, 0, pointCount, 6.0f);
+    bsplineBuffer.addRange(GL_LINES, pointCount, netCount, 1.5f);
+    bsplineBuffer.addRange(GL_TRIANGLES, pointCount + netCount, surfaceCount);
+    bsplineBuffer.addRange(GL_LINES, pointCount + netCount + surfaceCount, 14, 1.0f);
 }
 
-void GLWidget::drawLineClipping()
+void GLWidget::drawBSplineSurface()
 {
-    // Рисуем окно отсечения
-    glColor3f(0.0f, 1.0f, 1.0f);
-    glLineWidth(2.0f);
-    glBegin(GL_LINE_LOOP);
-    glVertex3f(clipLeft, clipBottom, 0);
-    glVertex3f(clipRight, clipBottom, 0);
-    glVertex3f(clipRight, clipTop, 0);
-    glVertex3f(clipLeft, clipTop, 0);
-    glEnd();
-
-    // Рисуем исходные отрезки (красные)
-    glColor3f(1.0f, 0.0f, 0.0f);
-    glLineWidth(1.0f);
-    glBegin(GL_LINES);
+    ScopedTimer timer(profiler, "drawBSplineSurface");
+
+    updateBSplineBuffer();
+    bsplineBuffer.draw(renderer);
+}
+
+void GLWidget::updateClippingBuffer()
+{
+    if (!takeBufferDirty(LAYER_CLIPPING)) return;
+    ScopedTimer timer(profiler, "updateClippingBuffer");
+
+    // До первого снимка - только окно
+    static const std::vector<Line> noLines;
+    const ClippingSnapshot* clipping = clippingSnapshots.current();
+    const std::vector<Line>& originalLines = clipping ? clipping->lines : noLines;
+    const std::vector<Line>& clippedLines = clipping ? clipping->clipped : noLines;
+
+    std::vector<float> data;
+
+    // Окно отсечения
+    const Point3D windowColor(0.0, 1.0, 1.0);
+    appendColoredVertex(data, Point3D(clipLeft, clipBottom, 0), windowColor);
+    appendColoredVertex(data, Point3D(clipRight, clipBottom, 0), windowColor);
+    appendColoredVertex(data, Point3D(clipRight, clipTop, 0), windowColor);
+    appendColoredVertex(data, Point3D(clipLeft, clipTop, 0), windowColor);
+
+    // Исходные отрезки (красные)
     for (const auto& line : originalLines) {
-        glVertex3f(line.start.x, line.start.y, 0);
-        glVertex3f(line.end.x, line.end.y, 0);
+        appendColoredVertex(data, Point3D(line.start.x, line.start.y, 0), Point3D(1.0, 0.0, 0.0));
+        appendColoredVertex(data, Point3D(line.end.x, line.end.y, 0), Point3D(1.0, 0.0, 0.0));
     }
-    glEnd();
 
-    // Рисуем отсеченные отрезки (зеленые)
-    glColor3f(0.0f, 1.0f, 0.0f);
-    glLineWidth(3.0f);
-    glBegin(GL_LINES);
+    // Отсеченные отрезки (зеленые)
     for (const auto& line : clippedLines) {
-        glVertex3f(line.start.x, line.start.y, 0);
-        glVertex3f(line.end.x, line.end.y, 0);
+        appendColoredVertex(data, Point3D(line.start.x, line.start.y, 0), Point3D(0.0, 1.0, 0.0));
+        appendColoredVertex(data, Point3D(line.end.x, line.end.y, 0), Point3D(0.0, 1.0, 0.0));
     }
-    glEnd();
-    glLineWidth(1.0f);
+
+    const int originalCount = int(originalLines.size() * 2);
+    clippingBuffer.setColoredVertices(data);
+    clippingBuffer.addRange(GL_LINE_LOOP, 0, 4, 2.0f);
+    clippingBuffer.addRange(GL_LINES, 4, originalCount, 1.0f);
+    clippingBuffer.addRange(GL_LINES, 4 + originalCount, int(clippedLines.size() * 2), 3.0f);
+}
+
+void GLWidget::drawLineClipping()
+{
+    ScopedTimer timer(profiler, "drawLineClipping");
+
+    updateClippingBuffer();
+    clippingBuffer.draw(renderer);
 }
 
 void GLWidget::drawZBuffer()
 {
-    // Рисуем многогранники с разной глубиной
-    std::vector<QColor> colors = {
-        QColor(255, 0, 0),    // Красный
-        QColor(0, 255, 0),    // Зеленый
-        QColor(0, 0, 255),    // Синий
-        QColor(255, 255, 0),  // Желтый
-        QColor(255, 0, 255),  // Пурпурный
-        QColor(0, 255, 255),  // Голубой
-        QColor(255, 165, 0),  // Оранжевый
-        QColor(128, 0, 128),  // Фиолетовый
-        QColor(165, 42, 42),  // Коричневый
-        QColor(0, 128, 0)     // Темно-зеленый
+    // Первая сцена еще строится
+    const ZBufferSnapshot* zbuffer = zbufferSnapshots.current();
+    if (!zbuffer) return;
+    const Scene& zbufferScene = zbuffer->scene;
+    const int zbufferPyramidMesh = zbuffer->pyramidMesh;
+
+    if (visibilityMode == VISIBILITY_BSP) {
+        drawZBufferBsp(zbufferScene);
+        return;
+    }
+    ScopedTimer timer(profiler, "drawZBuffer");
+
+    // Буферы GPU обновляются только при смене сцены
+    if (instancedRendererReady && instancedMeshVersion != zbufferScene.version) {
+        if (zbufferPyramidMesh >= 0) {
+            instancedRenderer.setMesh(zbufferScene.meshes[zbufferPyramidMesh]);
+        }
+        instancedMeshVersion = zbufferScene.version;
+    }
+    const bool instancing = instancedRendererReady && zbufferPyramidMesh >= 0;
+
+    // Проецируем вершины так же, как это делает OpenGL
+    float aspect = float(width()) / float(std::max(height(), 1));
+    ViewTransform view = ViewTransform::fromAngles(rotationX, rotationY, aspect);
+    hiZBuffer.resize(128, std::max(1, int(128 / aspect)));
+    hiZBuffer.clear();
+
+    // index - номер объекта в zbufferScene.objects
+    struct ObjectBounds {
+        size_t index;
+        size_t firstVertex;
+        double minDepth;
+        int minX, minY, maxX, maxY;
     };
+    const std::vector<SceneObject>& objects = zbufferScene.objects;
+    std::vector<ObjectBounds> bounds;
+    std::vector<Point3D> projected;
+    bounds.reserve(objects.size());
+
+    size_t vertexCount = 0;
+    for (const SceneObject& object : objects) {
+        if (object.shape == SceneObject::MESH) vertexCount += zbufferScene.meshes[object.mesh].vertices.size();
+    }
+    projected.reserve(vertexCount);
+
+    // Перенос и масштаб объекта применяются к вершинам его сетки
+    for (size_t i = 0; i < objects.size(); i++) {
+        const SceneObject& object = objects[i];
+        if (object.shape != SceneObject::MESH) continue;
+
+        const size_t firstVertex = projected.size();
+        double minX = 1e9, minY = 1e9, maxX = -1e9, maxY = -1e9, minDepth = 1.0;
+        for (const Point3D& vertex : zbufferScene.meshes[object.mesh].vertices) {
+            Point3D p = view.toNdc(object.transform.apply(vertex));
+            projected.push_back(p);
+            minX = std::min(minX, hiZBuffer.toPixelX(p.x));
+            maxX = std::max(maxX, hiZBuffer.toPixelX(p.x));
+            minY = std::min(minY, hiZBuffer.toPixelY(p.y));
+            maxY = std::max(maxY, hiZBuffer.toPixelY(p.y));
+            minDepth = std::min(minDepth, p.z);
+        }
+        bounds.push_back({i, firstVertex, minDepth,
+                          int(std::floor(minX)), int(std::floor(minY)),
+                          int(std::ceil(maxX)), int(std::ceil(maxY))});
+    }
+
+    // От ближних к дальним: закрытые объекты стоят одну проверку
+    std::sort(bounds.begin(), bounds.end(), [](const ObjectBounds& a, const ObjectBounds& b) {
+        return a.minDepth < b.minDepth;
+    });
+
+    // Видимые экземпляры пишутся прямо в отображенный буфер GPU
+    MeshInstance* instanceData = nullptr;
+    if (instancing) {
+        instanceData = instancedRenderer.mapInstances(int(objects.size()));
+    }
+    int visibleInstances = 0;
+    std::vector<size_t> visibleObjects; // Рисуются по одному
+
+    zbufferCulledCount = 0;
+    zbufferOutsideCount = 0;
+    for (const ObjectBounds& b : bounds) {
+        // Вне экрана - не заслонен, а просто не виден: считается отдельно
+        if (hiZBuffer.isOutside(b.minX, b.minY, b.maxX, b.maxY)) {
+            zbufferOutsideCount++;
+            continue;
+        }
+        if (hiZBuffer.isOccluded(b.minX, b.minY, b.maxX, b.maxY, b.minDepth)) {
+            zbufferCulledCount++;
+            continue;
+        }
+
+        const SceneObject& object = objects[b.index];
+        const IndexedMesh& mesh = zbufferScene.meshes[object.mesh];
+        const Point3D* ndc = &projected[b.firstVertex];
+        for (size_t k = 0; k + 2 < mesh.indices.size(); k += 3) {
+            hiZBuffer.rasterizeTriangle(ndc[mesh.indices[k]], ndc[mesh.indices[k + 1]],
+                                        ndc[mesh.indices[k + 2]]);
+        }
+        hiZBuffer.flushOccluder();
+
+        if (instanceData && object.mesh == zbufferPyramidMesh) {
+            const SceneTransform& t = object.transform;
+            const Point3D& color = zbufferScene.materials[object.material].albedo;
+            instanceData[visibleInstances++] = {float(t.translation.x), float(t.translation.y),
+                                                float(t.translation.z), float(t.scale),
+                                                float(color.x), float(color.y), float(color.z)};
+        } else {
+            visibleObjects.push_back(b.index);
+        }
+    }
+
+    if (instancing) {
+        instancedRenderer.unmapInstances(visibleInstances);
+
+        // Все видимые пирамиды - один вызов отрисовки; у инстансинга своя программа
+        instancedRenderer.draw(camera);
+        renderer.beginColored(camera);
+    }
+
+    // Остальные объекты - из буфера сетей сцены, загруженного при ее изменении
+    // По вертикали видно 16 единиц (ortho -8..8)
+    zbufferGeometry.draw(renderer, primitiveMeshes, zbufferScene, height() / 16.0, &visibleObjects);
+}
+
+void GLWidget::buildBspTree(const Scene& zbufferScene)
+{
+    ScopedTimer timer(profiler, "buildBspTree");
+
+    // Сцена статическая: дерево строится один раз на каждое изменение сцены
+    bspBuildFailed = !bspTree.build(makeBspTriangles(zbufferScene));
+    bspSceneVersion = zbufferScene.version;
+}
+
+void GLWidget::drawZBufferBsp(const Scene& zbufferScene)
+{
+    ScopedTimer timer(profiler, "drawZBufferBsp");
+
+    if (bspSceneVersion != zbufferScene.version) {
+        buildBspTree(zbufferScene);
+        bspBufferDirty = true;
+    }
 
-    for (size_t i = 0; i < zbufferObjects.size(); i++) {
-        const auto& object = zbufferObjects[i];
-        QColor color = colors[i % colors.size()];
-
-        glColor3f(color.redF(), color.greenF(), color.blueF());
-
-        // Рисуем основание пирамиды
-        glBegin(GL_QUADS);
-        glVertex3f(object[0].x, object[0].y, object[0].z);
-        glVertex3f(object[1].x, object[1].y, object[1].z);
-        glVertex3f(object[2].x, object[2].y, object[2].z);
-        glVertex3f(object[3].x, object[3].y, object[3].z);
-        glEnd();
-
-        // Рисуем боковые грани пирамиды
-        glBegin(GL_TRIANGLES);
-        // Грань 1
-        glVertex3f(object[0].x, object[0].y, object[0].z);
-        glVertex3f(object[1].x, object[1].y, object[1].z);
-        glVertex3f(object[4].x, object[4].y, object[4].z);
-        // Грань 2
-        glVertex3f(object[1].x, object[1].y, object[1].z);
-        glVertex3f(object[2].x, object[2].y, object[2].z);
-        glVertex3f(object[4].x, object[4].y, object[4].z);
-        // Грань 3
-        glVertex3f(object[2].x, object[2].y, object[2].z);
-        glVertex3f(object[3].x, object[3].y, object[3].z);
-        glVertex3f(object[4].x, object[4].y, object[4].z);
-        // Грань 4
-        glVertex3f(object[3].x, object[3].y, object[3].z);
-        glVertex3f(object[0].x, object[0].y, object[0].z);
-        glVertex3f(object[4].x, object[4].y, object[4].z);
-        glEnd();
+    float aspect = float(width()) / float(std::max(height(), 1));
+    ViewTransform view = ViewTransform::fromAngles(rotationX, rotationY, aspect);
+    const Point3D direction = view.viewDirection();
+
+    // Порядок от дальних к ближним заменяет буфер глубины; он зависит
+    // только от направления взгляда, поэтому без поворота буфер не меняется
+    if (bspBufferDirty || direction.x != bspViewDirection.x || direction.y != bspViewDirection.y ||
+        direction.z != bspViewDirection.z) {
+        bspVertexData.clear();
+        bspVertexData.reserve(bspTree.triangleCount() * 18);
+        bspTree.traverseBackToFront(direction, [this](const BspTriangle& t) {
+            for (int k = 0; k < 3; k++) {
+                bspVertexData.push_back(float(t.v[k].x));
+                bspVertexData.push_back(float(t.v[k].y));
+                bspVertexData.push_back(float(t.v[k].z));
+                bspVertexData.push_back(t.r);
+                bspVertexData.push_back(t.g);
+                bspVertexData.push_back(t.b);
+            }
+        });
+        bspBuffer.setColoredVertices(bspVertexData, QOpenGLBuffer::StreamDraw);
+        bspBuffer.addRange(GL_TRIANGLES, 0, int(bspVertexData.size() / 6));
+        bspViewDirection = direction;
+        bspBufferDirty = false;
     }
+
+    glDisable(GL_DEPTH_TEST);
+    bspBuffer.draw(renderer);
+    glEnable(GL_DEPTH_TEST);
 }
 
 void GLWidget::drawRayTracing()
 {
+    ScopedTimer timer(profiler, "drawRayTracing");
+
     // Очищаем сцену
     glClearColor(0.0f, 0.0f, 0.1f, 1.0f); // Темно-синий фон
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    // Рисуем "комнату" - стены и пол
-    drawRayTracingRoom();
-
-    // Рисуем объекты
-    drawRayTracingObjects();
+    // Пока нет ни одного прохода, показываем предпросмотр OpenGL
+    if (showRayTracedImage) {
+        requestRayTracedImage();
+        if (progressiveRenderer.takeImage(rayTracedImage, rayTracedProgress)) {
+            rayTracedTextureDirty = true;
+            const RtTileStats& stats = rayTracedProgress.tileStats;
+            frameBudget.addMeasurement(stats.samples, stats.rays, stats.shadowRays,
+                                       rayTracedProgress.settings.maxDepth, rayTracedProgress.passMilliseconds);
+        }
+    }
+    if (showRayTracedImage && !rayTracedImage.rgba.empty()) {
+        drawRayTracedImage();
+    } else if (const RayTracingSceneSnapshot* raySceneSnapshot = raySceneSnapshots.current()) {
+        // Комната и объекты - та же сцена, что у трассировщика
+        // По вертикали видно 16 единиц (ortho -8..8)
+        rayTracingGeometry.draw(renderer, primitiveMeshes, raySceneSnapshot->scene, height() / 16.0);
+    }
 
-    // Рисуем лучи в зависимости от качества
+    // Лучи в зависимости от качества и рамка уровня качества
     drawRays();
-
-    // Рисуем информацию о качестве
-    drawQualityInfo();
 }
 
 void GLWidget::initializeControlPoints()
 {
+    sessionLog.record(SESSION_RESET_POINTS);
     controlPoints.clear();
 
     // Для гладкой составной кривой Безье 3-й степени нужно:
@@ -704,323 +1567,143 @@ void GLWidget::initializeControlPoints()
 
     // Автоматически применяем условия гладкости
     applySmoothnessConditions();
+    emit controlPointCountChanged();
 }
 
 void GLWidget::applySmoothnessConditions()
 {
-    // Для C¹ непрерывности в точках соединения:
-    // P3 - P2 = P4 - P3 (для сегментов 1-2)
-    // P6 - P5 = P7 - P6 (для сегментов 2-3)
-
-    if (controlPoints.size() >= 7) {
-        // Сегмент 1-2: обеспечиваем коллинеарность P2-P3-P4
-        Point3D dir1 = {
-            controlPoints[2].x - controlPoints[3].x,
-            controlPoints[2].y - controlPoints[3].y,
-            controlPoints[2].z - controlPoints[3].z
-        };
-
-        // P4 должна лежать на продолжении P2-P3
-        controlPoints[4] = {
-            controlPoints[3].x - dir1.x,
-            controlPoints[3].y - dir1.y,
-            controlPoints[3].z - dir1.z
-        };
-    }
-
-    if (controlPoints.size() >= 10) {
-        // Сегмент 2-3: обеспечиваем коллинеарность P5-P6-P7
-        Point3D dir2 = {
-            controlPoints[5].x - controlPoints[6].x,
-            controlPoints[5].y - controlPoints[6].y,
-            controlPoints[5].z - controlPoints[6].z
-        };
-
-        // P7 должна лежать на продолжении P5-P6
-        controlPoints[7] = {
-            controlPoints[6].x - dir2.x,
-            controlPoints[6].y - dir2.y,
-            controlPoints[6].z - dir2.z
-        };
-    }
-
+    applyBezierSmoothness(controlPoints);
     calculateBezierCurve();
 }
 
-void GLWidget::drawRayTracingObjects()
-{
-    // Сфера (зеркальная)
-    glColor3f(1.0f, 1.0f, 1.0f);
-    glPushMatrix();
-    glTranslatef(-2, 0, -2);
-    drawSimpleSphere(1.0);
-    glPopMatrix();
-
-    // Куб (диффузный)
-    glColor3f(0.9f, 0.9f, 0.2f);
-    glPushMatrix();
-    glTranslatef(2, -1, -3);
-    drawSimpleCube(1.0);
-    glPopMatrix();
-
-    // Пирамида (стеклянная)
-    glColor3f(0.7f, 0.7f, 1.0f);
-    glPushMatrix();
-    glTranslatef(0, 2, -2);
-    drawPyramid(1.0);
-    glPopMatrix();
-
-    // Источник света (желтый)
-    glColor3f(1.0f, 1.0f, 0.5f);
-    glPushMatrix();
-    glTranslatef(0, 0, 4);
-    drawSimpleSphere(0.5);
-    glPopMatrix();
-}
-
-void GLWidget::drawRayTracingRoom()
-{
-    // Пол (зеленый)
-    glColor3f(0.2f, 0.6f, 0.2f);
-    glBegin(GL_QUADS);
-    glVertex3f(-5, -5, -5);
-    glVertex3f(5, -5, -5);
-    glVertex3f(5, 5, -5);
-    glVertex3f(-5, 5, -5);
-    glEnd();
-
-    // Задняя стена (синяя)
-    glColor3f(0.2f, 0.2f, 0.8f);
-    glBegin(GL_QUADS);
-    glVertex3f(-5, -5, -5);
-    glVertex3f(-5, -5, 5);
-    glVertex3f(-5, 5, 5);
-    glVertex3f(-5, 5, -5);
-    glEnd();
-
-    // Правая стена (красная)
-    glColor3f(0.8f, 0.2f, 0.2f);
-    glBegin(GL_QUADS);
-    glVertex3f(-5, -5, -5);
-    glVertex3f(5, -5, -5);
-    glVertex3f(5, -5, 5);
-    glVertex3f(-5, -5, 5);
-    glEnd();
-}
 void GLWidget::drawRays()
 {
-    if (!showRays) return;
-
-    // Рисуем лучи разными цветами в зависимости от качества
-    for (size_t i = 0; i < rays.size(); i += 2) {
-        if (i + 1 >= rays.size()) break;
-
-        // Разный цвет лучей в зависимости от качества
-        switch(rayTracingQuality) {
-        case 1: glColor3f(1.0f, 0.0f, 0.0f); break; // Красный - низкое качество
-        case 2: glColor3f(1.0f, 1.0f, 0.0f); break; // Желтый - среднее качество
-        case 3: glColor3f(0.0f, 1.0f, 0.0f); break; // Зеленый - хорошее качество
-        case 4: glColor3f(0.0f, 1.0f, 1.0f); break; // Голубой - высокое качество
-        case 5: glColor3f(1.0f, 0.0f, 1.0f); break; // Пурпурный - максимальное качество
-        default: glColor3f(1.0f, 1.0f, 1.0f);
-        }
-
-        // Тонкие линии для лучей
-        glLineWidth(1.0f);
-        glBegin(GL_LINES);
-        glVertex3f(rays[i].x, rays[i].y, rays[i].z);
-        glVertex3f(rays[i+1].x, rays[i+1].y, rays[i+1].z);
-        glEnd();
-
-        // Точки попадания (только для высокого качества)
-        if (rayTracingQuality >= 3) {
-            glPointSize(3.0f);
-            glBegin(GL_POINTS);
-            size_t hitIndex = i / 2;
-            if (hitIndex < rayHits.size()) {
-                // Разный цвет точек в зависимости от поверхности
-                if (rayHits[hitIndex].z < -2) glColor3f(0.2f, 0.8f, 0.2f); // Пол
-                else if (rayHits[hitIndex].x < -3) glColor3f(0.2f, 0.2f, 0.8f); // Стена
-                else glColor3f(0.8f, 0.8f, 0.2f); // Объекты
-                glVertex3f(rayHits[hitIndex].x, rayHits[hitIndex].y, rayHits[hitIndex].z);
-            }
-            glEnd();
-        }
+    ScopedTimer timer(profiler, "drawRays");
+
+    const RayVisualizationSnapshot* rays = raySnapshots.current();
+    if (!rays) return;
+
+    // Буфер загружается один раз после генерации
+    if (takeBufferDirty(LAYER_RAYS)) {
+        const int lines = rays->lineVertices;
+        const int hits = rays->hitVertices;
+        const int reflections = rays->reflectionVertices;
+        rayBuffer.setColoredVertices(rays->vertexData);
+        rayBuffer.addRange(GL_LINES, 0, lines, 1.0f);
+        rayBuffer.addRange(GL_POINTS, lines, hits, 3.0f);
+        rayBuffer.addRange(GL_LINES, lines + hits, reflections, 0.5f);
+        rayBuffer.addRange(GL_LINES, lines + hits + reflections, rays->qualityInfoVertices, 2.0f);
+    }
 
-        // Отраженные лучи (только для максимального качества)
-        if (rayTracingQuality >= 4) {
-            glColor3f(0.5f, 0.5f, 1.0f);
-            glLineWidth(0.5f);
-            glBegin(GL_LINES);
-            for (size_t j = 0; j < rayHits.size() && j < 5; j++) {
-                if (i/2 == j) {
-                    Point3D hit = rayHits[j];
-                    // Простое "отражение"
-                    Point3D reflection(
-                        hit.x + (rand() % 100 - 50) * 0.1,
-                        hit.y + (rand() % 100 - 50) * 0.1,
-                        hit.z + abs(rand() % 100 - 50) * 0.1
-                        );
-                    glVertex3f(hit.x, hit.y, hit.z);
-                    glVertex3f(reflection.x, reflection.y, reflection.z);
-                }
-            }
-            glEnd();
+    rayBuffer.bind();
+    if (showRays) {
+        for (int range = 0; range < 3; range++) {
+            rayBuffer.drawRange(renderer, range);
         }
     }
+    rayBuffer.drawRange(renderer, 3);
+    rayBuffer.release();
 }
 
-void GLWidget::drawTorus(double R, double r)
+// Обновляем renderRayTracing
+void GLWidget::renderRayTracing()
 {
-    // Простая реализация тора
-    const int segments = 20;
-    const int sides = 12;
-
-    for (int i = 0; i < segments; i++) {
-        double theta1 = i * 2 * M_PI / segments;
-        double theta2 = (i + 1) * 2 * M_PI / segments;
-
-        glBegin(GL_QUAD_STRIP);
-        for (int j = 0; j <= sides; j++) {
-            double phi = j * 2 * M_PI / sides;
-
-            for (int k = 0; k < 2; k++) {
-                double theta = (k == 0) ? theta1 : theta2;
-                double x = (R + r * cos(phi)) * cos(theta);
-                double y = (R + r * cos(phi)) * sin(theta);
-                double z = r * sin(phi);
-
-                glVertex3f(x, y, z);
-            }
-        }
-        glEnd();
-    }
+    // Регенерируем сцену с новыми случайными лучами
+    sessionLog.record(SESSION_RENDER_RAY_TRACING);
+    rayTracedImageDirty = true;
+    rayVisualizationGeneration++;
+    generateRayTracingScene();
 }
-void GLWidget::drawPyramid(double size)
-{
-    double s = size;
-    glBegin(GL_TRIANGLES);
-    // Основание
-    glVertex3f(-s, -s, 0);
-    glVertex3f(s, -s, 0);
-    glVertex3f(s, s, 0);
-    glVertex3f(-s, -s, 0);
-    glVertex3f(s, s, 0);
-    glVertex3f(-s, s, 0);
-
-    // Боковые грани
-    glVertex3f(-s, -s, 0);
-    glVertex3f(0, 0, s*2);
-    glVertex3f(s, -s, 0);
-
-    glVertex3f(s, -s, 0);
-    glVertex3f(0, 0, s*2);
-    glVertex3f(s, s, 0);
 
-    glVertex3f(s, s, 0);
-    glVertex3f(0, 0, s*2);
-    glVertex3f(-s, s, 0);
+void GLWidget::requestRayTracedImage()
+{
+    // Сцена еще строится: накопление начнется, когда она станет текущей
+    const std::shared_ptr<const RayTracingSceneSnapshot> scene = raySceneSnapshots.currentShared();
+    if (!scene) return;
+
+    const bool budgeted = frameBudget.budget() > 0;
+    bool stale = rayTracedImageDirty || size() != requestedViewport ||
+                 rotationX != requestedRotationX || rotationY != requestedRotationY;
+
+    RtSettings settings = requestedSettings;
+    if (budgeted) {
+        // Настройки подбираются только при новом ракурсе: иначе каждое
+        // уточнение оценки скорости перезапускало бы накопление
+        if (!stale) return;
+        settings = frameBudget.choose(std::max(width(), 1), std::max(height(), 1));
+    } else {
+        // Половинное разрешение окна
+        settings = rayTracingSettingsForQuality(rayTracingQuality,
+                                                std::max(width() / 2, 1),
+                                                std::max(height() / 2, 1));
+        stale = stale ||
+                settings.width != requestedSettings.width ||
+                settings.height != requestedSettings.height ||
+                settings.samplesPerPixel != requestedSettings.samplesPerPixel ||
+                settings.maxDepth != requestedSettings.maxDepth;
+        if (!stale) return;
+    }
 
-    glVertex3f(-s, s, 0);
-    glVertex3f(0, 0, s*2);
-    glVertex3f(-s, -s, 0);
-    glEnd();
+    settings.seed = randomStreams.split(RANDOM_STREAM_PATH_TRACING).seed();
+    double aspect = double(width()) / double(std::max(height(), 1));
+    // Рендер держит снимок через трассировщик, пока идет его проход
+    progressiveRenderer.restart(std::shared_ptr<const RayTracer>(scene, &scene->tracer), settings,
+                                ViewTransform::fromAngles(rotationX, rotationY, aspect), budgeted);
+
+    requestedSettings = settings;
+    requestedRotationX = rotationX;
+    requestedRotationY = rotationY;
+    requestedViewport = size();
+    rayTracedImageDirty = false;
 }
 
-void GLWidget::drawSimpleSphere(double radius)
+void GLWidget::drawTileTimings()
 {
-    const int slices = 12;
-    const int stacks = 12;
-
-    for (int i = 0; i < slices; i++) {
-        double theta1 = i * 2 * M_PI / slices;
-        double theta2 = (i + 1) * 2 * M_PI / slices;
-
-        glBegin(GL_QUAD_STRIP);
-        for (int j = 0; j <= stacks; j++) {
-            double phi = j * M_PI / stacks;
-            double x1 = radius * sin(phi) * cos(theta1);
-            double y1 = radius * sin(phi) * sin(theta1);
-            double z1 = radius * cos(phi);
-
-            double x2 = radius * sin(phi) * cos(theta2);
-            double y2 = radius * sin(phi) * sin(theta2);
-            double z2 = radius * cos(phi);
-
-            glVertex3f(x1, y1, z1);
-            glVertex3f(x2, y2, z2);
+    const RtTileStats& stats = rayTracedProgress.tileStats;
+    if (stats.tileMilliseconds.empty()) return;
+
+    float slowest = *std::max_element(stats.tileMilliseconds.begin(), stats.tileMilliseconds.end());
+    if (slowest <= 0) return;
+
+    // Тепловая карта: чем дольше считалась плитка, тем она краснее
+    QPainter painter(this);
+    const double scaleX = double(width()) / rayTracedProgress.settings.width;
+    const double scaleY = double(height()) / rayTracedProgress.settings.height;
+    for (int ty = 0; ty < stats.tilesY; ty++) {
+        for (int tx = 0; tx < stats.tilesX; tx++) {
+            float ms = stats.tileMilliseconds[size_t(ty) * stats.tilesX + tx];
+            // Строка 0 изображения - нижняя, у QPainter - верхняя
+            QRectF rect(tx * stats.tileSize * scaleX,
+                        height() - (ty + 1) * stats.tileSize * scaleY,
+                        stats.tileSize * scaleX,
+                        stats.tileSize * scaleY);
+            painter.fillRect(rect, QColor(255, 0, 0, int(180 * ms / slowest)));
         }
-        glEnd();
     }
 }
 
-void GLWidget::drawSimpleCube(double size)
+void GLWidget::drawRayTracedImage()
 {
-    double s = size / 2.0;
-
-    glBegin(GL_QUADS);
-    // Передняя грань
-    glVertex3f(-s, -s, s);
-    glVertex3f(s, -s, s);
-    glVertex3f(s, s, s);
-    glVertex3f(-s, s, s);
-
-    // Задняя грань
-    glVertex3f(-s, -s, -s);
-    glVertex3f(-s, s, -s);
-    glVertex3f(s, s, -s);
-    glVertex3f(s, -s, -s);
-
-    // Верхняя грань
-    glVertex3f(-s, s, -s);
-    glVertex3f(-s, s, s);
-    glVertex3f(s, s, s);
-    glVertex3f(s, s, -s);
-
-    // Нижняя грань
-    glVertex3f(-s, -s, -s);
-    glVertex3f(s, -s, -s);
-    glVertex3f(s, -s, s);
-    glVertex3f(-s, -s, s);
-
-    // Правая грань
-    glVertex3f(s, -s, -s);
-    glVertex3f(s, s, -s);
-    glVertex3f(s, s, s);
-    glVertex3f(s, -s, s);
-
-    // Левая грань
-    glVertex3f(-s, -s, -s);
-    glVertex3f(-s, -s, s);
-    glVertex3f(-s, s, s);
-    glVertex3f(-s, s, -s);
-    glEnd();
-}
-
-void GLWidget::drawQualityInfo()
-{
-    // Рисуем информационный текст (простыми линиями)
-    glColor3f(1.0f, 1.0f, 1.0f);
-    glLineWidth(2.0f);
-    glBegin(GL_LINES);
-
-    // Рамка информации
-    glVertex3f(3, 3, 0); glVertex3f(4.5, 3, 0);
-    glVertex3f(4.5, 3, 0); glVertex3f(4.5, 4, 0);
-    glVertex3f(4.5, 4, 0); glVertex3f(3, 4, 0);
-    glVertex3f(3, 4, 0); glVertex3f(3, 3, 0);
-
-    // Текст "Качество: X"
-    for (int i = 0; i < rayTracingQuality; i++) {
-        glVertex3f(3.2 + i * 0.3, 3.3, 0);
-        glVertex3f(3.2 + i * 0.3, 3.7, 0);
+    if (rayTracedImage.rgba.empty()) return;
+
+    if (!rayTracedTexture) {
+        glGenTextures(1, &rayTracedTexture);
+        glBindTexture(GL_TEXTURE_2D, rayTracedTexture);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D, rayTracedTexture);
+    if (rayTracedTextureDirty) {
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, rayTracedImage.width, rayTracedImage.height, 0,
+                     GL_RGBA, GL_UNSIGNED_BYTE, rayTracedImage.rgba.data());
+        rayTracedTextureDirty = false;
     }
-    glEnd();
-}
 
-// Обновляем renderRayTracing
-void GLWidget::renderRayTracing()
-{
-    // Регенерируем сцену с новыми случайными лучами
-    generateRayTracingScene();
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Изображение на весь экран своей программой; лучи и рамка качества рисуются поверх
+    renderer.drawFullscreenTexture(rayTracedTexture);
+    renderer.beginColored(camera);
 }
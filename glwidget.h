@@ -2,21 +2,26 @@
 #define GLWIDGET_H
 
 #include <QOpenGLWidget>
-#include <QOpenGLFunctions>
+#include <QOpenGLExtraFunctions>
+#include <QMatrix4x4>
+#include <QElapsedTimer>
+#include <QStringList>
 #include <vector>
+#include "geometry.h"
+#include "hizbuffer.h"
+#include "mesh.h"
+#include "scene.h"
+#include "instancedmeshrenderer.h"
+#include "glrenderer.h"
+#include "bsptree.h"
+#include "raytracer.h"
+#include "progressiverenderer.h"
+#include "framebudget.h"
+#include "profiler.h"
+#include "sessionlog.h"
+#include "jobsystem.h"
 
-struct Point3D {
-    double x, y, z;
-    Point3D(double x = 0, double y = 0, double z = 0) : x(x), y(y), z(z) {}
-};
-
-struct Line {
-    Point3D start, end;
-    bool visible;
-    Line(Point3D s, Point3D e, bool v = true) : start(s), end(e), visible(v) {}
-};
-
-class GLWidget : public QOpenGLWidget, protected QOpenGLFunctions
+class GLWidget : public QOpenGLWidget, protected QOpenGLExtraFunctions
 {
     Q_OBJECT
 
@@ -29,19 +34,81 @@ public:
         RAY_TRACING
     };
 
+    // Метод определения видимости в теме Z-буфера
+    enum VisibilityMode {
+        VISIBILITY_ZBUFFER,
+        VISIBILITY_BSP
+    };
+
     GLWidget(QWidget* parent = nullptr);
+    ~GLWidget();
 
     void initializeControlPoints();
     void calculateBezierCurve();
     void updateControlPoint(int index, double x, double y, double z);
+    // Одна координата (axis: 0 - X, 1 - Y, 2 - Z): гладкость и кривая
+    // пересчитываются только вокруг точки
+    void updateControlPointCoordinate(int index, int axis, double value);
+    // Точки first, first + 1, ... (за концом массива - добавляются)
+    // одним пакетом
+    void updateControlPoints(int first, const std::vector<Point3D>& points);
+    // Правки между begin и end копятся: затем один проход условий
+    // гладкости и один пересчет кривой. Пакеты могут быть вложенными
+    void beginControlPointUpdate();
+    void endControlPointUpdate();
     std::vector<Point3D> getControlPoints() const;
+    size_t controlPointCount() const { return controlPoints.size(); }
+    // Массив точек для таблицы без копирования. После записи в него
+    // точка применяется через updateControlPoint
+    std::vector<Point3D>* controlPointStorage() { return &controlPoints; }
     void setShowControlPolygon(bool show);
     void setCurrentTheme(Theme theme);
 
     void setBSplineOrder(int order);
     void setClippingWindow(double left, double right, double bottom, double top);
     void setZBufferObjectsCount(int count);
+    // Модель читается в фоне и заменяет сцену, когда готова; ошибка
+    // чтения - сигнал zbufferModelLoadFailed
+    void loadZBufferModel(const QString& fileName);
+    void setVisibilityMode(VisibilityMode mode);
     void setRayTracingQuality(int quality);
+    void setShowRayTracedImage(bool show);
+    void setShowTileTimings(bool show);
+    // Бюджет кадра трассировки в мс; 0 - качество задает setRayTracingQuality
+    void setFrameBudget(double milliseconds);
+    // Число показываемых лучей; 0 - по уровню качества
+    void setRayVisualizationCount(int count);
+    // Seed всех случайных генераторов (отрезки, сцена Z-буфера, лучи,
+    // выборки трассировки); сцены генерируются заново
+    void setRandomSeed(uint64_t seed);
+    // Данные тем, которые еще не показывались, начинают строиться в фоне
+    // после первого кадра; без этого - при первом показе темы
+    void setThemePrewarm(bool enabled);
+    // Ждет фоновые пересчеты: следующий кадр покажет их результат
+    // (headless-замеры, повтор сеанса)
+    void waitForJobs();
+    // Углы камеры в градусах, как при вращении мышью
+    void setViewRotation(float x, float y);
+    // false - контекст не поддерживает OpenGL 3.3 core profile
+    bool isRendererReady() const { return rendererReady; }
+    // Замеры стадий кадра, showOverlay - сводка и гистограмма поверх сцены;
+    // включение начинает журнал заново
+    void setProfilingEnabled(bool enabled, bool showOverlay = true);
+    std::vector<Profiler::StageStats> profileStages() const;
+    // Время кадра на GPU запросами GL_TIME_ELAPSED (стадия "gpuFrame")
+    void setGpuTimers(bool enabled);
+    // Журнал замеров в формате Chrome trace
+    bool exportTrace(const QString& fileName, QString* error = nullptr);
+
+    // Запись сеанса: действия пишутся в журнал методами выше и мышью.
+    // Начало записи сохраняет текущее состояние событиями в начале журнала
+    void startSessionRecording();
+    void stopSessionRecording();
+    bool isSessionRecording() const { return sessionLog.isRecording(); }
+    bool saveSession(const QString& fileName, QString* error = nullptr) const;
+    // Повторяет действие из журнала; ошибка загрузки модели приходит
+    // сигналом zbufferModelLoadFailed
+    void applySessionEvent(const SessionEvent& event);
 
 public slots:
     void generateBSplineSurface();
@@ -50,6 +117,12 @@ public slots:
     void generateZBufferScene();
     void renderRayTracing();
 
+signals:
+    // Точки first..last изменены (правкой или условиями гладкости)
+    void controlPointsChanged(int first, int last);
+    void controlPointCountChanged();
+    void zbufferModelLoadFailed(const QString& fileName, const QString& error);
+
 protected:
     void initializeGL() override;
     void resizeGL(int w, int h) override;
@@ -59,6 +132,30 @@ protected:
     void mouseReleaseEvent(QMouseEvent* event) override;
 
 private:
+    // Слои кадра. Изменение данных помечает свой слой: буфер GPU слоя
+    // перестраивается при следующей отрисовке, а перерисовка планируется,
+    // только если слой виден в текущей теме
+    enum Layer : unsigned {
+        LAYER_VIEW = 1u << 0,             // Камера, размер, тема, видимость слоев
+        LAYER_CONTROL_POLYGON = 1u << 1,  // Контрольные точки и многоугольник Безье
+        LAYER_CURVE = 1u << 2,            // Кривая Безье
+        LAYER_SURFACE = 1u << 3,          // Контрольная сетка и поверхность B-spline
+        LAYER_CLIPPING = 1u << 4,         // Окно и отрезки
+        LAYER_ZBUFFER = 1u << 5,          // Сцена темы Z-буфера
+        LAYER_RAYS = 1u << 6,             // Визуализация лучей и рамка качества
+        LAYER_RAY_TRACED_IMAGE = 1u << 7  // Новый проход трассировки
+    };
+    void markDirty(unsigned layers);
+    unsigned themeLayers(Theme theme) const;
+    // Не больше одной перерисовки за период обновления экрана
+    void scheduleFrame();
+    // Проверяет и снимает пометку буфера слоя
+    bool takeBufferDirty(unsigned layers);
+
+    // Геометрия тем загружается в буферы GPU только после изменения
+    void updateBezierBuffer();
+    void updateBSplineBuffer();
+    void updateClippingBuffer();
     void drawCoordinateAxes();
     void drawControlPoints();
     void drawControlPolygon();
@@ -66,44 +163,185 @@ private:
     void drawBSplineSurface();
     void drawLineClipping();
     void drawZBuffer();
+    void drawZBufferBsp(const Scene& zbufferScene);
+    void buildBspTree(const Scene& zbufferScene);
     void drawRayTracing();
-    Point3D calculateBezierPoint(int startIndex, double t);
     void applySmoothnessConditions();
-    // Вспомогательные методы
-    void drawSimpleSphere(double radius);
-    void drawSimpleCube(double size);
-    void drawPyramid(double size);
-    void drawTorus(double R, double r);
+    void controlPointsEdited(size_t first, size_t last, bool resized);
+    void applyControlPointEdits(size_t first, size_t last, bool resized);
+    // Поверхность текущего порядка; generateBSplineSurface - она же,
+    // записанная в журнал сеанса как нажатие кнопки. Так же для отрезков
+    // и сцены Z-буфера. Пересчет ставится задачей в фон
+    void buildBSplineSurface();
+    void buildLines();
+    void submitLinesJob(bool clip);
+    void buildZBufferScene();
+    // Загрузка без записи в журнал; при ошибке сцена previousModelFile строится заново
+    void submitZBufferModel(const QString& fileName, const QString& previousModelFile);
+    void buildRayTracingScene();
 
-    // Методы для отсечения отрезков
-    bool isPointInsideWindow(double x, double y);
-    int computeRegionCode(double x, double y);
+    // Данные темы строятся при первом показе (setCurrentTheme, paintGL), а не
+    // в конструкторе: запуск окна не растет с размерами сцен
+    void ensureThemeData(Theme theme);
+    bool isThemeBuilt(Theme theme) const { return builtThemes & (1u << theme); }
+    void startThemePrewarm();
+    // Из потока задачи: снимок опубликован, нужен кадр
+    void snapshotPublished(unsigned layers);
+    // Начало кадра: новые снимки задач становятся текущими; true - новая
+    // сцена трассировки поставила задачу лучей
+    bool acquireSnapshots();
 
     // Методы для трассировки лучей
     void generateRayTracingScene();
-    void drawRayTracingRoom();
-    void drawRayTracingObjects();
     void drawRays();
-    void drawQualityInfo();
+    void requestRayTracedImage();
+    void drawRayTracedImage();
+    void drawTileTimings();
+
+    // Текстовая информация поверх сцены
+    void drawOverlay(const QStringList& lines);
+
+    // Профилирование: сводка стадий в overlay и гистограмма времени кадра
+    void appendProfilerOverlay(QStringList& overlay) const;
+    void drawProfilerHistogram();
+    // Запрос таймера охватывает кадр; результат читается кадром-двумя позже,
+    // когда готов, чтобы не ждать GPU
+    void beginGpuTimer();
+    void endGpuTimer();
+
+    // Шейдеры и постоянные буферы тем; camera - матрица текущего кадра
+    GLRenderer renderer;
+    bool rendererReady;
+    QMatrix4x4 camera;
+    GeometryBuffer axesBuffer;
+    GeometryBuffer bezierBuffer;      // Точки, контрольный многоугольник, кривая
+    GeometryBuffer bsplineBuffer;     // Точки и линии сетки, поверхность, линии порядка
+    GeometryBuffer clippingBuffer;    // Окно, исходные и отсеченные отрезки
+    GeometryBuffer bspBuffer;         // Треугольники в порядке обхода BSP
+    Point3D bspViewDirection;         // Ракурс, для которого построен bspBuffer
+    bool bspBufferDirty;
+    PrimitiveMeshCache primitiveMeshes; // Сферы и кубы всех сцен
+    SceneGeometry zbufferGeometry;
+    SceneGeometry rayTracingGeometry;
+
+    // Планировщик кадров: bufferDirtyLayers - чьи буферы GPU нужно перестроить
+    unsigned bufferDirtyLayers;
+    bool frameScheduled;
+    QElapsedTimer lastFrameTimer;
+
+    // Профилировщик стадий; пишут и поток интерфейса, и ProgressiveRenderer
+    static const int gpuTimerQueryCount = 3;
+    Profiler profiler;
+    bool showProfilerOverlay;
+    bool gpuTimers;
+    GLuint gpuTimerQueries[gpuTimerQueryCount];
+    bool gpuTimerPending[gpuTimerQueryCount];
+    int gpuTimerNext;
+    bool gpuTimerActive;
+
+    // Случайные генераторы: поток генератора - split(RandomStreamId),
+    // очередная генерация - split(номер генерации)
+    RandomStreams randomStreams;
+    uint64_t linesGeneration;
+    uint64_t zbufferGeneration;
+
+    SessionLog sessionLog;
+
+    // Отложенное построение тем
+    static const int themeCount = RAY_TRACING + 1;
+    unsigned builtThemes;         // Бит 1 << Theme - данные темы построены или строятся в фоне;
+                                  // загруженная модель Z-буфера - только после публикации
+    bool themePrewarmEnabled;
+    bool themePrewarmStarted;
+
+    // Фоновые пересчеты: по каналу на данные темы. Задача строит снимок по
+    // параметрам, снятым при постановке, и публикует его; paintGL забирает
+    // снимки в начале кадра (acquireSnapshots) и рисует из них без блокировок
+    enum JobChannel {
+        JOB_BSPLINE,
+        JOB_CLIPPING,
+        JOB_ZBUFFER,
+        JOB_RAY_SCENE,
+        JOB_RAY_VISUALIZATION,
+        jobChannelCount
+    };
+    struct BSplineSnapshot {
+        std::vector<std::vector<Point3D>> controlNet;
+        std::vector<Point3D> surface;
+    };
+    struct ClippingSnapshot {
+        uint64_t linesSeed = 0;   // Поток генератора отрезков: seed и номер генерации
+        std::vector<Line> lines;
+        std::vector<Line> clipped;
+    };
+    struct ZBufferSnapshot {
+        Scene scene;              // Сгенерированные пирамиды или загруженная модель
+        int pyramidMesh = -1;     // Сетка, объекты которой рисуются инстансингом; -1 - нет
+    };
+    // Сцена и собственный трассировщик (BVH строится в задаче). Снимок не
+    // перемещается после публикации, поэтому трассировщик ссылается на его
+    // сцену; прогрессивный рендер и задача лучей держат снимок, пока читают
+    struct RayTracingSceneSnapshot {
+        Scene scene;
+        RayTracer tracer;
+    };
+    // Визуализация лучей, x, y, z, r, g, b: подряд лучи (GL_LINES), точки
+    // попадания (GL_POINTS), отраженные лучи (GL_LINES) и рамка уровня
+    // качества (GL_LINES)
+    struct RayVisualizationSnapshot {
+        std::vector<float> vertexData;
+        int lineVertices = 0, hitVertices = 0, reflectionVertices = 0, qualityInfoVertices = 0;
+    };
+    SnapshotBuffer<BSplineSnapshot> bsplineSnapshots;
+    SnapshotBuffer<ClippingSnapshot> clippingSnapshots;
+    SnapshotBuffer<ZBufferSnapshot> zbufferSnapshots;
+    SnapshotBuffer<RayTracingSceneSnapshot> raySceneSnapshots;
+    SnapshotBuffer<RayVisualizationSnapshot> raySnapshots;
+    JobSystem jobs;
 
     // Данные для разных тем
     std::vector<Point3D> controlPoints;
+    // Открытый пакет правок точек: глубина и затронутые точки
+    int controlPointBatchDepth;
+    size_t controlPointBatchFirst, controlPointBatchLast;
+    bool controlPointBatchResized;
     std::vector<Point3D> bezierCurve;
 
-    // B-spline данные
-    std::vector<std::vector<Point3D>> bsplineControlNet;
-    std::vector<Point3D> bsplineSurface;
-
-    // Line clipping данные
-    std::vector<Line> originalLines;
-    std::vector<Line> clippedLines;
+    // B-spline, отсечение, Z-буфер: данные - в снимках задач
+    bool linesClipped;            // Отсечение выполнено для текущих отрезков
 
     // Z-buffer данные
-    std::vector<std::vector<Point3D>> zbufferObjects;
+    QString zbufferModelFile;     // Загруженная модель; пусто - пирамиды
+    InstancedMeshRenderer instancedRenderer;
+    bool instancedRendererReady;
+    uint64_t instancedMeshVersion; // Версия сцены, сетка которой загружена в instancedRenderer
+    VisibilityMode visibilityMode;
+    BspTree bspTree;
+    uint64_t bspSceneVersion;     // Версия сцены, по которой построено bspTree
+    bool bspBuildFailed;
+    std::vector<float> bspVertexData; // x, y, z, r, g, b в порядке обхода
+    HiZBuffer hiZBuffer;
+    int zbufferCulledCount;       // Закрыты другими объектами (Hi-Z)
+    int zbufferOutsideCount;      // Целиком вне экрана
 
-    // Данные для трассировки лучей
-    std::vector<Point3D> rays;
-    std::vector<Point3D> rayHits;
+    // Данные для трассировки лучей; сцена, трассировщик и визуализация
+    // лучей - в снимках задач
+    GeometryBuffer rayBuffer;
+    uint64_t rayVisualizationGeneration;
+    int rayVisualizationCount;    // 0 - по уровню качества
+    ThreadPool rayTracingPool;
+    ProgressiveRenderer progressiveRenderer;  // Объявлен после пула - разрушается раньше него
+    RtProgress rayTracedProgress;
+    bool showTileTimings;
+    RtImage rayTracedImage;
+    GLuint rayTracedTexture;
+    bool rayTracedImageDirty;     // Накопление нужно начать заново
+    bool rayTracedTextureDirty;   // Изображение не загружено в текстуру
+    bool showRayTracedImage;
+    RtSettings requestedSettings;
+    float requestedRotationX, requestedRotationY;
+    QSize requestedViewport;
+    FrameBudget frameBudget;
 
     float rotationX, rotationY;
     QPoint lastMousePos;
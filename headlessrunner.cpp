@@ -0,0 +1,365 @@
+#include "headlessrunner.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QImage>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+struct ThemeName {
+    const char* name;
+    GLWidget::Theme theme;
+};
+
+const ThemeName themeNames[] = {
+    {"bezier", GLWidget::BEZIER_CURVE},
+    {"bspline", GLWidget::BSPLINE_SURFACE},
+    {"clipping", GLWidget::LINE_CLIPPING},
+    {"zbuffer", GLWidget::ZBUFFER},
+    {"raytracing", GLWidget::RAY_TRACING}
+};
+
+// Тема по имени или номеру 1..5, как в списке тем окна
+bool parseTheme(const QString& value, GLWidget::Theme& theme)
+{
+    for (size_t i = 0; i < sizeof(themeNames) / sizeof(themeNames[0]); i++) {
+        if (value == themeNames[i].name || value == QString::number(int(i) + 1)) {
+            theme = themeNames[i].theme;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char* themeName(GLWidget::Theme theme)
+{
+    for (const ThemeName& entry : themeNames) {
+        if (entry.theme == theme) return entry.name;
+    }
+    return "?";
+}
+
+// Пара чисел "a<separator>b"
+bool parsePair(const QString& value, QChar separator, double& a, double& b)
+{
+    const QStringList parts = value.split(separator);
+    if (parts.size() != 2) return false;
+    bool okA = false, okB = false;
+    a = parts[0].toDouble(&okA);
+    b = parts[1].toDouble(&okB);
+    return okA && okB;
+}
+
+bool parseInt(const QString& value, int minimum, int& result)
+{
+    bool ok = false;
+    int parsed = value.toInt(&ok);
+    if (!ok || parsed < minimum) return false;
+    result = parsed;
+    return true;
+}
+
+// Процентиль по отсортированным значениям (ближайший ранг)
+double percentile(const std::vector<double>& sorted, double p)
+{
+    if (sorted.empty()) return 0;
+    return sorted[std::min(sorted.size() - 1, size_t(p * sorted.size()))];
+}
+
+// Повторяет события журнала без пауз: событие, затем кадр. Задержка -
+// от применения события до готового кадра, как видит ее пользователь
+bool replaySession(GLWidget& widget, const SessionLog& session, QImage& image)
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::printf("событие\tтип\tмс\n");
+    std::vector<double> all;
+    std::vector<std::vector<double>> byType(SESSION_EVENT_TYPE_COUNT);
+    all.reserve(session.events().size());
+    // Модель читается в фоне: ошибка приходит сигналом. Связь живет,
+    // пока жив context
+    QString error;
+    QObject context;
+    QObject::connect(&widget, &GLWidget::zbufferModelLoadFailed, &context,
+                     [&error](const QString&, const QString& message) { error = message; });
+    for (size_t i = 0; i < session.events().size(); i++) {
+        const SessionEvent& event = session.events()[i];
+        const auto start = Clock::now();
+        widget.applySessionEvent(event);
+        // Пересчеты идут в фоне: задержка - до кадра с их результатом
+        widget.waitForJobs();
+        image = widget.grabFramebuffer();
+        QCoreApplication::processEvents();
+        if (!error.isEmpty()) {
+            std::fprintf(stderr, "Событие %zu (%s): %s\n", i, sessionEventName(event.type), qPrintable(error));
+            return false;
+        }
+        const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        all.push_back(ms);
+        byType[event.type].push_back(ms);
+        std::printf("%zu\t%s\t%.3f\n", i, sessionEventName(event.type), ms);
+    }
+    if (all.empty()) return true;
+
+    std::sort(all.begin(), all.end());
+    std::printf("Задержка событий (%zu): p50 %.3f / p99 %.3f / макс %.3f мс\n", all.size(),
+                percentile(all, 0.5), percentile(all, 0.99), all.back());
+    std::printf("По типам: число, p50 / p99 / макс, мс\n");
+    for (int type = 0; type < SESSION_EVENT_TYPE_COUNT; type++) {
+        std::vector<double>& latencies = byType[type];
+        if (latencies.empty()) continue;
+        std::sort(latencies.begin(), latencies.end());
+        std::printf("  %s: %zu, %.3f / %.3f / %.3f\n", sessionEventName(SessionEventType(type)), latencies.size(),
+                    percentile(latencies, 0.5), percentile(latencies, 0.99), latencies.back());
+    }
+    return true;
+}
+
+} // namespace
+
+bool isHeadlessRequested(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--headless") == 0) return true;
+    }
+    return false;
+}
+
+bool parseHeadlessOptions(const QStringList& arguments, HeadlessOptions& options, QString* error)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Прогон без окна: время кадров выбранной темы");
+    parser.addHelpOption();
+
+    const QCommandLineOption headlessOption("headless", "Рисовать без окна и вывести замеры.");
+    const QCommandLineOption themeOption("theme", "Тема: bezier, bspline, clipping, zbuffer, raytracing или 1..5.", "тема", "bezier");
+    const QCommandLineOption sizeOption("size", "Размер кадра в пикселях.", "ШxВ", "1280x720");
+    const QCommandLineOption framesOption("frames", "Число замеряемых кадров.", "N", "100");
+    const QCommandLineOption warmupOption("warmup", "Кадров прогрева без замера.", "N", "5");
+    const QCommandLineOption rotationOption("rotation", "Углы камеры X,Y в градусах.", "X,Y", "15,15");
+    const QCommandLineOption rotationStepOption("rotation-step", "Поворот камеры за кадр X,Y в градусах.", "X,Y", "0,0");
+    const QCommandLineOption orderOption("order", "Порядок B-сплайна (2..5).", "N", "3");
+    const QCommandLineOption objectsOption("objects", "Число пирамид в теме Z-буфера.", "N", "3");
+    const QCommandLineOption modelOption("model", "Модель OBJ для темы Z-буфера.", "файл");
+    const QCommandLineOption visibilityOption("visibility", "Видимость в теме Z-буфера: zbuffer или bsp.", "метод", "zbuffer");
+    const QCommandLineOption qualityOption("quality", "Качество трассировки (1..5).", "N", "3");
+    const QCommandLineOption budgetOption("budget", "Бюджет кадра трассировки в мс; 0 - без бюджета.", "мс", "0");
+    const QCommandLineOption seedOption("seed", "Seed случайных генераторов сцен.", "N", QString::number(defaultRandomSeed));
+    const QCommandLineOption prewarmOption("prewarm", "Готовить данные остальных тем в фоне после первого кадра.");
+    const QCommandLineOption gpuTimersOption("gpu-timers", "Замерять время кадра на GPU.");
+    const QCommandLineOption overlayOption("overlay", "Рисовать сводку профиля поверх кадра.");
+    const QCommandLineOption imageOption("image", "Сохранить последний кадр (PNG, JPG, ...).", "файл");
+    const QCommandLineOption traceOption("trace", "Сохранить трассу Chrome замеренных кадров.", "файл");
+    const QCommandLineOption replayOption("replay", "Повторить журнал сеанса и замерить задержку событий.", "файл");
+    parser.addOptions({headlessOption, themeOption, sizeOption, framesOption, warmupOption,
+                       rotationOption, rotationStepOption, orderOption, objectsOption, modelOption,
+                       visibilityOption, qualityOption, budgetOption, seedOption, prewarmOption, gpuTimersOption,
+                       overlayOption, imageOption, traceOption, replayOption});
+
+    auto fail = [&](const QString& message) {
+        if (error) *error = message + "\n\n" + parser.helpText();
+        return false;
+    };
+
+    if (!parser.parse(arguments)) return fail(parser.errorText());
+    if (parser.isSet("help")) return fail(QString());
+
+    if (!parseTheme(parser.value(themeOption), options.theme)) {
+        return fail("Неизвестная тема: " + parser.value(themeOption));
+    }
+
+    double width = 0, height = 0;
+    if (!parsePair(parser.value(sizeOption), 'x', width, height) || width < 1 || height < 1) {
+        return fail("Неверный размер кадра: " + parser.value(sizeOption));
+    }
+    options.width = int(width);
+    options.height = int(height);
+
+    if (!parseInt(parser.value(framesOption), 1, options.frames)) {
+        return fail("Неверное число кадров: " + parser.value(framesOption));
+    }
+    if (!parseInt(parser.value(warmupOption), 0, options.warmupFrames)) {
+        return fail("Неверное число кадров прогрева: " + parser.value(warmupOption));
+    }
+
+    double x = 0, y = 0;
+    if (!parsePair(parser.value(rotationOption), ',', x, y)) {
+        return fail("Неверные углы камеры: " + parser.value(rotationOption));
+    }
+    options.rotationX = float(x);
+    options.rotationY = float(y);
+    if (!parsePair(parser.value(rotationStepOption), ',', x, y)) {
+        return fail("Неверный поворот за кадр: " + parser.value(rotationStepOption));
+    }
+    options.rotationStepX = float(x);
+    options.rotationStepY = float(y);
+
+    if (!parseInt(parser.value(orderOption), 2, options.bsplineOrder) || options.bsplineOrder > 5) {
+        return fail("Неверный порядок B-сплайна: " + parser.value(orderOption));
+    }
+    if (!parseInt(parser.value(objectsOption), 1, options.zbufferObjects)) {
+        return fail("Неверное число объектов: " + parser.value(objectsOption));
+    }
+    options.modelFile = parser.value(modelOption);
+
+    const QString visibility = parser.value(visibilityOption);
+    if (visibility == "zbuffer") {
+        options.visibility = GLWidget::VISIBILITY_ZBUFFER;
+    } else if (visibility == "bsp") {
+        options.visibility = GLWidget::VISIBILITY_BSP;
+    } else {
+        return fail("Неизвестный метод видимости: " + visibility);
+    }
+
+    if (!parseInt(parser.value(qualityOption), 1, options.rayTracingQuality) || options.rayTracingQuality > 5) {
+        return fail("Неверное качество трассировки: " + parser.value(qualityOption));
+    }
+    bool ok = false;
+    options.frameBudget = parser.value(budgetOption).toDouble(&ok);
+    if (!ok || options.frameBudget < 0) {
+        return fail("Неверный бюджет кадра: " + parser.value(budgetOption));
+    }
+
+    options.seed = parser.value(seedOption).toULongLong(&ok);
+    if (!ok) {
+        return fail("Неверный seed: " + parser.value(seedOption));
+    }
+
+    options.prewarm = parser.isSet(prewarmOption);
+    options.gpuTimers = parser.isSet(gpuTimersOption);
+    options.overlay = parser.isSet(overlayOption);
+    options.imageFile = parser.value(imageOption);
+    options.traceFile = parser.value(traceOption);
+    options.replayFile = parser.value(replayOption);
+    return true;
+}
+
+int runHeadless(const HeadlessOptions& options)
+{
+    using Clock = std::chrono::steady_clock;
+
+    SessionLog session;
+    if (!options.replayFile.isEmpty()) {
+        std::string error;
+        if (!session.load(options.replayFile.toStdString(), &error)) {
+            std::fprintf(stderr, "Ошибка загрузки журнала сеанса: %s\n", error.c_str());
+            return 1;
+        }
+    }
+
+    // Запуск - от создания виджета до первого кадра: данные строятся только
+    // для показываемой темы
+    const auto createStart = Clock::now();
+    GLWidget widget;
+    widget.setThemePrewarm(options.prewarm);
+    widget.resize(options.width, options.height);
+    widget.setBSplineOrder(options.bsplineOrder);
+    widget.setZBufferObjectsCount(options.zbufferObjects);
+    // Генерирует сцены заново - с заданным числом объектов
+    widget.setRandomSeed(options.seed);
+    if (!options.modelFile.isEmpty()) {
+        QString error;
+        QObject context;
+        QObject::connect(&widget, &GLWidget::zbufferModelLoadFailed, &context,
+                         [&error](const QString&, const QString& message) { error = message; });
+        widget.loadZBufferModel(options.modelFile);
+        // Сигнал об ошибке из задачи доставляется через очередь событий
+        widget.waitForJobs();
+        QCoreApplication::processEvents();
+        if (!error.isEmpty()) {
+            std::fprintf(stderr, "Ошибка загрузки модели: %s\n", qPrintable(error));
+            return 1;
+        }
+    }
+    widget.setVisibilityMode(options.visibility);
+    widget.setRayTracingQuality(options.rayTracingQuality);
+    widget.setFrameBudget(options.frameBudget);
+    widget.setGpuTimers(options.gpuTimers);
+    widget.setCurrentTheme(options.theme);
+
+    float rotationX = options.rotationX;
+    float rotationY = options.rotationY;
+    QImage image;
+    auto renderFrame = [&]() {
+        widget.setViewRotation(rotationX, rotationY);
+        // Кадр - с данными темы, а не с пустой сценой, пока они строятся в фоне
+        widget.waitForJobs();
+        // grabFramebuffer рисует кадр и читает его из FBO: время включает
+        // ожидание GPU, как у показанного кадра
+        image = widget.grabFramebuffer();
+        rotationX += options.rotationStepX;
+        rotationY += options.rotationStepY;
+        // Завершенные проходы трассировки приходят сигналами из фонового потока
+        QCoreApplication::processEvents();
+    };
+
+    renderFrame();
+    const double startupMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - createStart).count();
+    for (int i = 1; i < options.warmupFrames; i++) {
+        renderFrame();
+    }
+    if (image.isNull() || !widget.isRendererReady()) {
+        std::fprintf(stderr, "Не удалось создать контекст OpenGL 3.3 core profile\n");
+        return 1;
+    }
+
+    // Профиль и трасса - только замеряемые кадры
+    widget.setProfilingEnabled(true, options.overlay);
+    std::printf("Первый кадр: %.3f мс от создания виджета\n", startupMilliseconds);
+
+    if (!options.replayFile.isEmpty()) {
+        std::printf("Журнал: %s, событий: %zu, %dx%d, seed %llu\n", qPrintable(options.replayFile),
+                    session.events().size(), options.width, options.height, (unsigned long long)options.seed);
+        if (!replaySession(widget, session, image)) {
+            return 1;
+        }
+    } else {
+        std::printf("Тема: %s, %dx%d, кадров: %d (прогрев %d), seed %llu\n", themeName(options.theme),
+                    options.width, options.height, options.frames, options.warmupFrames,
+                    (unsigned long long)options.seed);
+        std::printf("кадр\tмс\n");
+
+        std::vector<double> frameMilliseconds;
+        frameMilliseconds.reserve(options.frames);
+        const auto runStart = Clock::now();
+        for (int i = 0; i < options.frames; i++) {
+            const auto start = Clock::now();
+            renderFrame();
+            const double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+            frameMilliseconds.push_back(ms);
+            std::printf("%d\t%.3f\n", i, ms);
+        }
+        const double totalMilliseconds = std::chrono::duration<double, std::milli>(Clock::now() - runStart).count();
+
+        std::vector<double> sorted = frameMilliseconds;
+        std::sort(sorted.begin(), sorted.end());
+        double sum = 0;
+        for (double ms : sorted) sum += ms;
+        std::printf("Кадр: сред %.3f / p50 %.3f / p95 %.3f / p99 %.3f / макс %.3f мс, %.1f кадров/с\n",
+                    sum / sorted.size(), percentile(sorted, 0.5), percentile(sorted, 0.95),
+                    percentile(sorted, 0.99), sorted.back(), 1000.0 * options.frames / totalMilliseconds);
+    }
+
+    std::printf("Стадии (последние кадры): сред / p95 / макс, мс\n");
+    for (const Profiler::StageStats& stats : widget.profileStages()) {
+        std::printf("  %s: %.3f / %.3f / %.3f (%llu)\n", stats.name.c_str(), stats.average, stats.p95,
+                    stats.max, (unsigned long long)stats.count);
+    }
+
+    int status = 0;
+    if (!options.imageFile.isEmpty() && !image.save(options.imageFile)) {
+        std::fprintf(stderr, "Не удалось сохранить изображение %s\n", qPrintable(options.imageFile));
+        status = 1;
+    }
+    if (!options.traceFile.isEmpty()) {
+        QString error;
+        if (!widget.exportTrace(options.traceFile, &error)) {
+            std::fprintf(stderr, "Не удалось сохранить трассу: %s\n", qPrintable(error));
+            status = 1;
+        }
+    }
+    return status;
+}
@@ -0,0 +1,57 @@
+#ifndef HEADLESSRUNNER_H
+#define HEADLESSRUNNER_H
+
+#include <QString>
+#include <QStringList>
+#include "glwidget.h"
+
+// Прогон без окна для автоматических замеров (ключ --headless).
+// GLWidget не показывается: QOpenGLWidget рисует скрытый виджет в свой
+// FBO на QOffscreenSurface, кадр запрашивается grabFramebuffer. На сервере
+// без дисплея используется платформа offscreen (Mesa llvmpipe:
+// LIBGL_ALWAYS_SOFTWARE=1)
+struct HeadlessOptions {
+    GLWidget::Theme theme = GLWidget::BEZIER_CURVE;
+    int width = 1280;
+    int height = 720;
+    int frames = 100;
+    int warmupFrames = 5;       // Не входят в замеры: загрузка буферов, первый проход трассировки
+
+    // Камера в градусах; step - поворот за кадр, чтобы каждый кадр был новым ракурсом
+    float rotationX = 15.0f;
+    float rotationY = 15.0f;
+    float rotationStepX = 0.0f;
+    float rotationStepY = 0.0f;
+
+    // Параметры тем, как на панелях управления
+    int bsplineOrder = 3;
+    int zbufferObjects = 3;
+    QString modelFile;
+    GLWidget::VisibilityMode visibility = GLWidget::VISIBILITY_ZBUFFER;
+    int rayTracingQuality = 3;
+    double frameBudget = 0;     // мс; 0 - без бюджета
+    uint64_t seed = defaultRandomSeed;  // Один seed - одна и та же нагрузка в каждом прогоне
+
+    bool prewarm = false;       // Готовить данные остальных тем в фоне после первого кадра
+    bool gpuTimers = false;
+    bool overlay = false;       // Сводка профиля поверх кадра (попадает в изображение)
+    QString imageFile;          // Последний кадр; пусто - не сохранять
+    QString traceFile;          // Трасса Chrome; пусто - не сохранять
+
+    // Журнал сеанса (SessionLog): вместо frames кадров повторяются его
+    // события без пауз, кадр после каждого; замеряется задержка события
+    QString replayFile;
+};
+
+// Есть ли --headless среди аргументов; проверяется до создания QApplication
+bool isHeadlessRequested(int argc, char* argv[]);
+
+// Разбор аргументов; при ошибке error содержит сообщение и справку
+bool parseHeadlessOptions(const QStringList& arguments, HeadlessOptions& options, QString* error = nullptr);
+
+// Рисует прогрев и options.frames кадров (или события журнала сеанса),
+// печатает время каждого кадра, сводку и профиль стадий в stdout.
+// Возвращает код завершения процесса
+int runHeadless(const HeadlessOptions& options);
+
+#endif // HEADLESSRUNNER_H
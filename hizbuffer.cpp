@@ -0,0 +1,176 @@
+#include "hizbuffer.h"
+#include "rasterizer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Глубина в буфере - не больше 1
+const float uncovered = 2.0f;
+
+} // namespace
+
+HiZBuffer::HiZBuffer()
+    : occluderMinX(0), occluderMinY(0), occluderMaxX(-1), occluderMaxY(-1)
+{
+}
+
+void HiZBuffer::resize(int width, int height)
+{
+    width = std::max(width, 1);
+    height = std::max(height, 1);
+    if (!levelWidth.empty() && levelWidth[0] == width && levelHeight[0] == height) {
+        return;
+    }
+
+    levels.clear();
+    levelWidth.clear();
+    levelHeight.clear();
+    occluder.assign(size_t(width) * height, uncovered);
+    occluderMaxX = occluderMaxY = -1;
+
+    // Строим уровни до размера 1x1
+    while (true) {
+        levels.push_back(std::vector<float>(size_t(width) * height, 1.0f));
+        levelWidth.push_back(width);
+        levelHeight.push_back(height);
+        if (width == 1 && height == 1) break;
+        width = (width + 1) / 2;
+        height = (height + 1) / 2;
+    }
+}
+
+void HiZBuffer::clear()
+{
+    for (auto& level : levels) {
+        std::fill(level.begin(), level.end(), 1.0f);
+    }
+    std::fill(occluder.begin(), occluder.end(), uncovered);
+    occluderMaxX = occluderMaxY = -1;
+}
+
+bool HiZBuffer::isOutside(int minX, int minY, int maxX, int maxY) const
+{
+    if (levels.empty()) return false;
+    return maxX < 0 || maxY < 0 || minX >= levelWidth[0] || minY >= levelHeight[0];
+}
+
+bool HiZBuffer::isOccluded(int minX, int minY, int maxX, int maxY, double minDepth) const
+{
+    if (levels.empty() || isOutside(minX, minY, maxX, maxY)) return false;
+
+    minX = std::max(minX, 0);
+    minY = std::max(minY, 0);
+    maxX = std::min(maxX, levelWidth[0] - 1);
+    maxY = std::min(maxY, levelHeight[0] - 1);
+
+    // Выбираем уровень, на котором прямоугольник покрывает не больше 4x4 текселей
+    size_t level = 0;
+    while (level + 1 < levels.size() &&
+           ((maxX >> level) - (minX >> level) > 3 || (maxY >> level) - (minY >> level) > 3)) {
+        level++;
+    }
+
+    const std::vector<float>& depth = levels[level];
+    const int w = levelWidth[level];
+    for (int y = minY >> level; y <= (maxY >> level); y++) {
+        for (int x = minX >> level; x <= (maxX >> level); x++) {
+            if (depth[size_t(y) * w + x] >= minDepth) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void HiZBuffer::rasterizeTriangle(const Point3D& a, const Point3D& b, const Point3D& c)
+{
+    if (levels.empty()) return;
+
+    const int w = levelWidth[0];
+
+    int minX, minY, maxX, maxY;
+    bool covered = ::rasterizeTriangle(
+        Point3D(toPixelX(a.x), toPixelY(a.y), a.z),
+        Point3D(toPixelX(b.x), toPixelY(b.y), b.z),
+        Point3D(toPixelX(c.x), toPixelY(c.y), c.z),
+        w, levelHeight[0], minX, minY, maxX, maxY,
+        [&](int x, int y, double z) {
+            float& stored = occluder[size_t(y) * w + x];
+            if (z < stored) stored = float(z);
+        });
+
+    if (!covered) return;
+    if (occluderMinX > occluderMaxX) {
+        occluderMinX = minX;
+        occluderMinY = minY;
+        occluderMaxX = maxX;
+        occluderMaxY = maxY;
+    } else {
+        occluderMinX = std::min(occluderMinX, minX);
+        occluderMinY = std::min(occluderMinY, minY);
+        occluderMaxX = std::max(occluderMaxX, maxX);
+        occluderMaxY = std::max(occluderMaxY, maxY);
+    }
+}
+
+void HiZBuffer::flushOccluder()
+{
+    if (levels.empty() || occluderMinX > occluderMaxX) return;
+
+    const int w = levelWidth[0];
+    const int h = levelHeight[0];
+    std::vector<float>& depth = levels[0];
+
+    // Пиксели у края буфера не пишутся: соседа за краем не проверить
+    const int minX = std::max(occluderMinX + 1, 1), maxX = std::min(occluderMaxX - 1, w - 2);
+    const int minY = std::max(occluderMinY + 1, 1), maxY = std::min(occluderMaxY - 1, h - 2);
+    bool written = false;
+    for (int y = minY; y <= maxY; y++) {
+        for (int x = minX; x <= maxX; x++) {
+            float farthest = 0;
+            for (int dy = -1; dy <= 1; dy++) {
+                const float* row = &occluder[size_t(y + dy) * w + x - 1];
+                farthest = std::max(farthest, std::max(row[0], std::max(row[1], row[2])));
+            }
+            if (farthest == uncovered) continue;
+
+            float& stored = depth[size_t(y) * w + x];
+            if (farthest < stored) stored = farthest;
+            written = true;
+        }
+    }
+    if (written) {
+        updatePyramid(minX, minY, maxX, maxY);
+    }
+
+    for (int y = occluderMinY; y <= occluderMaxY; y++) {
+        std::fill(occluder.begin() + size_t(y) * w + occluderMinX,
+                  occluder.begin() + size_t(y) * w + occluderMaxX + 1, uncovered);
+    }
+    occluderMaxX = occluderMaxY = -1;
+}
+
+void HiZBuffer::updatePyramid(int minX, int minY, int maxX, int maxY)
+{
+    for (size_t level = 1; level < levels.size(); level++) {
+        minX >>= 1; minY >>= 1; maxX >>= 1; maxY >>= 1;
+
+        const std::vector<float>& src = levels[level - 1];
+        std::vector<float>& dst = levels[level];
+        const int sw = levelWidth[level - 1];
+        const int sh = levelHeight[level - 1];
+        const int dw = levelWidth[level];
+
+        for (int y = minY; y <= maxY; y++) {
+            for (int x = minX; x <= maxX; x++) {
+                const int sx = x * 2, sy = y * 2;
+                const int sx1 = std::min(sx + 1, sw - 1);
+                const int sy1 = std::min(sy + 1, sh - 1);
+                float d = std::max(std::max(src[size_t(sy) * sw + sx], src[size_t(sy) * sw + sx1]),
+                                   std::max(src[size_t(sy1) * sw + sx], src[size_t(sy1) * sw + sx1]));
+                dst[size_t(y) * dw + x] = d;
+            }
+        }
+    }
+}
@@ -0,0 +1,57 @@
+#ifndef HIZBUFFER_H
+#define HIZBUFFER_H
+
+#include "geometry.h"
+#include <vector>
+
+// Иерархический Z-буфер (Hi-Z) для отсечения невидимых объектов на CPU.
+// Уровень 0 - буфер глубины низкого разрешения, каждый следующий уровень
+// хранит максимум (самую дальнюю глубину) блока 2x2 предыдущего.
+// Глубина в [0, 1], меньшее значение - ближе к наблюдателю.
+class HiZBuffer
+{
+public:
+    HiZBuffer();
+
+    void resize(int width, int height);
+    void clear();
+
+    int width() const { return levelWidth.empty() ? 0 : levelWidth[0]; }
+    int height() const { return levelHeight.empty() ? 0 : levelHeight[0]; }
+
+    // Прямоугольник в пикселях уровня 0 (включительно) целиком вне буфера
+    bool isOutside(int minX, int minY, int maxX, int maxY) const;
+
+    // Прямоугольник в пикселях уровня 0 (включительно) полностью закрыт,
+    // если все уже нарисованное в нем ближе, чем minDepth. Часть вне
+    // буфера не проверяется; прямоугольник целиком вне буфера не закрыт
+    bool isOccluded(int minX, int minY, int maxX, int maxY, double minDepth) const;
+
+    // Растеризует треугольник заслоняющего объекта в NDC (см.
+    // ViewTransform::toNdc) по центрам пикселей; в буфер объект попадает
+    // при flushOccluder
+    void rasterizeTriangle(const Point3D& a, const Point3D& b, const Point3D& c);
+    // Записывает растеризованный объект консервативно и обновляет пирамиду
+    // в затронутой области. Покрытие сужается на тексель: пиксель пишется,
+    // только если покрыты центры его и всех восьми соседей, то есть объект
+    // (выпуклый) закрывает пиксель целиком. Глубина - самая дальняя из этих
+    // девяти: у выпуклого объекта дальше передней поверхности в пикселе нет
+    void flushOccluder();
+
+    // Переводит NDC в пиксели уровня 0
+    double toPixelX(double ndcX) const { return (ndcX + 1.0) * 0.5 * width(); }
+    double toPixelY(double ndcY) const { return (ndcY + 1.0) * 0.5 * height(); }
+
+private:
+    void updatePyramid(int minX, int minY, int maxX, int maxY);
+
+    std::vector<std::vector<float>> levels;
+    // Передняя глубина текущего объекта по центрам пикселей уровня 0;
+    // uncovered - центр не покрыт. Прямоугольник - покрытая область
+    std::vector<float> occluder;
+    int occluderMinX, occluderMinY, occluderMaxX, occluderMaxY;
+    std::vector<int> levelWidth;
+    std::vector<int> levelHeight;
+};
+
+#endif // HIZBUFFER_H
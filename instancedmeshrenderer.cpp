@@ -0,0 +1,155 @@
+#include "instancedmeshrenderer.h"
+#include <QOpenGLExtraFunctions>
+#include <cstddef>
+#include <vector>
+
+namespace {
+
+const char* vertexShaderSource = R"(
+#version 330
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec4 instanceOffsetScale;
+layout(location = 2) in vec3 instanceColor;
+uniform mat4 mvp;
+out vec3 color;
+void main()
+{
+    color = instanceColor;
+    gl_Position = mvp * vec4(position * instanceOffsetScale.w + instanceOffsetScale.xyz, 1.0);
+}
+)";
+
+const char* fragmentShaderSource = R"(
+#version 330
+in vec3 color;
+out vec4 fragColor;
+void main()
+{
+    fragColor = vec4(color, 1.0);
+}
+)";
+
+} // namespace
+
+InstancedMeshRenderer::InstancedMeshRenderer()
+    : gl(nullptr),
+    vertexBuffer(QOpenGLBuffer::VertexBuffer),
+    indexBuffer(QOpenGLBuffer::IndexBuffer),
+    instanceBuffer(QOpenGLBuffer::VertexBuffer),
+    indexCount(0),
+    instanceCapacity(0),
+    instances(0),
+    mapped(false)
+{
+}
+
+bool InstancedMeshRenderer::initialize(QOpenGLExtraFunctions* functions)
+{
+    gl = functions;
+
+    if (!program.addShaderFromSourceCode(QOpenGLShader::Vertex, vertexShaderSource) ||
+        !program.addShaderFromSourceCode(QOpenGLShader::Fragment, fragmentShaderSource) ||
+        !program.link()) {
+        return false;
+    }
+
+    vao.create();
+    vertexBuffer.create();
+    indexBuffer.create();
+    instanceBuffer.create();
+    instanceBuffer.setUsagePattern(QOpenGLBuffer::StreamDraw);
+
+    // Раскладка атрибутов запоминается в VAO
+    QOpenGLVertexArrayObject::Binder binder(&vao);
+
+    vertexBuffer.bind();
+    gl->glEnableVertexAttribArray(0);
+    gl->glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+
+    instanceBuffer.bind();
+    gl->glEnableVertexAttribArray(1);
+    gl->glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(MeshInstance), nullptr);
+    gl->glVertexAttribDivisor(1, 1);
+    gl->glEnableVertexAttribArray(2);
+    gl->glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(MeshInstance),
+                              reinterpret_cast<void*>(offsetof(MeshInstance, r)));
+    gl->glVertexAttribDivisor(2, 1);
+    instanceBuffer.release();
+
+    indexBuffer.bind();
+    return true;
+}
+
+void InstancedMeshRenderer::destroy()
+{
+    vao.destroy();
+    vertexBuffer.destroy();
+    indexBuffer.destroy();
+    instanceBuffer.destroy();
+    program.removeAllShaders();
+    instanceCapacity = 0;
+    instances = 0;
+}
+
+void InstancedMeshRenderer::setMesh(const IndexedMesh& mesh)
+{
+    std::vector<float> vertices;
+    vertices.reserve(mesh.vertices.size() * 3);
+    for (const auto& v : mesh.vertices) {
+        vertices.push_back(float(v.x));
+        vertices.push_back(float(v.y));
+        vertices.push_back(float(v.z));
+    }
+
+    vertexBuffer.bind();
+    vertexBuffer.allocate(vertices.data(), int(vertices.size() * sizeof(float)));
+    vertexBuffer.release();
+
+    // Буфер индексов привязан к VAO
+    QOpenGLVertexArrayObject::Binder binder(&vao);
+    indexBuffer.bind();
+    indexBuffer.allocate(mesh.indices.data(), int(mesh.indices.size() * sizeof(unsigned int)));
+    indexCount = int(mesh.indices.size());
+}
+
+MeshInstance* InstancedMeshRenderer::mapInstances(int count)
+{
+    instanceBuffer.bind();
+    if (count > instanceCapacity) {
+        instanceCapacity = count;
+        instanceBuffer.allocate(instanceCapacity * int(sizeof(MeshInstance)));
+    }
+    if (count == 0) {
+        return nullptr;
+    }
+
+    void* data = instanceBuffer.mapRange(0, count * int(sizeof(MeshInstance)),
+                                         QOpenGLBuffer::RangeWrite |
+                                             QOpenGLBuffer::RangeInvalidateBuffer);
+    mapped = data != nullptr;
+    return static_cast<MeshInstance*>(data);
+}
+
+void InstancedMeshRenderer::unmapInstances(int writtenCount)
+{
+    if (mapped) {
+        instanceBuffer.bind();
+        instanceBuffer.unmap();
+        mapped = false;
+    }
+    instanceBuffer.release();
+    instances = writtenCount;
+}
+
+void InstancedMeshRenderer::draw(const QMatrix4x4& mvp)
+{
+    if (instances <= 0 || indexCount == 0) return;
+
+    program.bind();
+    program.setUniformValue("mvp", mvp);
+
+    QOpenGLVertexArrayObject::Binder binder(&vao);
+    gl->glDrawElementsInstanced(GL_TRIANGLES, indexCount, GL_UNSIGNED_INT, nullptr, instances);
+
+    program.release();
+}
@@ -0,0 +1,47 @@
+#ifndef INSTANCEDMESHRENDERER_H
+#define INSTANCEDMESHRENDERER_H
+
+#include <QMatrix4x4>
+#include <QOpenGLBuffer>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLVertexArrayObject>
+#include "mesh.h"
+
+class QOpenGLExtraFunctions;
+
+// Рисует одну общую сетку из VBO множеством экземпляров за один вызов.
+// Перенос, масштаб и цвет экземпляра берутся из отдельного буфера (MeshInstance)
+class InstancedMeshRenderer
+{
+public:
+    InstancedMeshRenderer();
+
+    // Вызываются при текущем контексте OpenGL
+    bool initialize(QOpenGLExtraFunctions* functions);
+    void destroy();
+    void setMesh(const IndexedMesh& mesh);
+
+    // Отображает буфер экземпляров на память: данные пишутся в него напрямую,
+    // без промежуточного массива. Старое содержимое отбрасывается.
+    // После записи обязательно вызвать unmapInstances
+    MeshInstance* mapInstances(int count);
+    void unmapInstances(int writtenCount);
+
+    void draw(const QMatrix4x4& mvp);
+
+    int instanceCount() const { return instances; }
+
+private:
+    QOpenGLExtraFunctions* gl;
+    QOpenGLShaderProgram program;
+    QOpenGLVertexArrayObject vao;
+    QOpenGLBuffer vertexBuffer;
+    QOpenGLBuffer indexBuffer;
+    QOpenGLBuffer instanceBuffer;
+    int indexCount;
+    int instanceCapacity;
+    int instances;
+    bool mapped;
+};
+
+#endif // INSTANCEDMESHRENDERER_H
@@ -0,0 +1,118 @@
+#include "jobsystem.h"
+#include <algorithm>
+
+JobSystem::JobSystem(int threadCount)
+    : stopping(false)
+{
+    if (threadCount <= 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int i = 0; i < threadCount; i++) {
+        threads.emplace_back(&JobSystem::workerLoop, this);
+    }
+}
+
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        queue.clear();
+        for (Running& job : running) {
+            job.cancelled->store(true);
+        }
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void JobSystem::submit(int channel, Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelLocked(channel);
+        queue.push_back({channel, std::move(job), std::make_shared<std::atomic<bool>>(false)});
+    }
+    wake.notify_one();
+}
+
+void JobSystem::cancel(int channel, bool wait)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    cancelLocked(channel);
+    idle.notify_all();
+    if (wait) {
+        idle.wait(lock, [&] { return !isRunning(channel); });
+    }
+}
+
+void JobSystem::cancelAll(bool wait)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    queue.clear();
+    for (Running& job : running) {
+        job.cancelled->store(true);
+    }
+    idle.notify_all();
+    if (wait) {
+        idle.wait(lock, [&] { return running.empty(); });
+    }
+}
+
+void JobSystem::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [&] { return queue.empty() && running.empty(); });
+}
+
+void JobSystem::cancelLocked(int channel)
+{
+    queue.erase(std::remove_if(queue.begin(), queue.end(),
+                               [channel](const Entry& entry) { return entry.channel == channel; }),
+                queue.end());
+    for (Running& job : running) {
+        if (job.channel == channel) job.cancelled->store(true);
+    }
+}
+
+bool JobSystem::isRunning(int channel) const
+{
+    return std::any_of(running.begin(), running.end(),
+                       [channel](const Running& job) { return job.channel == channel; });
+}
+
+void JobSystem::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        // Первая задача, канал которой сейчас не выполняется
+        auto next = queue.end();
+        wake.wait(lock, [&] {
+            if (stopping) return true;
+            next = std::find_if(queue.begin(), queue.end(),
+                                [this](const Entry& entry) { return !isRunning(entry.channel); });
+            return next != queue.end();
+        });
+        if (stopping) return;
+
+        Entry entry = std::move(*next);
+        queue.erase(next);
+        running.push_back({entry.channel, entry.cancelled});
+        lock.unlock();
+
+        if (!entry.cancelled->load()) {
+            entry.job(*entry.cancelled);
+        }
+        // Захваченные задачей данные освобождаются вне блокировки
+        entry.job = nullptr;
+
+        lock.lock();
+        running.erase(std::find_if(running.begin(), running.end(),
+                                   [&](const Running& job) { return job.cancelled == entry.cancelled; }));
+        idle.notify_all();
+        // Следующая задача этого канала могла ждать, пока канал освободится
+        wake.notify_all();
+    }
+}
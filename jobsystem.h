@@ -0,0 +1,103 @@
+#ifndef JOBSYSTEM_H
+#define JOBSYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Фоновые задачи по каналам, без зависимостей от Qt. Канал - одни данные,
+// которые задача пересчитывает (поверхность, сцена, ...). Новая задача
+// канала отменяет прежнюю: ожидающая выбрасывается, выполняемая получает
+// флаг отмены и проверяет его между шагами (ядра - между блоками). Задачи
+// одного канала не выполняются одновременно, поэтому результат прежней
+// не может прийти позже результата новой
+class JobSystem
+{
+public:
+    using Job = std::function<void(const std::atomic<bool>& cancelled)>;
+
+    // threadCount = 0 - по числу аппаратных потоков
+    explicit JobSystem(int threadCount = 0);
+    // Отменяет задачи и дожидается потоков
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void submit(int channel, Job job);
+    // wait = true - дождаться, пока выполняемая задача канала завершится
+    void cancel(int channel, bool wait = false);
+    void cancelAll(bool wait = false);
+    // Ждет, пока не останется ни ожидающих, ни выполняемых задач
+    void waitIdle();
+
+private:
+    struct Entry {
+        int channel;
+        Job job;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+    };
+    struct Running {
+        int channel;
+        std::shared_ptr<std::atomic<bool>> cancelled;
+    };
+
+    void workerLoop();
+    void cancelLocked(int channel);
+    bool isRunning(int channel) const;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<Entry> queue;
+    std::vector<Running> running;
+    bool stopping;
+    std::vector<std::thread> threads;
+};
+
+// Двойной буфер неизменяемых снимков результата. Задача публикует снимок
+// в задний буфер атомарной заменой указателя; читатель (поток интерфейса)
+// в начале кадра забирает его в передний и читает без блокировок до
+// следующего acquire. Снимок, который не успели забрать, заменяется
+// следующим и удаляется
+template <typename T>
+class SnapshotBuffer
+{
+public:
+    SnapshotBuffer() : pending(nullptr) {}
+    ~SnapshotBuffer() { delete pending.exchange(nullptr); }
+
+    SnapshotBuffer(const SnapshotBuffer&) = delete;
+    SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+    // Из любого потока
+    void publish(std::unique_ptr<const T> snapshot)
+    {
+        delete pending.exchange(snapshot.release(), std::memory_order_acq_rel);
+    }
+
+    // Только читатель: true - передний снимок сменился
+    bool acquire()
+    {
+        const T* fresh = pending.exchange(nullptr, std::memory_order_acq_rel);
+        if (!fresh) return false;
+        front.reset(fresh);
+        return true;
+    }
+
+    // nullptr - еще ни одного снимка. Задача может держать передний снимок
+    // (shared) как основу, пока читатель уже перешел к следующему
+    const T* current() const { return front.get(); }
+    std::shared_ptr<const T> currentShared() const { return front; }
+
+private:
+    std::atomic<const T*> pending;
+    std::shared_ptr<const T> front;
+};
+
+#endif // JOBSYSTEM_H
@@ -0,0 +1,181 @@
+#include "kernelbenchmark.h"
+#include "geometrykernels.h"
+#include <cstring>
+
+namespace {
+
+std::string countText(size_t count)
+{
+    return std::to_string(count);
+}
+
+// Побитовое сравнение результатов последовательной и параллельной генерации
+template <typename T>
+bool sameBits(const std::vector<T>& a, const std::vector<T>& b)
+{
+    return a.size() == b.size() && (a.empty() || std::memcmp(a.data(), b.data(), a.size() * sizeof(T)) == 0);
+}
+
+bool sameLines(const std::vector<Line>& a, const std::vector<Line>& b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (std::memcmp(&a[i].start, &b[i].start, sizeof(Point3D)) != 0 ||
+            std::memcmp(&a[i].end, &b[i].end, sizeof(Point3D)) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool sameObjects(const std::vector<SceneObject>& a, const std::vector<SceneObject>& b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].shape != b[i].shape || a[i].mesh != b[i].mesh || a[i].material != b[i].material ||
+            std::memcmp(&a[i].transform.translation, &b[i].transform.translation, sizeof(Point3D)) != 0 ||
+            a[i].transform.scale != b[i].transform.scale) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string identityText(bool same)
+{
+    return same ? ", совпадает" : ", РАСХОДИТСЯ с последовательным";
+}
+
+} // namespace
+
+std::vector<BenchmarkResult> runKernelBenchmark()
+{
+    std::vector<BenchmarkResult> results;
+    // Каждое ядро - со своим потоком; параллельные варианты должны
+    // повторять последовательные бит в бит при любом числе потоков
+    const RandomStreams streams = RandomStreams(defaultRandomSeed).split(RANDOM_STREAM_BENCHMARK);
+    Pcg32 rng = streams.stream(0);
+    ThreadPool pool;
+    const std::string poolText = ", потоков " + countText(pool.threadCount());
+    size_t checksum = 0;  // Чтобы компилятор не выбросил вычисления
+
+    // Составная кривая Безье: 50 отрезков на сегмент, как в теме
+    for (size_t segments : {3, 1000, 100000}) {
+        std::vector<Point3D> controlPoints(segments * 3 + 1);
+        for (Point3D& p : controlPoints) {
+            p = Point3D(10 * rng.nextDouble(), 10 * rng.nextDouble(), 10 * rng.nextDouble());
+        }
+        std::vector<Point3D> curve;
+        double ms = measureMilliseconds([&] {
+            evaluateBezierCurve(controlPoints, 50, curve);
+            checksum += curve.size();
+        });
+        results.push_back({"Кривая Безье", countText(segments) + " сегментов", ms,
+                           curve.size() / (ms / 1000.0), "точек"});
+
+        ms = measureMilliseconds([&] {
+            applyBezierSmoothness(controlPoints);
+            checksum += controlPoints.size();
+        });
+        results.push_back({"Условия гладкости", countText(segments) + " сегментов", ms,
+                           segments / (ms / 1000.0), "соединений"});
+
+        // Правка одной точки в середине: соседние соединения и сегменты
+        const size_t edits = 1000;
+        ms = measureMilliseconds([&] {
+            for (size_t i = 0; i < edits; i++) {
+                const size_t index = controlPoints.size() / 2 + i % 3;
+                controlPoints[index].x += 1e-3;
+                const size_t last = applyBezierSmoothness(controlPoints, index, index);
+                updateBezierCurve(controlPoints, 50, index, last, curve);
+            }
+            checksum += curve.size();
+        });
+        results.push_back({"Правка точки", countText(segments) + " сегментов", ms,
+                           edits / (ms / 1000.0), "правок"});
+    }
+
+    // Поверхность B-сплайна (divisions + 1)^2 точек
+    for (int divisions : {20, 200, 1000}) {
+        std::vector<Point3D> surface;
+        double ms = measureMilliseconds([&] {
+            generateBSplineSurface(3, divisions, surface);
+            checksum += surface.size();
+        });
+        results.push_back({"Поверхность B-сплайна", "разбиение " + countText(divisions), ms,
+                           surface.size() / (ms / 1000.0), "точек"});
+    }
+
+    // Отсечение: окно как в теме, отрезки в квадрате [-5, 5]^2
+    const ClipWindow window = {-3, 3, -3, 3};
+    for (int count : {1000, 100000, 1000000}) {
+        std::vector<Line> lines, parallelLines, clipped;
+        double ms = measureMilliseconds([&] {
+            generateRandomLines(count, 5.0, streams.split(RANDOM_STREAM_LINES), lines);
+            checksum += lines.size();
+        });
+        results.push_back({"Случайные отрезки", countText(count) + " отрезков", ms,
+                           count / (ms / 1000.0), "отрезков"});
+
+        ms = measureMilliseconds([&] {
+            generateRandomLines(count, 5.0, streams.split(RANDOM_STREAM_LINES), parallelLines, &pool);
+            checksum += parallelLines.size();
+        });
+        results.push_back({"Случайные отрезки (пул)", countText(count) + " отрезков" + poolText +
+                           identityText(sameLines(lines, parallelLines)), ms, count / (ms / 1000.0), "отрезков"});
+
+        ms = measureMilliseconds([&] {
+            clipLines(window, lines, clipped);
+            checksum += clipped.size();
+        });
+        results.push_back({"Коэн - Сазерленд", countText(count) + " отрезков, видно " +
+                           countText(clipped.size()), ms, count / (ms / 1000.0), "отрезков"});
+    }
+
+    // Сцена Z-буфера
+    for (int count : {100, 10000, 100000}) {
+        Scene scene, parallelScene;
+        double ms = measureMilliseconds([&] {
+            generatePyramidScene(scene, count, streams.split(RANDOM_STREAM_ZBUFFER_SCENE));
+            checksum += scene.objects.size();
+        });
+        results.push_back({"Сцена пирамид", countText(count) + " объектов", ms,
+                           count / (ms / 1000.0), "объектов"});
+
+        ms = measureMilliseconds([&] {
+            generatePyramidScene(parallelScene, count, streams.split(RANDOM_STREAM_ZBUFFER_SCENE), &pool);
+            checksum += parallelScene.objects.size();
+        });
+        results.push_back({"Сцена пирамид (пул)", countText(count) + " объектов" + poolText +
+                           identityText(sameObjects(scene.objects, parallelScene.objects)), ms,
+                           count / (ms / 1000.0), "объектов"});
+    }
+
+    // Лучи над комнатой трассировки, с точками попадания и отражениями
+    const Scene room = makeRayTracingRoomScene();
+    RayTracer tracer;
+    tracer.setScene(room);
+    for (int count : {1000, 10000, 100000}) {
+        VisualizationRays rays, parallelRays;
+        double ms = measureMilliseconds([&] {
+            traceVisualizationRays(tracer, count, true, true, streams.split(RANDOM_STREAM_VISUALIZATION_RAYS), rays);
+            checksum += rays.rays.size();
+        });
+        results.push_back({"Лучи для показа", countText(count) + " лучей, попаданий " +
+                           countText(rays.hits.size()), ms, count / (ms / 1000.0), "лучей"});
+
+        ms = measureMilliseconds([&] {
+            traceVisualizationRays(tracer, count, true, true, streams.split(RANDOM_STREAM_VISUALIZATION_RAYS),
+                                   parallelRays, &pool);
+            checksum += parallelRays.rays.size();
+        });
+        const bool same = sameBits(rays.rays, parallelRays.rays) && sameBits(rays.hits, parallelRays.hits) &&
+                          sameBits(rays.hitColors, parallelRays.hitColors) &&
+                          sameBits(rays.reflections, parallelRays.reflections);
+        results.push_back({"Лучи для показа (пул)", countText(count) + " лучей" + poolText + identityText(same),
+                           ms, count / (ms / 1000.0), "лучей"});
+    }
+
+    if (checksum == 0) results.clear();
+    return results;
+}
@@ -0,0 +1,11 @@
+#ifndef KERNELBENCHMARK_H
+#define KERNELBENCHMARK_H
+
+#include "benchmark.h"
+
+// Ядра geometrykernels на наборах данных разного размера: кривая Безье,
+// поверхность B-сплайна, отсечение отрезков, генерация сцены Z-буфера
+// и лучей для показа поверх трассировки
+std::vector<BenchmarkResult> runKernelBenchmark();
+
+#endif // KERNELBENCHMARK_H
@@ -0,0 +1,27 @@
+#include <cstdio>
+#include <cstring>
+#include "kernelbenchmark.h"
+#include "raytracingbenchmark.h"
+#include "visibilitybenchmark.h"
+
+// Замеры ядер без Qt и OpenGL. --all - также сравнение BSP с Z-буфером
+// и трассировка по наборам SIMD-ядер (те же таблицы, что в окне)
+int main(int argc, char* argv[])
+{
+    bool all = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--all") == 0) {
+            all = true;
+        } else {
+            std::fprintf(stderr, "Использование: %s [--all]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    std::printf("%s", formatBenchmarkResults(runKernelBenchmark()).c_str());
+    if (all) {
+        std::printf("\n%s", formatBenchmarkResults(runVisibilityBenchmark()).c_str());
+        std::printf("\n%s", formatBenchmarkResults(runRayTracingBenchmark()).c_str());
+    }
+    return 0;
+}
@@ -1,10 +1,39 @@
 #include <QApplication>
+#include <QSurfaceFormat>
+#include <cstdio>
 #include "mainwindow.h"
+#include "headlessrunner.h"
 
 int main(int argc, char *argv[])
 {
+    // Вся отрисовка - шейдеры и буферы (GLRenderer), поэтому достаточно core profile 3.3
+    QSurfaceFormat format;
+    format.setVersion(3, 3);
+    format.setProfile(QSurfaceFormat::CoreProfile);
+    format.setDepthBufferSize(24);
+    QSurfaceFormat::setDefaultFormat(format);
+
+    const bool headless = isHeadlessRequested(argc, argv);
+#ifdef Q_OS_LINUX
+    // Сервер без дисплея: окно не нужно, контекст OpenGL дает платформа offscreen
+    if (headless && qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM") &&
+        qEnvironmentVariableIsEmpty("DISPLAY") && qEnvironmentVariableIsEmpty("WAYLAND_DISPLAY")) {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+#endif
+
     QApplication app(argc, argv);
 
+    if (headless) {
+        HeadlessOptions options;
+        QString error;
+        if (!parseHeadlessOptions(app.arguments(), options, &error)) {
+            std::fprintf(stderr, "%s\n", qPrintable(error));
+            return 1;
+        }
+        return runHeadless(options);
+    }
+
     MainWindow window;
     window.show();
 
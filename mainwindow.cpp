@@ -13,6 +13,11 @@
 #include <QHeaderView>
 #include <QSpinBox>
 #include <QDoubleSpinBox>
+#include <QFileDialog>
+#include <QApplication>
+#include <cmath>
+#include "visibilitybenchmark.h"
+#include "raytracingbenchmark.h"
 
 MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
 {
@@ -24,6 +29,7 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
 
     stackedWidget = new QStackedWidget(this);
     glWidget = new GLWidget(this);
+    glWidget->setThemePrewarm(true);
     stackedWidget->addWidget(glWidget);
 
     controlStackedWidget = new QStackedWidget(this);
@@ -49,6 +55,7 @@ MainWindow::MainWindow(QWidget* parent) : QMainWindow(parent)
 
     rightLayout->addWidget(themeGroup);
     rightLayout->addWidget(controlStackedWidget);
+    rightLayout->addWidget(createProfilerControls());
     rightLayout->addStretch(1);
 
     mainLayout->addWidget(rightPanel);
@@ -84,6 +91,7 @@ QWidget* MainWindow::createBezierControls()
     pointsLayout->addWidget(pointsLabel);
 
     pointTable = new PointTableWidget(this);
+    pointTable->setPoints(glWidget->controlPointStorage());
     pointsLayout->addWidget(pointTable);
 
     QPushButton* resetPointsButton = new QPushButton("Сбросить точки");
@@ -110,7 +118,17 @@ QWidget* MainWindow::createBezierControls()
 
     connect(resetPointsButton, &QPushButton::clicked, this, &MainWindow::onResetPoints);
     connect(showPolygonCheckBox, &QCheckBox::toggled, glWidget, &GLWidget::setShowControlPolygon);
-    connect(pointTable, &QTableWidget::cellChanged, this, &MainWindow::onPointChanged);
+    connect(pointTable, &PointTableWidget::pointEdited, this, &MainWindow::onPointChanged);
+    connect(pointTable, &PointTableWidget::pointsPasted, this, &MainWindow::onPointsPasted);
+    // Правки и условия гладкости обновляют только свои строки таблицы
+    connect(glWidget, &GLWidget::controlPointsChanged, pointTable, &PointTableWidget::pointsChanged);
+    connect(glWidget, &GLWidget::controlPointCountChanged, this, [this] {
+        pointTable->pointsReset();
+        updateStatus();
+    });
+    connect(glWidget, &GLWidget::zbufferModelLoadFailed, this, [this](const QString&, const QString& error) {
+        QMessageBox::warning(this, "Ошибка загрузки", error);
+    });
 
     return panel;
 }
@@ -226,7 +244,7 @@ QWidget* MainWindow::createZBufferControls()
 
     QLabel* objectsLabel = new QLabel("Количество многогранников:");
     zbufferObjectsSpinBox = new QSpinBox;
-    zbufferObjectsSpinBox->setRange(1, 10);
+    zbufferObjectsSpinBox->setRange(1, 100000);
     zbufferObjectsSpinBox->setValue(3);
 
     objectsLayout->addWidget(objectsLabel);
@@ -235,8 +253,24 @@ QWidget* MainWindow::createZBufferControls()
     QPushButton* generateButton = new QPushButton("Сгенерировать сцену");
     objectsLayout->addWidget(generateButton);
 
+    QPushButton* loadModelButton = new QPushButton("Загрузить модель OBJ...");
+    objectsLayout->addWidget(loadModelButton);
+
     objectsGroup->setLayout(objectsLayout);
 
+    QGroupBox* visibilityGroup = new QGroupBox("Определение видимости");
+    QVBoxLayout* visibilityLayout = new QVBoxLayout;
+
+    QComboBox* visibilityComboBox = new QComboBox;
+    visibilityComboBox->addItem("Z-буфер (Hi-Z отсечение)");
+    visibilityComboBox->addItem("BSP-дерево (от дальних к ближним)");
+    visibilityLayout->addWidget(visibilityComboBox);
+
+    QPushButton* benchmarkButton = new QPushButton("Сравнить BSP и Z-буфер");
+    visibilityLayout->addWidget(benchmarkButton);
+
+    visibilityGroup->setLayout(visibilityLayout);
+
     QGroupBox* infoGroup = new QGroupBox("Информация");
     QVBoxLayout* infoLayout = new QVBoxLayout;
     QLabel* infoLabel = new QLabel("Алгоритм Z-буфера для определения видимости многогранников");
@@ -245,11 +279,16 @@ QWidget* MainWindow::createZBufferControls()
     infoGroup->setLayout(infoLayout);
 
     layout->addWidget(objectsGroup);
+    layout->addWidget(visibilityGroup);
     layout->addWidget(infoGroup);
 
     connect(zbufferObjectsSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
             this, &MainWindow::onZBufferObjectsChanged);
     connect(generateButton, &QPushButton::clicked, glWidget, &GLWidget::generateZBufferScene);
+    connect(loadModelButton, &QPushButton::clicked, this, &MainWindow::onLoadZBufferModel);
+    connect(visibilityComboBox, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &MainWindow::onVisibilityModeChanged);
+    connect(benchmarkButton, &QPushButton::clicked, this, &MainWindow::onVisibilityBenchmark);
 
     return panel;
 }
@@ -269,20 +308,54 @@ QWidget* MainWindow::createRayTracingControls() // ДОБАВЬТЕ QWidget*
     rayTracingQualitySpinBox->setPrefix("Уровень ");
 
     QLabel* description = new QLabel(
-        "1: Базовые лучи\n"
-        "2: Больше лучей\n"
-        "3: Точки попадания\n"
-        "4: Отражения\n"
-        "5: Максимальная детализация"
+        "1: 1 выборка на пиксель, 1 отражение\n"
+        "2: 2 выборки, 2 отражения\n"
+        "3: 4 выборки, 3 отражения\n"
+        "4: 8 выборок, 4 отражения\n"
+        "5: 16 выборок, 6 отражений"
         );
     description->setWordWrap(true);
 
+    frameBudgetCheckBox = new QCheckBox("Бюджет кадра");
+    frameBudgetSpinBox = new QSpinBox;
+    frameBudgetSpinBox->setRange(5, 2000);
+    frameBudgetSpinBox->setValue(50);
+    frameBudgetSpinBox->setSuffix(" мс");
+    frameBudgetSpinBox->setEnabled(false);
+
+    QLabel* budgetDescription = new QLabel(
+        "Разрешение, выборки и глубина подбираются по измеренной скорости, "
+        "затем выборки добавляются только шумным пикселям"
+        );
+    budgetDescription->setWordWrap(true);
+
+    QLabel* rayCountLabel = new QLabel("Лучей на экране:");
+    QSpinBox* rayCountSpinBox = new QSpinBox;
+    rayCountSpinBox->setRange(0, 100000);
+    rayCountSpinBox->setSingleStep(1000);
+    rayCountSpinBox->setSpecialValueText("по качеству");
+
     QPushButton* renderButton = new QPushButton("Обновить трассировку");
 
+    QCheckBox* showImageCheckBox = new QCheckBox("Показывать результат трассировки");
+    showImageCheckBox->setChecked(true);
+
+    QCheckBox* tileTimingsCheckBox = new QCheckBox("Показывать время плиток");
+
+    QPushButton* simdBenchmarkButton = new QPushButton("Сравнить SIMD-варианты");
+
     qualityLayout->addWidget(qualityLabel);
     qualityLayout->addWidget(rayTracingQualitySpinBox);
     qualityLayout->addWidget(description);
+    qualityLayout->addWidget(frameBudgetCheckBox);
+    qualityLayout->addWidget(frameBudgetSpinBox);
+    qualityLayout->addWidget(budgetDescription);
+    qualityLayout->addWidget(rayCountLabel);
+    qualityLayout->addWidget(rayCountSpinBox);
     qualityLayout->addWidget(renderButton);
+    qualityLayout->addWidget(showImageCheckBox);
+    qualityLayout->addWidget(tileTimingsCheckBox);
+    qualityLayout->addWidget(simdBenchmarkButton);
 
     qualityGroup->setLayout(qualityLayout);
 
@@ -305,11 +378,50 @@ QWidget* MainWindow::createRayTracingControls() // ДОБАВЬТЕ QWidget*
 
     connect(rayTracingQualitySpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
             this, &MainWindow::onRayTracingQualityChanged);
+    connect(frameBudgetCheckBox, &QCheckBox::toggled, this, &MainWindow::onFrameBudgetChanged);
+    connect(frameBudgetSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
+            this, &MainWindow::onFrameBudgetChanged);
+    connect(rayCountSpinBox, QOverload<int>::of(&QSpinBox::valueChanged),
+            glWidget, &GLWidget::setRayVisualizationCount);
     connect(renderButton, &QPushButton::clicked, glWidget, &GLWidget::renderRayTracing);
+    connect(showImageCheckBox, &QCheckBox::toggled, glWidget, &GLWidget::setShowRayTracedImage);
+    connect(tileTimingsCheckBox, &QCheckBox::toggled, glWidget, &GLWidget::setShowTileTimings);
+    connect(simdBenchmarkButton, &QPushButton::clicked, this, &MainWindow::onRayTracingBenchmark);
 
     return panel; // НЕ ЗАБУДЬТЕ ВЕРНУТЬ panel
 }
 
+QWidget* MainWindow::createProfilerControls()
+{
+    QGroupBox* profilerGroup = new QGroupBox("Профилирование");
+    QVBoxLayout* profilerLayout = new QVBoxLayout;
+
+    QCheckBox* profilerCheckBox = new QCheckBox("Профиль кадра по стадиям");
+    profilerLayout->addWidget(profilerCheckBox);
+
+    QCheckBox* gpuTimersCheckBox = new QCheckBox("Время кадра на GPU");
+    profilerLayout->addWidget(gpuTimersCheckBox);
+
+    QPushButton* exportTraceButton = new QPushButton("Экспорт трассы Chrome...");
+    profilerLayout->addWidget(exportTraceButton);
+
+    // Записанный сеанс повторяется без окна: --headless --replay файл
+    QPushButton* recordSessionButton = new QPushButton("Записать сеанс");
+    recordSessionButton->setCheckable(true);
+    profilerLayout->addWidget(recordSessionButton);
+
+    profilerGroup->setLayout(profilerLayout);
+
+    connect(profilerCheckBox, &QCheckBox::toggled, glWidget, [this](bool enabled) {
+        glWidget->setProfilingEnabled(enabled);
+    });
+    connect(gpuTimersCheckBox, &QCheckBox::toggled, glWidget, &GLWidget::setGpuTimers);
+    connect(exportTraceButton, &QPushButton::clicked, this, &MainWindow::onExportTrace);
+    connect(recordSessionButton, &QPushButton::toggled, this, &MainWindow::onSessionRecordingToggled);
+
+    return profilerGroup;
+}
+
 void MainWindow::setupBezierCurveTheme()
 {
     controlStackedWidget->setCurrentIndex(0);
@@ -374,32 +486,131 @@ void MainWindow::onZBufferObjectsChanged(int count) {
     glWidget->setZBufferObjectsCount(count);
 }
 
+void MainWindow::onLoadZBufferModel()
+{
+    QString fileName = QFileDialog::getOpenFileName(this, "Загрузить модель", QString(),
+                                                    "Модели OBJ (*.obj)");
+    if (fileName.isEmpty()) return;
+
+    glWidget->loadZBufferModel(fileName);
+}
+
+void MainWindow::onExportTrace()
+{
+    QString fileName = QFileDialog::getSaveFileName(this, "Экспорт трассы", "trace.json",
+                                                    "Трасса Chrome (*.json)");
+    if (fileName.isEmpty()) return;
+
+    QString error;
+    if (!glWidget->exportTrace(fileName, &error)) {
+        QMessageBox::warning(this, "Ошибка экспорта", error);
+    }
+}
+
+void MainWindow::onSessionRecordingToggled(bool recording)
+{
+    QPushButton* button = qobject_cast<QPushButton*>(sender());
+    if (recording) {
+        glWidget->startSessionRecording();
+        if (button) button->setText("Остановить запись сеанса");
+        return;
+    }
+
+    glWidget->stopSessionRecording();
+    if (button) button->setText("Записать сеанс");
+
+    QString fileName = QFileDialog::getSaveFileName(this, "Сохранить сеанс", "session.txt",
+                                                    "Журнал сеанса (*.txt)");
+    if (fileName.isEmpty()) return;
+
+    QString error;
+    if (!glWidget->saveSession(fileName, &error)) {
+        QMessageBox::warning(this, "Ошибка сохранения", error);
+    }
+}
+
+void MainWindow::onVisibilityModeChanged(int index)
+{
+    glWidget->setVisibilityMode(index == 1 ? GLWidget::VISIBILITY_BSP : GLWidget::VISIBILITY_ZBUFFER);
+}
+
+void MainWindow::onVisibilityBenchmark()
+{
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    std::vector<BenchmarkResult> results = runVisibilityBenchmark();
+    QApplication::restoreOverrideCursor();
+
+    QMessageBox box(this);
+    box.setWindowTitle("BSP-дерево и Z-буфер");
+    box.setText("<pre>" + QString::fromStdString(formatBenchmarkResults(results)).toHtmlEscaped() + "</pre>");
+    box.exec();
+}
+
+void MainWindow::onRayTracingBenchmark()
+{
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    std::vector<BenchmarkResult> results = runRayTracingBenchmark();
+    QApplication::restoreOverrideCursor();
+
+    QMessageBox box(this);
+    box.setWindowTitle("SIMD-ядра трассировки лучей");
+    box.setText("<pre>" + QString::fromStdString(formatBenchmarkResults(results)).toHtmlEscaped() + "</pre>");
+    box.exec();
+}
+
 void MainWindow::onRayTracingQualityChanged(int quality) {
     glWidget->setRayTracingQuality(quality);
 }
 
+void MainWindow::onFrameBudgetChanged()
+{
+    // В режиме бюджета уровень качества не используется
+    bool budgeted = frameBudgetCheckBox->isChecked();
+    frameBudgetSpinBox->setEnabled(budgeted);
+    rayTracingQualitySpinBox->setEnabled(!budgeted);
+    glWidget->setFrameBudget(budgeted ? frameBudgetSpinBox->value() : 0.0);
+}
+
 void MainWindow::onPointChanged(int row, int column)
 {
-    std::vector<Point3D> points = pointTable->getPoints();
-    if (row < points.size()) {
-        glWidget->updateControlPoint(row, points[row].x, points[row].y, points[row].z);
+    // Таблица уже записала число в массив точек: применяется только эта ячейка
+    const Point3D& point = (*glWidget->controlPointStorage())[row];
+    glWidget->updateControlPointCoordinate(row, column, column == 0 ? point.x : column == 1 ? point.y : point.z);
+}
+
+void MainWindow::onPointsPasted(int row, int column, const std::vector<std::vector<double>>& values)
+{
+    // Вставленный блок - одна пакетная правка: строки за концом таблицы
+    // добавляют точки, пустые ячейки (NaN) оставляют координату как есть
+    const std::vector<Point3D>& current = *glWidget->controlPointStorage();
+    std::vector<Point3D> points(values.size());
+    for (size_t r = 0; r < values.size(); r++) {
+        const size_t index = size_t(row) + r;
+        if (index < current.size()) {
+            points[r] = current[index];
+        } else if (r > 0) {
+            points[r] = points[r - 1];
+        } else if (!current.empty()) {
+            points[r] = current.back();
+        }
+        for (size_t c = 0; c < values[r].size() && column + c < 3; c++) {
+            if (std::isnan(values[r][c])) continue;
+            double& coordinate = column + c == 0 ? points[r].x : column + c == 1 ? points[r].y : points[r].z;
+            coordinate = values[r][c];
+        }
     }
-    updateStatus();
+    glWidget->updateControlPoints(row, points);
 }
 
 void MainWindow::onResetPoints()
 {
     glWidget->initializeControlPoints();
     glWidget->calculateBezierCurve();
-    updatePointTable();
-    updateStatus();
 }
 
 void MainWindow::updatePointTable()
 {
-    pointTable->blockSignals(true);
-    pointTable->updatePoints(glWidget->getControlPoints());
-    pointTable->blockSignals(false);
+    pointTable->pointsReset();
 }
 
 void MainWindow::onAboutClicked()
@@ -416,10 +627,9 @@ void MainWindow::onAboutClicked()
 
 void MainWindow::updateStatus()
 {
-    auto points = glWidget->getControlPoints();
     QString themeName = themeComboBox->currentText();
     QString status = QString("Тема: %1\nТочек: %2")
                          .arg(themeName)
-                         .arg(points.size());
+                         .arg(glWidget->controlPointCount());
     statusLabel->setText(status);
 }
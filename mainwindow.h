@@ -22,6 +22,7 @@ public:
 
 private slots:
     void onPointChanged(int row, int column);
+    void onPointsPasted(int row, int column, const std::vector<std::vector<double>>& values);
     void onResetPoints();
     void onAboutClicked();
     void updateStatus();
@@ -29,7 +30,14 @@ private slots:
     void onBSplineOrderChanged(int order);
     void onClippingWindowChanged();
     void onZBufferObjectsChanged(int count);
+    void onLoadZBufferModel();
+    void onVisibilityModeChanged(int index);
+    void onVisibilityBenchmark();
     void onRayTracingQualityChanged(int quality);
+    void onRayTracingBenchmark();
+    void onFrameBudgetChanged();
+    void onExportTrace();
+    void onSessionRecordingToggled(bool recording);
 
 private:
     void createControlPanels();
@@ -38,6 +46,7 @@ private:
     QWidget* createClippingControls();
     QWidget* createZBufferControls();
     QWidget* createRayTracingControls();
+    QWidget* createProfilerControls();
     void updatePointTable();
     void setupBezierCurveTheme();
     void setupBSplineSurfaceTheme();
@@ -60,6 +69,8 @@ private:
     QDoubleSpinBox* clipTopSpinBox;
     QSpinBox* zbufferObjectsSpinBox;
     QSpinBox* rayTracingQualitySpinBox;
+    QCheckBox* frameBudgetCheckBox;
+    QSpinBox* frameBudgetSpinBox;
 };
 
 #endif // MAINWINDOW_H
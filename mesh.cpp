@@ -0,0 +1,342 @@
+#include "mesh.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+void IndexedMesh::bounds(Point3D& min, Point3D& max) const
+{
+    min = Point3D(1e300, 1e300, 1e300);
+    max = Point3D(-1e300, -1e300, -1e300);
+    for (const auto& v : vertices) {
+        min.x = std::min(min.x, v.x); max.x = std::max(max.x, v.x);
+        min.y = std::min(min.y, v.y); max.y = std::max(max.y, v.y);
+        min.z = std::min(min.z, v.z); max.z = std::max(max.z, v.z);
+    }
+}
+
+namespace {
+
+struct VertexKey {
+    double x, y, z;
+    bool operator==(const VertexKey& o) const { return x == o.x && y == o.y && z == o.z; }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey& k) const
+    {
+        std::hash<double> h;
+        size_t seed = h(k.x);
+        seed ^= h(k.y) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+        seed ^= h(k.z) + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+        return seed;
+    }
+};
+
+} // namespace
+
+void IndexedMesh::deduplicateVertices()
+{
+    std::unordered_map<VertexKey, unsigned int, VertexKeyHash> unique;
+    unique.reserve(vertices.size());
+
+    std::vector<Point3D> merged;
+    std::vector<unsigned int> remap(vertices.size());
+    merged.reserve(vertices.size());
+
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const Point3D& v = vertices[i];
+        auto it = unique.emplace(VertexKey{v.x, v.y, v.z}, unsigned(merged.size()));
+        if (it.second) merged.push_back(v);
+        remap[i] = it.first->second;
+    }
+
+    // Переиндексируем и выбрасываем вырожденные треугольники
+    std::vector<unsigned int> remapped;
+    remapped.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        unsigned int a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+        if (a == b || b == c || a == c) continue;
+        remapped.push_back(a);
+        remapped.push_back(b);
+        remapped.push_back(c);
+    }
+
+    vertices.swap(merged);
+    indices.swap(remapped);
+}
+
+void IndexedMesh::fitToSize(double size)
+{
+    if (vertices.empty()) return;
+
+    Point3D min, max;
+    bounds(min, max);
+    double extent = std::max({max.x - min.x, max.y - min.y, max.z - min.z});
+    double scale = extent > 0 ? size / extent : 1.0;
+    Point3D center((min.x + max.x) * 0.5, (min.y + max.y) * 0.5, (min.z + max.z) * 0.5);
+
+    for (auto& v : vertices) {
+        v = Point3D((v.x - center.x) * scale, (v.y - center.y) * scale, (v.z - center.z) * scale);
+    }
+}
+
+IndexedMesh makePyramidMesh(const Point3D& center, double size)
+{
+    const double x = center.x, y = center.y, z = center.z;
+
+    IndexedMesh mesh;
+    mesh.vertices = {
+        Point3D(x - size, y - size, z), // основание
+        Point3D(x + size, y - size, z),
+        Point3D(x + size, y + size, z),
+        Point3D(x - size, y + size, z),
+        Point3D(x, y, z + size * 2)     // вершина
+    };
+    mesh.indices = {
+        0, 2, 1, 0, 3, 2,   // основание
+        0, 1, 4, 1, 2, 4,   // боковые грани
+        2, 3, 4, 3, 0, 4
+    };
+    return mesh;
+}
+
+IndexedMesh makeSphereMesh(int slices, int stacks)
+{
+    IndexedMesh mesh;
+    mesh.vertices.reserve(size_t(slices + 1) * (stacks + 1));
+    for (int j = 0; j <= stacks; j++) {
+        double phi = j * M_PI / stacks;
+        for (int i = 0; i <= slices; i++) {
+            double theta = i * 2 * M_PI / slices;
+            mesh.vertices.push_back(Point3D(sin(phi) * cos(theta), sin(phi) * sin(theta), cos(phi)));
+        }
+    }
+
+    // Полосы между соседними параллелями; вырожденные треугольники у полюсов не нужны
+    const unsigned int row = unsigned(slices + 1);
+    for (int j = 0; j < stacks; j++) {
+        for (int i = 0; i < slices; i++) {
+            unsigned int a = unsigned(j) * row + unsigned(i);
+            unsigned int b = a + row;
+            if (j > 0) mesh.indices.insert(mesh.indices.end(), {a, b, a + 1});
+            if (j < stacks - 1) mesh.indices.insert(mesh.indices.end(), {a + 1, b, b + 1});
+        }
+    }
+    return mesh;
+}
+
+IndexedMesh makeTorusMesh(int rings, int sides, double minorRadius)
+{
+    IndexedMesh mesh;
+    mesh.vertices.reserve(size_t(rings + 1) * (sides + 1));
+    for (int i = 0; i <= rings; i++) {
+        double theta = i * 2 * M_PI / rings;
+        for (int j = 0; j <= sides; j++) {
+            double phi = j * 2 * M_PI / sides;
+            double radius = 1.0 + minorRadius * cos(phi);
+            mesh.vertices.push_back(Point3D(radius * cos(theta), radius * sin(theta), minorRadius * sin(phi)));
+        }
+    }
+
+    const unsigned int row = unsigned(sides + 1);
+    for (int i = 0; i < rings; i++) {
+        for (int j = 0; j < sides; j++) {
+            unsigned int a = unsigned(i) * row + unsigned(j);
+            unsigned int b = a + row;
+            mesh.indices.insert(mesh.indices.end(), {a, b, b + 1, a, b + 1, a + 1});
+        }
+    }
+    return mesh;
+}
+
+int selectPrimitiveLod(double screenDiameter, int currentLevel)
+{
+    const double maxEdge = 6.0;         // Пикселей на ребро силуэта
+    const double hysteresis = 0.75;
+
+    // Самый грубый уровень, у которого ребро не длиннее edge
+    auto coarsest = [screenDiameter](double edge) {
+        int level = 0;
+        while (level + 1 < primitiveLodCount && M_PI * screenDiameter / primitiveLodSlices[level] > edge) {
+            level++;
+        }
+        return level;
+    };
+
+    const int up = coarsest(maxEdge);
+    if (currentLevel < 0 || currentLevel < up) return up;
+    const int down = coarsest(maxEdge * hysteresis);
+    return std::min(currentLevel, down);
+}
+
+const IndexedMesh& cachedPrimitiveMesh(PrimitiveMeshKey key)
+{
+    static std::mutex mutex;
+    static std::map<PrimitiveMeshKey, std::unique_ptr<IndexedMesh>> cache;
+
+    if (key.shape == PrimitiveMeshKey::BOX || key.shape == PrimitiveMeshKey::PYRAMID) {
+        key.slices = key.stacks = 0;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::unique_ptr<IndexedMesh>& mesh = cache[key];
+    if (!mesh) {
+        switch (key.shape) {
+        case PrimitiveMeshKey::SPHERE:
+            mesh.reset(new IndexedMesh(makeSphereMesh(key.slices, key.stacks)));
+            break;
+        case PrimitiveMeshKey::BOX:
+            mesh.reset(new IndexedMesh(makeBoxMesh()));
+            break;
+        case PrimitiveMeshKey::PYRAMID:
+            mesh.reset(new IndexedMesh(makePyramidMesh(Point3D(0, 0, 0), 1.0)));
+            break;
+        case PrimitiveMeshKey::TORUS:
+            mesh.reset(new IndexedMesh(makeTorusMesh(key.slices, key.stacks, 0.3)));
+            break;
+        }
+    }
+    return *mesh;
+}
+
+IndexedMesh makeBoxMesh()
+{
+    IndexedMesh mesh;
+    for (int i = 0; i < 8; i++) {
+        mesh.vertices.push_back(Point3D(i & 1 ? 1 : -1, i & 2 ? 1 : -1, i & 4 ? 1 : -1));
+    }
+    mesh.indices = {
+        0, 2, 3, 0, 3, 1,   // z = -1
+        4, 5, 7, 4, 7, 6,   // z = +1
+        0, 1, 5, 0, 5, 4,   // y = -1
+        2, 6, 7, 2, 7, 3,   // y = +1
+        0, 4, 6, 0, 6, 2,   // x = -1
+        1, 3, 7, 1, 7, 5    // x = +1
+    };
+    return mesh;
+}
+
+namespace {
+
+// Число в [p, end) после пробелов; p сдвигается за него. Разбор не выходит
+// за конец строки, в отличие от strtod, пропускающего и переводы строк
+template <typename T>
+bool parseObjNumber(const char*& p, const char* end, T& value)
+{
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    const char* first = p < end && *p == '+' ? p + 1 : p;
+    std::from_chars_result result = std::from_chars(first, end, value);
+    if (result.ec != std::errc()) return false;
+    p = result.ptr;
+    return true;
+}
+
+// Разбор одной строки OBJ; указатели line..end без символа перевода строки
+void parseObjLine(const char* line, const char* end, IndexedMesh& mesh,
+                  std::vector<long>& face)
+{
+    while (line < end && (*line == ' ' || *line == '\t')) line++;
+    if (end - line < 2) return;
+
+    if (line[0] == 'v' && (line[1] == ' ' || line[1] == '\t')) {
+        // Недостающие координаты равны нулю
+        const char* p = line + 2;
+        double x = 0, y = 0, z = 0;
+        parseObjNumber(p, end, x) && parseObjNumber(p, end, y) && parseObjNumber(p, end, z);
+        mesh.vertices.push_back(Point3D(x, y, z));
+    } else if (line[0] == 'f' && (line[1] == ' ' || line[1] == '\t')) {
+        face.clear();
+        const char* p = line + 2;
+        while (p < end) {
+            while (p < end && (*p == ' ' || *p == '\t')) p++;
+            if (p >= end) break;
+
+            long index = 0;
+            if (!parseObjNumber(p, end, index)) break;
+            // Отрицательные индексы отсчитываются от последней вершины
+            index = index < 0 ? long(mesh.vertices.size()) + index : index - 1;
+            face.push_back(index);
+
+            // Пропускаем /vt/vn
+            while (p < end && *p != ' ' && *p != '\t') p++;
+        }
+
+        const long count = long(mesh.vertices.size());
+        for (size_t i = 1; i + 1 < face.size(); i++) {
+            if (face[0] < 0 || face[i] < 0 || face[i + 1] < 0 ||
+                face[0] >= count || face[i] >= count || face[i + 1] >= count) {
+                continue;
+            }
+            mesh.indices.push_back(unsigned(face[0]));
+            mesh.indices.push_back(unsigned(face[i]));
+            mesh.indices.push_back(unsigned(face[i + 1]));
+        }
+    }
+}
+
+} // namespace
+
+bool loadObjMesh(const std::string& path, IndexedMesh& mesh, std::string* error)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        if (error) *error = "Не удалось открыть файл " + path;
+        return false;
+    }
+
+    mesh.vertices.clear();
+    mesh.indices.clear();
+
+    // Читаем файл блоками, неполная строка переносится в начало следующего блока
+    const size_t chunkSize = 1 << 20;
+    std::vector<char> buffer(chunkSize);
+    std::vector<long> face;
+    size_t carry = 0;
+
+    while (true) {
+        if (carry == buffer.size()) {
+            buffer.resize(buffer.size() * 2); // строка длиннее блока
+        }
+        size_t read = fread(buffer.data() + carry, 1, buffer.size() - carry, file);
+        size_t size = carry + read;
+        bool eof = read == 0;
+
+        const char* begin = buffer.data();
+        const char* end = begin + size;
+        const char* line = begin;
+        while (true) {
+            const char* newline = static_cast<const char*>(memchr(line, '\n', end - line));
+            if (!newline) break;
+            const char* lineEnd = newline;
+            if (lineEnd > line && lineEnd[-1] == '\r') lineEnd--;
+            parseObjLine(line, lineEnd, mesh, face);
+            line = newline + 1;
+        }
+
+        carry = size_t(end - line);
+        if (eof) {
+            if (carry > 0) {
+                // Последняя строка без перевода строки
+                parseObjLine(buffer.data(), buffer.data() + carry, mesh, face);
+            }
+            break;
+        }
+        memmove(buffer.data(), line, carry);
+    }
+
+    fclose(file);
+
+    if (mesh.indices.empty()) {
+        if (error) *error = "В файле нет треугольных граней";
+        return false;
+    }
+
+    mesh.deduplicateVertices();
+    return true;
+}
@@ -0,0 +1,82 @@
+#ifndef MESH_H
+#define MESH_H
+
+#include "geometry.h"
+#include <string>
+#include <vector>
+
+// Индексированная треугольная сетка: общие вершины и буфер индексов
+// (по три индекса на треугольник)
+struct IndexedMesh {
+    std::vector<Point3D> vertices;
+    std::vector<unsigned int> indices;
+
+    size_t triangleCount() const { return indices.size() / 3; }
+    void bounds(Point3D& min, Point3D& max) const;
+
+    // Объединяет вершины с совпадающими координатами
+    void deduplicateVertices();
+    // Переносит и масштабирует сетку так, чтобы она вписалась в куб со стороной size
+    void fitToSize(double size);
+};
+
+// Экземпляр общей сетки: перенос, равномерный масштаб и цвет.
+// Раскладка совпадает с буфером экземпляров на GPU
+struct MeshInstance {
+    float x, y, z, scale;
+    float r, g, b;
+};
+
+// Пирамида с квадратным основанием 2 * size в плоскости z = center.z
+// и вершиной на высоте 2 * size (как в generateZBufferScene).
+// Грани ориентированы наружу: по ним трассировщик отличает вход в стекло от выхода
+IndexedMesh makePyramidMesh(const Point3D& center, double size);
+
+// Единичная сфера: slices делений по долготе, stacks - по широте
+IndexedMesh makeSphereMesh(int slices, int stacks);
+
+// Куб [-1, 1]^3, грани ориентированы наружу
+IndexedMesh makeBoxMesh();
+
+// Тор в плоскости XY: большой радиус 1, радиус трубки minorRadius;
+// rings делений по большой окружности, sides - по трубке
+IndexedMesh makeTorusMesh(int rings, int sides, double minorRadius);
+
+// Стандартный примитив и его тесселяция. Для BOX и PYRAMID (единичная
+// пирамида makePyramidMesh) slices и stacks не используются; у TORUS
+// slices - деления по большой окружности, stacks - по трубке радиуса 0.3
+struct PrimitiveMeshKey {
+    enum Shape { SPHERE, BOX, PYRAMID, TORUS };
+
+    Shape shape;
+    int slices;
+    int stacks;
+
+    bool operator<(const PrimitiveMeshKey& o) const
+    {
+        if (shape != o.shape) return shape < o.shape;
+        if (slices != o.slices) return slices < o.slices;
+        return stacks < o.stacks;
+    }
+};
+
+// Уровни детализации сферы: primitiveLodSlices[level] делений по долготе и широте
+const int primitiveLodCount = 4;
+const int primitiveLodSlices[primitiveLodCount] = {6, 12, 24, 48};
+
+// Уровень детализации по диаметру сферы на экране в пикселях: ребро
+// силуэта не длиннее нескольких пикселей. Гистерезис: уровень понижается,
+// только когда и более грубый дает заметно короче ребра, поэтому на
+// границе уровней при повороте и изменении размера сетка не скачет.
+// currentLevel < 0 - уровень еще не выбирался
+int selectPrimitiveLod(double screenDiameter, int currentLevel);
+
+// Сетка примитива строится один раз на ключ и живет до конца программы
+// (ссылка остается действительной). Потокобезопасно
+const IndexedMesh& cachedPrimitiveMesh(PrimitiveMeshKey key);
+
+// Потоковая загрузка OBJ: читаются только вершины (v) и грани (f),
+// многоугольники разбиваются веером на треугольники
+bool loadObjMesh(const std::string& path, IndexedMesh& mesh, std::string* error = nullptr);
+
+#endif // MESH_H
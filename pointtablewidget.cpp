@@ -1,32 +1,69 @@
 #include "pointtablewidget.h"
-#include "glwidget.h"
+#include <QApplication>
+#include <QClipboard>
 #include <QHeaderView>
+#include <QKeyEvent>
+#include <limits>
 
-PointTableWidget::PointTableWidget(QWidget* parent) : QTableWidget(parent)
+PointTableWidget::PointTableWidget(QWidget* parent)
+    : QTableView(parent),
+    pointModel(new ControlPointModel(this))
 {
-    setColumnCount(3);
-    setHorizontalHeaderLabels({"X", "Y", "Z"});
+    setModel(pointModel);
     verticalHeader()->setVisible(true);
+    // Высота строк не зависит от содержимого: без обхода всех строк
+    verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    verticalHeader()->setDefaultSectionSize(fontMetrics().height() + 6);
+
+    connect(pointModel, &ControlPointModel::coordinateEdited, this, &PointTableWidget::pointEdited);
 }
 
-void PointTableWidget::updatePoints(const std::vector<Point3D>& points)
+void PointTableWidget::setPoints(std::vector<Point3D>* points)
 {
-    setRowCount(points.size());
-    for (size_t i = 0; i < points.size(); i++) {
-        setItem(i, 0, new QTableWidgetItem(QString::number(points[i].x, 'f', 2)));
-        setItem(i, 1, new QTableWidgetItem(QString::number(points[i].y, 'f', 2)));
-        setItem(i, 2, new QTableWidgetItem(QString::number(points[i].z, 'f', 2)));
-    }
+    pointModel->setPoints(points);
 }
 
-std::vector<Point3D> PointTableWidget::getPoints() const
+void PointTableWidget::pointsReset()
 {
-    std::vector<Point3D> points;
-    for (int i = 0; i < rowCount(); i++) {
-        double x = item(i, 0)->text().toDouble();
-        double y = item(i, 1)->text().toDouble();
-        double z = item(i, 2)->text().toDouble();
-        points.push_back(Point3D(x, y, z));
+    pointModel->pointsReset();
+}
+
+void PointTableWidget::pointsChanged(int first, int last)
+{
+    pointModel->pointsChanged(first, last);
+}
+
+void PointTableWidget::keyPressEvent(QKeyEvent* event)
+{
+    if (!event->matches(QKeySequence::Paste)) {
+        QTableView::keyPressEvent(event);
+        return;
+    }
+
+    // Таблица из электронной таблицы: строки через перевод строки,
+    // ячейки через табуляцию, десятичная запятая допускается
+    QString text = QApplication::clipboard()->text();
+    text.replace("\r\n", "\n");
+    QStringList lines = text.split('\n');
+    while (!lines.isEmpty() && lines.last().trimmed().isEmpty()) {
+        lines.removeLast();
     }
-    return points;
+    if (lines.isEmpty()) return;
+
+    std::vector<std::vector<double>> values;
+    values.reserve(lines.size());
+    for (const QString& line : lines) {
+        const QStringList cells = line.split('\t');
+        std::vector<double> row;
+        row.reserve(cells.size());
+        for (QString cell : cells) {
+            bool ok = false;
+            double value = cell.trimmed().replace(',', '.').toDouble(&ok);
+            row.push_back(ok ? value : std::numeric_limits<double>::quiet_NaN());
+        }
+        values.push_back(std::move(row));
+    }
+
+    const QModelIndex start = currentIndex();
+    emit pointsPasted(start.isValid() ? start.row() : 0, start.isValid() ? start.column() : 0, values);
 }
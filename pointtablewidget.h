@@ -1,19 +1,37 @@
 #ifndef POINTTABLEWIDGET_H
 #define POINTTABLEWIDGET_H
 
-#include <QTableWidget>
+#include <QTableView>
 #include <vector>
+#include "controlpointmodel.h"
 
 struct Point3D;
 
-class PointTableWidget : public QTableWidget
+// Вид таблицы контрольных точек: строки фиксированной высоты, поэтому
+// заголовок не измеряет каждую строку и миллион точек открывается сразу
+class PointTableWidget : public QTableView
 {
     Q_OBJECT
 
 public:
     PointTableWidget(QWidget* parent = nullptr);
-    void updatePoints(const std::vector<Point3D>& points);
-    std::vector<Point3D> getPoints() const;
+
+    // Показывает массив без копирования (см. ControlPointModel)
+    void setPoints(std::vector<Point3D>* points);
+    void pointsReset();
+    void pointsChanged(int first, int last);
+
+signals:
+    void pointEdited(int row, int column);
+    // Блок из буфера обмена (строки - точки, столбцы через табуляцию)
+    // от ячейки row, column; NaN - пустая или нечисловая ячейка
+    void pointsPasted(int row, int column, const std::vector<std::vector<double>>& values);
+
+protected:
+    void keyPressEvent(QKeyEvent* event) override;
+
+private:
+    ControlPointModel* pointModel;
 };
 
 #endif // POINTTABLEWIDGET_H
@@ -0,0 +1,169 @@
+#include "profiler.h"
+#include <algorithm>
+#include <cstdio>
+
+Profiler::Profiler(size_t historySize, size_t traceCapacity)
+    : historySize(historySize),
+    traceCapacity(traceCapacity),
+    enabled(false),
+    origin(Clock::now()),
+    traceNext(0)
+{
+}
+
+void Profiler::setEnabled(bool value)
+{
+    enabled = value;
+}
+
+int Profiler::stageIndex(const char* stage)
+{
+    auto it = stageIndices.find(stage);
+    if (it != stageIndices.end()) return it->second;
+
+    int index = int(stageList.size());
+    stageList.push_back(Stage());
+    stageList.back().name = stage;
+    stageList.back().history.reserve(historySize);
+    stageIndices.emplace(stage, index);
+    return index;
+}
+
+int Profiler::threadIndex(std::thread::id id)
+{
+    auto it = std::find(threads.begin(), threads.end(), id);
+    if (it != threads.end()) return int(it - threads.begin());
+    threads.push_back(id);
+    return int(threads.size()) - 1;
+}
+
+void Profiler::add(int index, Clock::time_point start, double milliseconds)
+{
+    Stage& stage = stageList[index];
+    if (stage.history.size() < historySize) {
+        stage.history.push_back(float(milliseconds));
+    } else {
+        stage.history[stage.count % historySize] = float(milliseconds);
+    }
+    stage.count++;
+
+    TraceEvent event;
+    event.stage = index;
+    event.thread = threadIndex(std::this_thread::get_id());
+    event.startMicroseconds = std::chrono::duration_cast<std::chrono::microseconds>(start - origin).count();
+    event.durationMicroseconds = int64_t(milliseconds * 1000.0);
+    if (trace.size() < traceCapacity) {
+        trace.push_back(event);
+    } else {
+        trace[traceNext] = event;
+    }
+    traceNext = (traceNext + 1) % traceCapacity;
+}
+
+void Profiler::record(const char* stage, Clock::time_point start, Clock::time_point end)
+{
+    if (!isEnabled()) return;
+    std::lock_guard<std::mutex> lock(mutex);
+    add(stageIndex(stage), start, std::chrono::duration<double, std::milli>(end - start).count());
+}
+
+void Profiler::recordDuration(const char* stage, double milliseconds)
+{
+    if (!isEnabled()) return;
+    const auto start = Clock::now() - std::chrono::duration_cast<Clock::duration>(
+                                          std::chrono::duration<double, std::milli>(milliseconds));
+    std::lock_guard<std::mutex> lock(mutex);
+    add(stageIndex(stage), start, milliseconds);
+}
+
+Profiler::StageStats Profiler::summarize(const Stage& stage) const
+{
+    StageStats stats;
+    stats.name = stage.name;
+    stats.count = stage.count;
+    if (stage.history.empty()) return stats;
+
+    // Кольцо разворачивается от старых значений к новым
+    const size_t size = stage.history.size();
+    const size_t oldest = size < historySize ? 0 : stage.count % historySize;
+    stats.history.reserve(size);
+    for (size_t i = 0; i < size; i++) {
+        stats.history.push_back(stage.history[(oldest + i) % size]);
+    }
+
+    double sum = 0;
+    for (float ms : stats.history) sum += ms;
+    std::vector<float> sorted = stats.history;
+    std::sort(sorted.begin(), sorted.end());
+    stats.last = stats.history.back();
+    stats.average = sum / size;
+    stats.p95 = sorted[std::min(size - 1, size_t(0.95 * size))];
+    stats.max = sorted.back();
+    return stats;
+}
+
+std::vector<Profiler::StageStats> Profiler::stages() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<StageStats> result;
+    result.reserve(stageList.size());
+    for (const Stage& stage : stageList) {
+        result.push_back(summarize(stage));
+    }
+    return result;
+}
+
+Profiler::StageStats Profiler::stage(const std::string& name) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = stageIndices.find(name);
+    if (it == stageIndices.end()) {
+        StageStats empty;
+        empty.name = name;
+        return empty;
+    }
+    return summarize(stageList[it->second]);
+}
+
+bool Profiler::exportChromeTrace(const std::string& path, std::string* error) const
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        if (error) *error = "не удалось открыть " + path;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Полные события ("ph": "X"); имена стадий - идентификаторы C++, экранирование не нужно
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (size_t t = 0; t < threads.size(); t++) {
+        fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%zu,"
+                      "\"args\":{\"name\":\"%s\"}},\n",
+                t, t == 0 ? "main" : "worker");
+    }
+    const size_t first = trace.size() < traceCapacity ? 0 : traceNext;
+    for (size_t i = 0; i < trace.size(); i++) {
+        const TraceEvent& event = trace[(first + i) % trace.size()];
+        fprintf(file, "{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%lld,\"dur\":%lld}%s\n",
+                stageList[event.stage].name.c_str(), event.thread,
+                (long long)event.startMicroseconds, (long long)event.durationMicroseconds,
+                i + 1 < trace.size() ? "," : "");
+    }
+    fprintf(file, "]}\n");
+
+    bool ok = !ferror(file);
+    ok = (fclose(file) == 0) && ok;
+    if (!ok && error) *error = "ошибка записи " + path;
+    return ok;
+}
+
+void Profiler::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    stageList.clear();
+    stageIndices.clear();
+    threads.clear();
+    trace.clear();
+    traceNext = 0;
+}
@@ -0,0 +1,109 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Профилировщик стадий кадра без зависимостей от Qt. ScopedTimer вокруг
+// generate*/calculate*/perform*/draw* пишет длительность в скользящую
+// историю стадии (для гистограммы поверх сцены) и в кольцевой журнал
+// событий, который выгружается в формате Chrome trace (chrome://tracing,
+// Perfetto). Записывать можно из любого потока
+class Profiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // Сводка по стадии за последние historySize измерений
+    struct StageStats {
+        std::string name;
+        uint64_t count = 0;          // Всего измерений
+        double last = 0;             // мс
+        double average = 0;
+        double p95 = 0;
+        double max = 0;
+        std::vector<float> history;  // От старых к новым, мс
+    };
+
+    explicit Profiler(size_t historySize = 120, size_t traceCapacity = 200000);
+
+    // Выключенный профилировщик не измеряет время и ничего не хранит
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    void record(const char* stage, Clock::time_point start, Clock::time_point end);
+    // Длительность без отметок времени CPU (запросы таймера GPU);
+    // в журнал попадает событием, закончившимся сейчас
+    void recordDuration(const char* stage, double milliseconds);
+
+    // Стадии в порядке первого появления
+    std::vector<StageStats> stages() const;
+    StageStats stage(const std::string& name) const;
+
+    bool exportChromeTrace(const std::string& path, std::string* error = nullptr) const;
+    void clear();
+
+private:
+    struct Stage {
+        std::string name;
+        uint64_t count = 0;
+        std::vector<float> history;  // Кольцо из historySize значений
+    };
+
+    struct TraceEvent {
+        int stage;
+        int thread;
+        int64_t startMicroseconds;
+        int64_t durationMicroseconds;
+    };
+
+    int stageIndex(const char* stage);
+    int threadIndex(std::thread::id id);
+    void add(int stage, Clock::time_point start, double milliseconds);
+    StageStats summarize(const Stage& stage) const;
+
+    const size_t historySize;
+    const size_t traceCapacity;
+    std::atomic<bool> enabled;
+    Clock::time_point origin;
+
+    mutable std::mutex mutex;
+    std::vector<Stage> stageList;
+    std::map<std::string, int> stageIndices;
+    std::vector<std::thread::id> threads;
+    std::vector<TraceEvent> trace;   // Кольцо из traceCapacity событий
+    size_t traceNext;
+};
+
+// Измеряет время от создания до конца области видимости
+class ScopedTimer
+{
+public:
+    ScopedTimer(Profiler& profiler, const char* stage)
+        : profiler(profiler.isEnabled() ? &profiler : nullptr),
+        stage(stage)
+    {
+        if (this->profiler) start = Profiler::Clock::now();
+    }
+
+    ~ScopedTimer()
+    {
+        if (profiler) profiler->record(stage, start, Profiler::Clock::now());
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    Profiler* profiler;
+    const char* stage;
+    Profiler::Clock::time_point start;
+};
+
+#endif // PROFILER_H
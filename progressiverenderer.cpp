@@ -0,0 +1,161 @@
+#include "progressiverenderer.h"
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+// Адаптивное накопление останавливается на этом кратном выборок первого прохода
+const int adaptiveSampleFactor = 16;
+
+} // namespace
+
+ProgressiveRenderer::ProgressiveRenderer(ThreadPool& pool)
+    : pool(pool),
+    pending(false),
+    busy(false),
+    stopping(false),
+    jobAdaptive(false),
+    cancelRequested(false),
+    profiler(nullptr),
+    imageFresh(false)
+{
+    worker = std::thread(&ProgressiveRenderer::workerLoop, this);
+}
+
+ProgressiveRenderer::~ProgressiveRenderer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        cancelRequested = true;
+    }
+    wake.notify_all();
+    worker.join();
+}
+
+void ProgressiveRenderer::restart(std::shared_ptr<const RayTracer> tracer, const RtSettings& settings,
+                                  const ViewTransform& view, bool adaptive)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobTracer = std::move(tracer);
+        jobSettings = settings;
+        jobView = view;
+        jobAdaptive = adaptive;
+        pending = true;
+        cancelRequested = true;
+    }
+    wake.notify_all();
+}
+
+void ProgressiveRenderer::cancel(bool wait)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    pending = false;
+    jobTracer.reset();
+    cancelRequested = true;
+    if (wait) {
+        idle.wait(lock, [this] { return !busy; });
+    }
+}
+
+void ProgressiveRenderer::setPassFinishedCallback(std::function<void()> callback)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    passFinished = std::move(callback);
+}
+
+void ProgressiveRenderer::setProfiler(Profiler* value)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    profiler = value;
+}
+
+bool ProgressiveRenderer::takeImage(RtImage& target, RtProgress& targetProgress)
+{
+    std::lock_guard<std::mutex> lock(imageMutex);
+    if (!imageFresh) return false;
+    target = image;
+    targetProgress = progress;
+    imageFresh = false;
+    return true;
+}
+
+void ProgressiveRenderer::workerLoop()
+{
+    using Clock = std::chrono::steady_clock;
+    RtAccumulation accumulation;
+    RtImage resolved;
+
+    for (;;) {
+        std::shared_ptr<const RayTracer> tracer;
+        RtSettings settings;
+        ViewTransform view;
+        bool adaptive;
+        std::function<void()> callback;
+        Profiler* passProfiler;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            busy = false;
+            idle.notify_all();
+            wake.wait(lock, [this] { return pending || stopping; });
+            if (stopping) return;
+
+            tracer = std::move(jobTracer);
+            settings = jobSettings;
+            view = jobView;
+            adaptive = jobAdaptive;
+            callback = passFinished;
+            passProfiler = profiler;
+            pending = false;
+            busy = true;
+            cancelRequested = false;
+        }
+
+        accumulation.reset(settings.width, settings.height);
+        const auto jobStart = Clock::now();
+        const size_t pixels = size_t(settings.width) * settings.height;
+        uint64_t totalSamples = 0;
+
+        // Обычный режим: settings.samplesPerPixel проходов по выборке.
+        // Адаптивный: один проход на весь кадр, затем досчет шумных пикселей
+        RtPass pass;
+        if (adaptive) {
+            pass.samples = settings.samplesPerPixel;
+            pass.maxSamples = std::min(settings.samplesPerPixel * adaptiveSampleFactor, 1000);
+        }
+        const int passCount = adaptive ? pass.maxSamples : settings.samplesPerPixel;
+
+        for (int passIndex = 0; passIndex < passCount; passIndex++) {
+            const auto passStart = Clock::now();
+            RtTileStats stats;
+            if (!tracer->renderPass(settings, view, pass, accumulation, pool, &cancelRequested, &stats)) {
+                break;  // Камера или качество изменились - результат прохода не нужен
+            }
+            if (passProfiler) passProfiler->record("renderPass", passStart, Clock::now());
+            if (stats.samples == 0) break;  // Шумных пикселей не осталось
+            totalSamples += stats.samples;
+            resolveAccumulation(accumulation, resolved);
+
+            const auto now = Clock::now();
+            {
+                std::lock_guard<std::mutex> lock(imageMutex);
+                std::swap(image, resolved);
+                progress.settings = settings;
+                progress.adaptive = adaptive;
+                progress.samples = double(totalSamples) / double(pixels);
+                progress.refinedPixels = passIndex > 0 ? size_t(stats.samples / pass.samples) : 0;
+                progress.passMilliseconds = std::chrono::duration<double, std::milli>(now - passStart).count();
+                progress.totalMilliseconds = std::chrono::duration<double, std::milli>(now - jobStart).count();
+                progress.tileStats = std::move(stats);
+                imageFresh = true;
+            }
+            if (callback) callback();
+
+            if (adaptive) {
+                pass.adaptive = true;
+                pass.samples = 1;
+            }
+        }
+    }
+}
@@ -0,0 +1,80 @@
+#ifndef PROGRESSIVERENDERER_H
+#define PROGRESSIVERENDERER_H
+
+#include "raytracer.h"
+#include "profiler.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// Состояние накопления, показываемое вместе с изображением
+struct RtProgress {
+    RtSettings settings;      // samplesPerPixel - цель накопления (первый проход в адаптивном режиме)
+    bool adaptive = false;
+    double samples = 0;       // Накоплено выборок на пиксель (в среднем)
+    size_t refinedPixels = 0; // Пикселей, досчитанных последним адаптивным проходом
+    double passMilliseconds = 0;
+    double totalMilliseconds = 0;
+    RtTileStats tileStats;    // Плитки последнего прохода
+};
+
+// Прогрессивная трассировка в фоновом потоке: сразу кадр в 1 выборку,
+// затем по выборке за проход в буфер накопления, пока не наберется
+// settings.samplesPerPixel. В адаптивном режиме первый проход сразу
+// берет settings.samplesPerPixel выборок, а следующие добавляют по выборке
+// только шумным пикселям, пока такие есть. restart прерывает текущий проход
+// на границе плитки и начинает накопление заново; поток интерфейса не ждет трассировку.
+// Трассировщик передается с каждым restart и удерживается, пока его проход идет:
+// сцену можно заменить, не дожидаясь фонового потока
+class ProgressiveRenderer
+{
+public:
+    explicit ProgressiveRenderer(ThreadPool& pool);
+    ~ProgressiveRenderer();
+
+    void restart(std::shared_ptr<const RayTracer> tracer, const RtSettings& settings,
+                 const ViewTransform& view, bool adaptive = false);
+
+    // Прерывает работу; wait = true - дождаться остановки потока
+    void cancel(bool wait = false);
+
+    // Вызывается из фонового потока после каждого прохода
+    void setPassFinishedCallback(std::function<void()> callback);
+
+    // Проходы записываются стадией "renderPass" фонового потока; nullptr - не записывать
+    void setProfiler(Profiler* profiler);
+
+    // Копирует изображение последнего прохода, если оно новое
+    bool takeImage(RtImage& image, RtProgress& progress);
+
+private:
+    void workerLoop();
+
+    ThreadPool& pool;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    bool pending;
+    bool busy;
+    bool stopping;
+    std::shared_ptr<const RayTracer> jobTracer;
+    RtSettings jobSettings;
+    ViewTransform jobView;
+    bool jobAdaptive;
+    std::atomic<bool> cancelRequested;
+    std::function<void()> passFinished;
+    Profiler* profiler;
+
+    std::mutex imageMutex;
+    RtImage image;
+    RtProgress progress;
+    bool imageFresh;
+
+    std::thread worker;
+};
+
+#endif // PROGRESSIVERENDERER_H
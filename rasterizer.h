@@ -0,0 +1,42 @@
+#ifndef RASTERIZER_H
+#define RASTERIZER_H
+
+#include "geometry.h"
+#include <algorithm>
+#include <cmath>
+
+// Растеризация треугольника по краевым функциям. Вершины заданы в пикселях
+// (x, y) и глубиной z; для каждого покрытого центра пикселя (x + 0.5, y + 0.5)
+// вызывается plot(x, y, z) с интерполированной глубиной.
+// Возвращает false, если треугольник вырожден или вне экрана
+template <typename Plot>
+bool rasterizeTriangle(const Point3D& a, const Point3D& b, const Point3D& c,
+                       int width, int height, int& minX, int& minY, int& maxX, int& maxY,
+                       Plot&& plot)
+{
+    const double area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+    if (std::fabs(area) < 1e-12) return false;
+
+    minX = std::max(int(std::floor(std::min({a.x, b.x, c.x}))), 0);
+    minY = std::max(int(std::floor(std::min({a.y, b.y, c.y}))), 0);
+    maxX = std::min(int(std::ceil(std::max({a.x, b.x, c.x}))), width - 1);
+    maxY = std::min(int(std::ceil(std::max({a.y, b.y, c.y}))), height - 1);
+    if (minX > maxX || minY > maxY) return false;
+
+    const double invArea = 1.0 / area;
+    for (int y = minY; y <= maxY; y++) {
+        const double py = y + 0.5;
+        for (int x = minX; x <= maxX; x++) {
+            const double px = x + 0.5;
+            double w0 = ((b.x - px) * (c.y - py) - (b.y - py) * (c.x - px)) * invArea;
+            double w1 = ((c.x - px) * (a.y - py) - (c.y - py) * (a.x - px)) * invArea;
+            double w2 = 1.0 - w0 - w1;
+            if (w0 < 0 || w1 < 0 || w2 < 0) continue;
+
+            plot(x, y, w0 * a.z + w1 * b.z + w2 * c.z);
+        }
+    }
+    return true;
+}
+
+#endif // RASTERIZER_H
@@ -0,0 +1,586 @@
+#include "raytracer.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+Point3D multiply(const Point3D& a, const Point3D& b)
+{
+    return Point3D(a.x * b.x, a.y * b.y, a.z * b.z);
+}
+
+Point3D reflect(const Point3D& d, const Point3D& n)
+{
+    return d - n * (2.0 * dot(d, n));
+}
+
+// Выборки с номера firstSample берутся из своей последовательности, чтобы
+// накопление по одной выборке за проход было воспроизводимым
+uint64_t sampleSeed(uint64_t seed, int firstSample)
+{
+    return seed + uint64_t(firstSample) * 0x9E3779B97F4A7C15ULL;
+}
+
+// Ортонормированный базис (t, b) вокруг единичного n
+void tangentBasis(const Point3D& n, Point3D& t, Point3D& b)
+{
+    t = normalize(std::fabs(n.x) > 0.5 ? cross(n, Point3D(0, 1, 0)) : cross(n, Point3D(1, 0, 0)));
+    b = cross(n, t);
+}
+
+// Равномерно по телесному углу внутри конуса с осью axis
+Point3D sampleCone(const Point3D& axis, double cosMax, Pcg32& rng)
+{
+    double cosTheta = 1.0 - rng.nextDouble() * (1.0 - cosMax);
+    double sinTheta = std::sqrt(std::max(0.0, 1.0 - cosTheta * cosTheta));
+    double phi = 2.0 * M_PI * rng.nextDouble();
+    Point3D t, b;
+    tangentBasis(axis, t, b);
+    return normalize(t * (std::cos(phi) * sinTheta) + b * (std::sin(phi) * sinTheta) + axis * cosTheta);
+}
+
+// Полусфера вокруг normal с плотностью cos / pi
+Point3D sampleCosine(const Point3D& normal, Pcg32& rng)
+{
+    double r = std::sqrt(rng.nextDouble());
+    double phi = 2.0 * M_PI * rng.nextDouble();
+    Point3D t, b;
+    tangentBasis(normal, t, b);
+    double z = std::sqrt(std::max(0.0, 1.0 - r * r));
+    return normalize(t * (r * std::cos(phi)) + b * (r * std::sin(phi)) + normal * z);
+}
+
+// Расстояние до ближней точки сферы по лучу, направленному внутрь ее конуса
+double raySphereDistance(const Point3D& origin, const Point3D& direction, const Point3D& center, double radius2)
+{
+    Point3D oc = origin - center;
+    double b = dot(oc, direction);
+    double disc = std::max(0.0, b * b - (dot(oc, oc) - radius2));
+    return -b - std::sqrt(disc);
+}
+
+// Вес стратегии с плотностью a против стратегии с плотностью b
+double powerHeuristic(double a, double b)
+{
+    return a * a / (a * a + b * b);
+}
+
+const double rayEpsilon = 1e-6;
+const double surfaceOffset = 1e-4;
+
+} // namespace
+
+RtSettings rayTracingSettingsForQuality(int quality, int width, int height)
+{
+    static const int samples[] = {1, 2, 4, 8, 16};
+    static const int depths[] = {1, 2, 3, 4, 6};
+    int level = std::clamp(quality, 1, 5) - 1;
+
+    RtSettings settings;
+    settings.width = std::max(width, 1);
+    settings.height = std::max(height, 1);
+    settings.samplesPerPixel = samples[level];
+    settings.maxDepth = depths[level];
+    settings.seed = 1;
+    return settings;
+}
+
+RayTracer::RayTracer()
+    : scene(nullptr),
+    sceneVersion(0),
+    kernels(simdKernels(detectSimdLevel()))
+{
+}
+
+void RayTracer::setScene(const Scene& newScene)
+{
+    // Версии сцен не повторяются: та же версия - та же сцена, возможно
+    // перемещенная. BVH остается, меняется только указатель
+    if (scene && sceneVersion == newScene.version) {
+        scene = &newScene;
+        return;
+    }
+    scene = &newScene;
+    sceneVersion = newScene.version;
+
+    // Объекты сцены в примитивы BVH: сетки - треугольниками в мировых координатах
+    std::vector<RtPrimitive> primitives;
+    for (const SceneObject& object : newScene.objects) {
+        const SceneTransform& transform = object.transform;
+        switch (object.shape) {
+        case SceneObject::SPHERE:
+            primitives.push_back(RtPrimitive::sphere(transform.translation, transform.scale, object.material));
+            break;
+        case SceneObject::BOX: {
+            Point3D half(transform.scale, transform.scale, transform.scale);
+            primitives.push_back(RtPrimitive::box(transform.translation - half, transform.translation + half,
+                                                  object.material));
+            break;
+        }
+        case SceneObject::MESH: {
+            const IndexedMesh& mesh = newScene.meshes[object.mesh];
+            for (size_t k = 0; k + 2 < mesh.indices.size(); k += 3) {
+                primitives.push_back(RtPrimitive::triangle(transform.apply(mesh.vertices[mesh.indices[k]]),
+                                                           transform.apply(mesh.vertices[mesh.indices[k + 1]]),
+                                                           transform.apply(mesh.vertices[mesh.indices[k + 2]]),
+                                                           object.material));
+            }
+            break;
+        }
+        }
+    }
+
+    bvh.build(primitives);
+    if (kernels) {
+        simdBvh.build(bvh, kernels->lanes);
+    }
+}
+
+bool RayTracer::setSimdLevel(SimdLevel level)
+{
+    const SimdKernels* requested = simdKernels(level);
+    if (!requested && level != SIMD_SCALAR) return false;
+
+    kernels = requested;
+    if (kernels) {
+        simdBvh.build(bvh, kernels->lanes);
+    } else {
+        simdBvh.clear();
+    }
+    return true;
+}
+
+RtRay RayTracer::primaryRay(const RtSettings& settings, const ViewTransform& view, double px, double py)
+{
+    // Ортографическая камера: лучи параллельны и стартуют с ближней плоскости glOrtho
+    double ndcX = px / settings.width * 2.0 - 1.0;
+    double ndcY = py / settings.height * 2.0 - 1.0;
+    Point3D eyeOrigin(ndcX * view.halfWidth, ndcY * view.halfHeight, view.halfDepth);
+    return RtRay(view.toWorld(eyeOrigin), view.viewDirection());
+}
+
+bool RayTracer::intersect(const RtRay& ray, RtHit& hit, double tMax) const
+{
+    if (!kernels || simdBvh.isEmpty()) {
+        return bvh.intersect(ray, rayEpsilon, tMax, hit);
+    }
+
+    const float origin[3] = {float(ray.origin.x), float(ray.origin.y), float(ray.origin.z)};
+    const float direction[3] = {float(ray.direction.x), float(ray.direction.y), float(ray.direction.z)};
+    float t = float(tMax);
+    int primitive = kernels->intersect(simdBvh.view(), origin, direction, float(rayEpsilon), t);
+    return primitive >= 0 && completeHit(ray, primitive, tMax, hit);
+}
+
+bool RayTracer::occluded(const RtRay& ray, double tMax) const
+{
+    if (!kernels || simdBvh.isEmpty()) {
+        return bvh.occluded(ray, rayEpsilon, tMax) >= 0;
+    }
+
+    const float origin[3] = {float(ray.origin.x), float(ray.origin.y), float(ray.origin.z)};
+    const float direction[3] = {float(ray.direction.x), float(ray.direction.y), float(ray.direction.z)};
+    int primitive = kernels->occluded(simdBvh.view(), origin, direction, float(rayEpsilon), float(tMax));
+    if (primitive < 0) return false;
+
+    // Как и в completeHit: попадание во float подтверждается в double
+    RtHit hit;
+    return intersectPrimitive(bvh.primitives()[primitive], ray, rayEpsilon, tMax, hit) ||
+           bvh.occluded(ray, rayEpsilon, tMax) >= 0;
+}
+
+void RayTracer::intersectPacket(const RtRay* rays, int count, RtHit* hits, bool* found) const
+{
+    if (!kernels || simdBvh.isEmpty()) {
+        for (int i = 0; i < count; i++) {
+            found[i] = bvh.intersect(rays[i], rayEpsilon, 1e30, hits[i]);
+        }
+        return;
+    }
+
+    SimdRayPacket packet;
+    packet.count = count;
+    for (int i = 0; i < SIMD_MAX_LANES; i++) {
+        const RtRay& ray = rays[i < count ? i : 0];
+        packet.origin[0][i] = float(ray.origin.x);
+        packet.origin[1][i] = float(ray.origin.y);
+        packet.origin[2][i] = float(ray.origin.z);
+        packet.direction[0][i] = float(ray.direction.x);
+        packet.direction[1][i] = float(ray.direction.y);
+        packet.direction[2][i] = float(ray.direction.z);
+        packet.t[i] = 1e30f;
+    }
+    kernels->intersectPacket(simdBvh.view(), packet, float(rayEpsilon));
+
+    for (int i = 0; i < count; i++) {
+        found[i] = packet.primitive[i] >= 0 && completeHit(rays[i], packet.primitive[i], 1e30, hits[i]);
+    }
+}
+
+bool RayTracer::completeHit(const RtRay& ray, int primitive, double tMax, RtHit& hit) const
+{
+    // Ядро выбрало примитив во float; t и нормаль пересчитываются в double.
+    // На самом краю треугольника точности float и double расходятся -
+    // тогда отвечает скалярный обход
+    if (intersectPrimitive(bvh.primitives()[primitive], ray, rayEpsilon, tMax, hit)) {
+        hit.primitive = primitive;
+        return true;
+    }
+    return bvh.intersect(ray, rayEpsilon, tMax, hit);
+}
+
+Point3D RayTracer::shadeDiffuse(const Point3D& point, const Point3D& normal, const Point3D& albedo,
+                                Pcg32& rng, RtRayCount& rays) const
+{
+    Point3D toLight = scene->lightPosition - point;
+    double distance2 = dot(toLight, toLight);
+    double radius2 = scene->lightRadius * scene->lightRadius;
+    if (scene->lightMaterial < 0 || distance2 <= radius2) {
+        return multiply(albedo, scene->ambient);
+    }
+
+    // Сфера видна из точки конусом. Яркость - emission материала источника,
+    // как у луча, попавшего в него (shadePath): обе стратегии MIS оценивают
+    // один и тот же свет
+    const double cosMax = std::sqrt(1.0 - radius2 / distance2);
+    const double lightPdf = 1.0 / (2.0 * M_PI * (1.0 - cosMax));
+    const Point3D radiance = scene->materials[scene->lightMaterial].emission;
+    const Point3D origin = point + normal * surfaceOffset;
+    Point3D direct(0, 0, 0);
+
+    // Стратегия 1: направление внутри конуса источника и теневой луч
+    Point3D toward = sampleCone(toLight * (1.0 / std::sqrt(distance2)), cosMax, rng);
+    double cosSurface = dot(normal, toward);
+    if (cosSurface > 0) {
+        rays.total++;
+        rays.shadow++;
+        double tLight = raySphereDistance(origin, toward, scene->lightPosition, radius2);
+        if (!occluded(RtRay(origin, toward), tLight - surfaceOffset)) {
+            double bsdfPdf = cosSurface / M_PI;
+            direct = direct + radiance * (cosSurface / (M_PI * lightPdf) * powerHeuristic(lightPdf, bsdfPdf));
+        }
+    }
+
+    // Стратегия 2: направление по косинусу (BRDF); засчитывается, если луч попал в источник.
+    // Вес BRDF / pdf при косинусной выборке равен albedo
+    Point3D bounce = sampleCosine(normal, rng);
+    RtHit hit;
+    rays.total++;
+    rays.shadow++;
+    if (intersect(RtRay(origin, bounce), hit)) {
+        const SceneMaterial& material = scene->materials[bvh.primitives()[hit.primitive].material];
+        if (material.type == SceneMaterial::EMISSIVE) {
+            double bsdfPdf = dot(normal, bounce) / M_PI;
+            direct = direct + material.emission * powerHeuristic(bsdfPdf, lightPdf);
+        }
+    }
+
+    return multiply(albedo, scene->ambient + direct);
+}
+
+Point3D RayTracer::trace(RtRay ray, int maxDepth, Pcg32& rng) const
+{
+    RtHit hit;
+    bool found = intersect(ray, hit);
+    RtRayCount rays;
+    return shadePath(ray, found, hit, maxDepth, rng, rays);
+}
+
+Point3D RayTracer::shadePath(RtRay ray, bool found, RtHit hit, int maxDepth, Pcg32& rng, RtRayCount& rays) const
+{
+    Point3D color(0, 0, 0);
+    Point3D throughput(1, 1, 1);
+
+    for (int depth = 0; ; depth++) {
+        if (depth > 0) {
+            found = intersect(ray, hit);
+        }
+        rays.total++;
+        if (!found) {
+            return color + multiply(throughput, scene->background);
+        }
+
+        const SceneMaterial& material = scene->materials[bvh.primitives()[hit.primitive].material];
+        Point3D point = ray.origin + ray.direction * hit.t;
+        bool inside = dot(ray.direction, hit.normal) > 0;
+        Point3D normal = inside ? hit.normal * -1.0 : hit.normal;
+
+        if (material.type == SceneMaterial::EMISSIVE) {
+            return color + multiply(throughput, material.emission);
+        }
+        if (material.type == SceneMaterial::DIFFUSE || depth >= maxDepth) {
+            // Глубина исчерпана: зеркало и стекло освещаются как диффузные
+            return color + multiply(throughput, shadeDiffuse(point, normal, material.albedo, rng, rays));
+        }
+
+        throughput = multiply(throughput, material.albedo);
+        Point3D reflected = reflect(ray.direction, normal);
+
+        if (material.type == SceneMaterial::MIRROR) {
+            ray = RtRay(point + normal * surfaceOffset, reflected);
+            continue;
+        }
+
+        // Стекло: отражение или преломление по Френелю (приближение Шлика)
+        double eta = inside ? material.ior : 1.0 / material.ior;
+        double cosI = -dot(ray.direction, normal);
+        double sin2T = eta * eta * (1.0 - cosI * cosI);
+        double r0 = (1.0 - material.ior) / (1.0 + material.ior);
+        r0 *= r0;
+        double fresnel = r0 + (1.0 - r0) * std::pow(1.0 - cosI, 5.0);
+
+        if (sin2T > 1.0 || rng.nextDouble() < fresnel) {
+            ray = RtRay(point + normal * surfaceOffset, reflected);
+        } else {
+            double cosT = std::sqrt(1.0 - sin2T);
+            Point3D refracted = normalize(ray.direction * eta + normal * (eta * cosI - cosT));
+            ray = RtRay(point - normal * surfaceOffset, refracted);
+        }
+    }
+}
+
+Point3D RayTracer::renderPixel(const RtSettings& settings, const ViewTransform& view, int x, int y) const
+{
+    RtRayCount rays;
+    return renderSamples(settings, view, x, y, 0, settings.samplesPerPixel, rays).sum *
+           (1.0 / settings.samplesPerPixel);
+}
+
+RayTracer::PixelSamples RayTracer::renderSamples(const RtSettings& settings, const ViewTransform& view,
+                                                 int x, int y, int firstSample, int sampleCount,
+                                                 RtRayCount& rays) const
+{
+    // Свой поток генератора на каждый пиксель: результат не зависит от порядка обхода
+    Pcg32 rng(sampleSeed(settings.seed, firstSample), uint64_t(y) * settings.width + x);
+    const bool jitter = sampleCount > 1 || firstSample > 0;
+
+    PixelSamples out;
+    for (int s = 0; s < sampleCount; s++) {
+        double jx = jitter ? rng.nextDouble() : 0.5;
+        double jy = jitter ? rng.nextDouble() : 0.5;
+        RtRay ray = primaryRay(settings, view, x + jx, y + jy);
+        RtHit hit;
+        bool found = intersect(ray, hit);
+        Point3D color = shadePath(ray, found, hit, settings.maxDepth, rng, rays);
+        out.sum = out.sum + color;
+        out.luminance2 += luminance(color) * luminance(color);
+    }
+    return out;
+}
+
+void RayTracer::renderPixels(const RtSettings& settings, const ViewTransform& view, int y, const int* xs,
+                             const int* firstSamples, int count, int sampleCount, PixelSamples* out,
+                             RtRayCount& rays) const
+{
+    const int lanes = simdLanes();
+    if (lanes == 1) {
+        for (int i = 0; i < count; i++) {
+            out[i] = renderSamples(settings, view, xs[i], y, firstSamples[i], sampleCount, rays);
+        }
+        return;
+    }
+
+    // Те же потоки генератора и тот же порядок выборок, что в renderSamples;
+    // отличие только в том, что первичные лучи пересекаются пакетом
+    for (int start = 0; start < count; start += lanes) {
+        const int n = std::min(lanes, count - start);
+        Pcg32 rngs[SIMD_MAX_LANES];
+        bool jitter[SIMD_MAX_LANES];
+        for (int i = 0; i < n; i++) {
+            rngs[i] = Pcg32(sampleSeed(settings.seed, firstSamples[start + i]),
+                            uint64_t(y) * settings.width + xs[start + i]);
+            jitter[i] = sampleCount > 1 || firstSamples[start + i] > 0;
+            out[start + i] = PixelSamples();
+        }
+
+        for (int s = 0; s < sampleCount; s++) {
+            RtRay packet[SIMD_MAX_LANES];
+            RtHit hits[SIMD_MAX_LANES];
+            bool found[SIMD_MAX_LANES];
+            for (int i = 0; i < n; i++) {
+                double jx = jitter[i] ? rngs[i].nextDouble() : 0.5;
+                double jy = jitter[i] ? rngs[i].nextDouble() : 0.5;
+                packet[i] = primaryRay(settings, view, xs[start + i] + jx, y + jy);
+            }
+            intersectPacket(packet, n, hits, found);
+            for (int i = 0; i < n; i++) {
+                Point3D color = shadePath(packet[i], found[i], hits[i], settings.maxDepth, rngs[i], rays);
+                out[start + i].sum = out[start + i].sum + color;
+                out[start + i].luminance2 += luminance(color) * luminance(color);
+            }
+        }
+    }
+}
+
+void RayTracer::render(const RtSettings& settings, const ViewTransform& view, RtImage& image,
+                       ThreadPool& pool, RtTileStats* stats) const
+{
+    image.width = settings.width;
+    image.height = settings.height;
+    image.rgba.resize(size_t(image.width) * image.height * 4);
+
+    runTiles(settings, pool, nullptr, stats, [&](int x0, int x1, int y0, int y1, RtRayCount& rays, uint64_t& samples) {
+        int xs[tileSize], firstSamples[tileSize] = {};
+        PixelSamples pixels[tileSize];
+        for (int x = x0; x < x1; x++) xs[x - x0] = x;
+
+        for (int y = y0; y < y1; y++) {
+            renderPixels(settings, view, y, xs, firstSamples, x1 - x0, settings.samplesPerPixel, pixels, rays);
+            for (int x = x0; x < x1; x++) {
+                uint32_t packed = packColor(pixels[x - x0].sum * (1.0 / settings.samplesPerPixel));
+                uint8_t* out = &image.rgba[(size_t(y) * image.width + x) * 4];
+                out[0] = uint8_t(packed);
+                out[1] = uint8_t(packed >> 8);
+                out[2] = uint8_t(packed >> 16);
+                out[3] = uint8_t(packed >> 24);
+            }
+        }
+        samples += uint64_t(x1 - x0) * (y1 - y0) * settings.samplesPerPixel;
+    });
+}
+
+bool RayTracer::renderPass(const RtSettings& settings, const ViewTransform& view, const RtPass& pass,
+                           RtAccumulation& accumulation, ThreadPool& pool,
+                           const std::atomic<bool>* cancel, RtTileStats* stats) const
+{
+    if (accumulation.width != settings.width || accumulation.height != settings.height) {
+        accumulation.reset(settings.width, settings.height);
+    }
+
+    return runTiles(settings, pool, cancel, stats, [&](int x0, int x1, int y0, int y1, RtRayCount& rays, uint64_t& samples) {
+        int xs[tileSize], firstSamples[tileSize];
+        PixelSamples pixels[tileSize];
+
+        for (int y = y0; y < y1; y++) {
+            // Адаптивный проход берет только пиксели, где оценка еще шумная
+            int count = 0;
+            for (int x = x0; x < x1; x++) {
+                size_t p = size_t(y) * settings.width + x;
+                int taken = accumulation.samples[p];
+                if (pass.adaptive &&
+                    (taken + pass.samples > pass.maxSamples || !accumulation.isNoisy(p, pass.noiseThreshold))) {
+                    continue;
+                }
+                xs[count] = x;
+                firstSamples[count] = taken;
+                count++;
+            }
+            if (count == 0) continue;
+
+            renderPixels(settings, view, y, xs, firstSamples, count, pass.samples, pixels, rays);
+            for (int i = 0; i < count; i++) {
+                size_t p = size_t(y) * settings.width + xs[i];
+                accumulation.rgb[p * 3] += float(pixels[i].sum.x);
+                accumulation.rgb[p * 3 + 1] += float(pixels[i].sum.y);
+                accumulation.rgb[p * 3 + 2] += float(pixels[i].sum.z);
+                accumulation.luminance2[p] += float(pixels[i].luminance2);
+                accumulation.samples[p] = uint16_t(accumulation.samples[p] + pass.samples);
+            }
+            samples += uint64_t(count) * pass.samples;
+        }
+    });
+}
+
+bool RayTracer::runTiles(const RtSettings& settings, ThreadPool& pool, const std::atomic<bool>* cancel,
+                         RtTileStats* stats,
+                         const std::function<void(int, int, int, int, RtRayCount&, uint64_t&)>& tile) const
+{
+    const int tilesX = (settings.width + tileSize - 1) / tileSize;
+    const int tilesY = (settings.height + tileSize - 1) / tileSize;
+    std::vector<float> tileMilliseconds(size_t(tilesX) * tilesY);
+    std::vector<double> workerMilliseconds(pool.threadCount(), 0.0);
+    std::vector<RtRayCount> workerRays(pool.threadCount());
+    std::vector<uint64_t> workerSamples(pool.threadCount(), 0);
+
+    // Плитки пишут в непересекающиеся участки изображения, а поток генератора
+    // привязан к пикселю, поэтому результат не зависит от того,
+    // какой поток выполнил плитку
+    pool.parallelFor(tileMilliseconds.size(), [&](size_t index, int worker) {
+        // Отмененный проход пропускает оставшиеся плитки
+        if (cancel && cancel->load(std::memory_order_relaxed)) return;
+
+        auto start = std::chrono::steady_clock::now();
+        const int x0 = int(index % tilesX) * tileSize;
+        const int y0 = int(index / tilesX) * tileSize;
+        tile(x0, std::min(x0 + tileSize, settings.width), y0, std::min(y0 + tileSize, settings.height),
+             workerRays[worker], workerSamples[worker]);
+
+        double ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start).count();
+        tileMilliseconds[index] = float(ms);
+        workerMilliseconds[worker] += ms;
+    });
+
+    if (cancel && cancel->load()) return false;
+
+    if (stats) {
+        stats->tileSize = tileSize;
+        stats->tilesX = tilesX;
+        stats->tilesY = tilesY;
+        stats->tileMilliseconds.swap(tileMilliseconds);
+        stats->workerMilliseconds.swap(workerMilliseconds);
+        stats->stolenTiles = pool.lastStealCount();
+        stats->rays = 0;
+        stats->shadowRays = 0;
+        stats->samples = 0;
+        for (size_t i = 0; i < workerRays.size(); i++) {
+            stats->rays += workerRays[i].total;
+            stats->shadowRays += workerRays[i].shadow;
+            stats->samples += workerSamples[i];
+        }
+    }
+    return true;
+}
+
+void RtAccumulation::reset(int newWidth, int newHeight)
+{
+    width = newWidth;
+    height = newHeight;
+    const size_t pixels = size_t(width) * height;
+    rgb.assign(pixels * 3, 0.0f);
+    luminance2.assign(pixels, 0.0f);
+    samples.assign(pixels, 0);
+}
+
+bool RtAccumulation::isNoisy(size_t pixel, float threshold) const
+{
+    const int n = samples[pixel];
+    if (n < 2) return true;
+
+    double mean = luminance(Point3D(rgb[pixel * 3], rgb[pixel * 3 + 1], rgb[pixel * 3 + 2])) / n;
+    double variance = std::max(0.0, luminance2[pixel] / n - mean * mean);
+    // Относительная ошибка; 0.05 - чтобы темные пиксели не набирали выборки без конца
+    return std::sqrt(variance / n) > threshold * (mean + 0.05);
+}
+
+void resolveAccumulation(const RtAccumulation& accumulation, RtImage& image)
+{
+    image.width = accumulation.width;
+    image.height = accumulation.height;
+    image.rgba.resize(size_t(image.width) * image.height * 4);
+
+    for (size_t i = 0; i < size_t(image.width) * image.height; i++) {
+        const double scale = 1.0 / std::max<int>(accumulation.samples[i], 1);
+        uint32_t packed = packColor(Point3D(accumulation.rgb[i * 3], accumulation.rgb[i * 3 + 1],
+                                            accumulation.rgb[i * 3 + 2]) * scale);
+        image.rgba[i * 4] = uint8_t(packed);
+        image.rgba[i * 4 + 1] = uint8_t(packed >> 8);
+        image.rgba[i * 4 + 2] = uint8_t(packed >> 16);
+        image.rgba[i * 4 + 3] = uint8_t(packed >> 24);
+    }
+}
+
+double luminance(const Point3D& color)
+{
+    return 0.2126 * color.x + 0.7152 * color.y + 0.0722 * color.z;
+}
+
+uint32_t packColor(const Point3D& color)
+{
+    auto channel = [](double v) {
+        v = std::pow(std::clamp(v, 0.0, 1.0), 1.0 / 2.2);
+        return uint32_t(v * 255.0 + 0.5);
+    };
+    return channel(color.x) | (channel(color.y) << 8) | (channel(color.z) << 16) | 0xFF000000u;
+}
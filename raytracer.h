@@ -0,0 +1,176 @@
+#ifndef RAYTRACER_H
+#define RAYTRACER_H
+
+#include "bvh.h"
+#include "rng.h"
+#include "scene.h"
+#include "simdbvh.h"
+#include "threadpool.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+struct RtSettings {
+    int width, height;     // Разрешение изображения
+    int samplesPerPixel;
+    int maxDepth;          // Число отражений/преломлений
+    uint64_t seed;
+};
+
+// Уровень качества 1-5 темы трассировки: число выборок на пиксель и глубина
+RtSettings rayTracingSettingsForQuality(int quality, int width, int height);
+
+// Изображение RGBA8, строка 0 - нижняя (как у glTexImage2D)
+struct RtImage {
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> rgba;
+};
+
+// Время трассировки плиток последнего кадра
+struct RtTileStats {
+    int tileSize = 0;
+    int tilesX = 0, tilesY = 0;
+    std::vector<float> tileMilliseconds;     // tilesX * tilesY, строка 0 - нижняя
+    std::vector<double> workerMilliseconds;  // Суммарное время плиток каждого потока
+    size_t stolenTiles = 0;
+    uint64_t rays = 0;        // Всех лучей прохода, включая вторичные
+    uint64_t shadowRays = 0;  // Из них лучей прямого освещения (RtRayCount::shadow)
+    uint64_t samples = 0;     // Выборок (путей) прохода
+};
+
+// Счетчик выпущенных лучей. Лучи прямого освещения (теневой и по BRDF
+// к источнику) выпускаются по два на диффузную точку независимо от глубины,
+// поэтому считаются отдельно от продолжений пути
+struct RtRayCount {
+    uint64_t total = 0;
+    uint64_t shadow = 0;
+};
+
+// Буфер прогрессивного накопления. Число выборок у пикселей разное,
+// если часть проходов была адаптивной
+struct RtAccumulation {
+    int width = 0, height = 0;
+    std::vector<float> rgb;          // Сумма выборок
+    std::vector<float> luminance2;   // Сумма квадратов яркости выборок
+    std::vector<uint16_t> samples;
+
+    void reset(int width, int height);
+    // Стандартная ошибка средней яркости больше threshold от самой яркости
+    bool isNoisy(size_t pixel, float threshold) const;
+};
+
+struct RtPass {
+    int samples = 1;              // Выборок на пиксель за проход
+    bool adaptive = false;        // Только пиксели с шумом (isNoisy)
+    float noiseThreshold = 0.03f;
+    int maxSamples = 256;         // Предел выборок пикселя для адаптивных проходов
+};
+
+// Трассировщик лучей на CPU с BVH по примитивам сцены.
+// Камера ортографическая и совпадает с камерой GLWidget
+class RayTracer
+{
+public:
+    RayTracer();
+
+    // Сцена не копируется: трассировщик читает ее материалы и источник света
+    // напрямую, поэтому она должна жить, пока трассировщик ею пользуется.
+    // BVH перестраивается, только если сменилась version; сцена с той же
+    // version (перемещенная или скопированная) только заменяет указатель
+    void setScene(const Scene& scene);
+    const Scene& currentScene() const { return *scene; }
+
+    // Изображение делится на плитки tileSize x tileSize, которые
+    // выполняются пулом потоков; stats - необязательная статистика плиток
+    void render(const RtSettings& settings, const ViewTransform& view, RtImage& image,
+                ThreadPool& pool, RtTileStats* stats = nullptr) const;
+
+    // Один проход прогрессивной трассировки: pass.samples следующих выборок
+    // пикселя прибавляются к accumulation (размер - по settings).
+    // Возвращает false, если проход прерван флагом cancel
+    bool renderPass(const RtSettings& settings, const ViewTransform& view, const RtPass& pass,
+                    RtAccumulation& accumulation, ThreadPool& pool,
+                    const std::atomic<bool>* cancel = nullptr, RtTileStats* stats = nullptr) const;
+
+    static const int tileSize = 16;
+
+    // Цвет одного пикселя (x, y) с settings.samplesPerPixel выборками
+    Point3D renderPixel(const RtSettings& settings, const ViewTransform& view, int x, int y) const;
+
+    // Первичный луч через точку (px, py) в пикселях
+    static RtRay primaryRay(const RtSettings& settings, const ViewTransform& view, double px, double py);
+
+    Point3D trace(RtRay ray, int maxDepth, Pcg32& rng) const;
+
+    // Ближайшее пересечение луча со сценой не дальше tMax
+    bool intersect(const RtRay& ray, RtHit& hit, double tMax = 1e30) const;
+
+    // Материал примитива, в который попал луч
+    const SceneMaterial& hitMaterial(const RtHit& hit) const
+    {
+        return scene->materials[bvh.primitives()[hit.primitive].material];
+    }
+
+    // Загорожен ли отрезок луча до tMax: обход останавливается на первом
+    // препятствии, ближайшее не ищется (теневые лучи)
+    bool occluded(const RtRay& ray, double tMax) const;
+
+    // Пересечение пакета из count <= simdLanes() когерентных лучей;
+    // без SIMD лучи проверяются по одному
+    void intersectPacket(const RtRay* rays, int count, RtHit* hits, bool* found) const;
+
+    // Набор инструкций ядер пересечения. По умолчанию - лучший из
+    // поддерживаемых процессором; false, если уровень недоступен
+    bool setSimdLevel(SimdLevel level);
+    SimdLevel simdLevel() const { return kernels ? kernels->level : SIMD_SCALAR; }
+    const char* simdName() const { return kernels ? kernels->name : "нет"; }
+    int simdLanes() const { return kernels ? kernels->lanes : 1; }
+
+private:
+    // Сумма выборок пикселя и сумма квадратов их яркости
+    struct PixelSamples {
+        Point3D sum;
+        double luminance2 = 0;
+    };
+
+    // Продолжение пути луча, для которого уже найдено первое пересечение;
+    // rays увеличивается на число выпущенных лучей
+    Point3D shadePath(RtRay ray, bool found, RtHit hit, int maxDepth, Pcg32& rng, RtRayCount& rays) const;
+    // Пиксели xs[0..count) строки y, по sampleCount выборок начиная с
+    // firstSamples[i]; первичные лучи - пакетами по simdLanes()
+    void renderPixels(const RtSettings& settings, const ViewTransform& view, int y, const int* xs,
+                      const int* firstSamples, int count, int sampleCount, PixelSamples* out,
+                      RtRayCount& rays) const;
+    PixelSamples renderSamples(const RtSettings& settings, const ViewTransform& view, int x, int y,
+                               int firstSample, int sampleCount, RtRayCount& rays) const;
+    // tile(x0, x1, y0, y1, rays, samples) считает плитку и добавляет свои лучи и выборки
+    bool runTiles(const RtSettings& settings, ThreadPool& pool, const std::atomic<bool>* cancel,
+                  RtTileStats* stats,
+                  const std::function<void(int, int, int, int, RtRayCount&, uint64_t&)>& tile) const;
+    // Точная нормаль для примитива, найденного ядром во float
+    bool completeHit(const RtRay& ray, int primitive, double tMax, RtHit& hit) const;
+
+    // Прямое освещение диффузной точки от сферического источника: теневой луч
+    // к точке источника и луч по BRDF, сведенные MIS (эвристика степени)
+    Point3D shadeDiffuse(const Point3D& point, const Point3D& normal, const Point3D& albedo,
+                         Pcg32& rng, RtRayCount& rays) const;
+
+    const Scene* scene;
+    uint64_t sceneVersion;
+    Bvh bvh;
+    SimdBvh simdBvh;
+    const SimdKernels* kernels;
+};
+
+// Перевод линейного цвета в 8-битный RGBA с гамма-коррекцией
+uint32_t packColor(const Point3D& color);
+
+// Среднее накопленных выборок каждого пикселя в RGBA8
+void resolveAccumulation(const RtAccumulation& accumulation, RtImage& image);
+
+// Яркость линейного цвета (Rec. 709)
+double luminance(const Point3D& color);
+
+#endif // RAYTRACER_H
@@ -0,0 +1,130 @@
+#include "raytracingbenchmark.h"
+#include "raytracer.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Случайное направление в полусфере вокруг normal
+Point3D randomHemisphereDirection(const Point3D& normal, Pcg32& rng)
+{
+    double z = rng.nextDouble() * 2.0 - 1.0;
+    double phi = rng.nextDouble() * 2.0 * M_PI;
+    double r = std::sqrt(std::max(0.0, 1.0 - z * z));
+    Point3D d(r * std::cos(phi), r * std::sin(phi), z);
+    return dot(d, normal) < 0 ? d * -1.0 : d;
+}
+
+} // namespace
+
+std::vector<BenchmarkResult> runRayTracingBenchmark(int width, int height)
+{
+    const Scene scene = makeRayTracingRoomScene();
+    RayTracer tracer;
+    tracer.setScene(scene);
+    tracer.setSimdLevel(SIMD_SCALAR);
+
+    // Первичные лучи через центры пикселей камеры по умолчанию
+    const ViewTransform view = ViewTransform::fromAngles(15.0, 15.0, double(width) / height);
+    RtSettings settings = rayTracingSettingsForQuality(1, width, height);
+    std::vector<RtRay> primary;
+    primary.reserve(size_t(width) * height);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            primary.push_back(RayTracer::primaryRay(settings, view, x + 0.5, y + 0.5));
+        }
+    }
+
+    // Вторичные лучи из точек попадания в случайных направлениях
+    std::vector<RtRay> secondary;
+    Pcg32 rng(12345);
+    for (const RtRay& ray : primary) {
+        RtHit hit;
+        if (!tracer.intersect(ray, hit)) continue;
+        Point3D normal = dot(ray.direction, hit.normal) > 0 ? hit.normal * -1.0 : hit.normal;
+        Point3D point = ray.origin + ray.direction * hit.t + normal * 1e-4;
+        secondary.push_back(RtRay(point, randomHemisphereDirection(normal, rng)));
+    }
+
+    // Теневые лучи из тех же точек к центру источника: отрезок до его поверхности
+    struct ShadowRay {
+        RtRay ray;
+        double tMax;
+    };
+    std::vector<ShadowRay> shadow;
+    for (const RtRay& ray : primary) {
+        RtHit hit;
+        if (!tracer.intersect(ray, hit)) continue;
+        Point3D normal = dot(ray.direction, hit.normal) > 0 ? hit.normal * -1.0 : hit.normal;
+        Point3D point = ray.origin + ray.direction * hit.t + normal * 1e-4;
+        Point3D toLight = scene.lightPosition - point;
+        double distance = length(toLight);
+        if (distance <= scene.lightRadius) continue;
+        shadow.push_back({RtRay(point, toLight * (1.0 / distance)), distance - scene.lightRadius - 1e-4});
+    }
+    size_t occludedCount = 0;
+    for (const ShadowRay& s : shadow) occludedCount += tracer.occluded(s.ray, s.tMax);
+
+    const std::string primaryParams = "первичные лучи " + std::to_string(width) + "x" + std::to_string(height);
+    const std::string secondaryParams = "вторичные лучи, " + std::to_string(secondary.size());
+    const std::string shadowParams = "теневые лучи, " + std::to_string(shadow.size()) + ", в тени " +
+                                     std::to_string(occludedCount * 100 / std::max<size_t>(shadow.size(), 1)) + "%";
+
+    std::vector<BenchmarkResult> results;
+    int hitCount = 0;  // Чтобы компилятор не выбросил пересечения
+    auto singleRays = [&](const std::vector<RtRay>& rays) {
+        return measureMilliseconds([&] {
+            RtHit hit;
+            for (const RtRay& ray : rays) hitCount += tracer.intersect(ray, hit);
+        });
+    };
+
+    const SimdLevel levels[] = {SIMD_SCALAR, SIMD_SSE42, SIMD_AVX2, SIMD_AVX512};
+    const char* levelNames[] = {"Скалярный (double)", "SSE4.2", "AVX2", "AVX-512"};
+    for (int i = 0; i < 4; i++) {
+        const std::string name = levelNames[i];
+        if (!tracer.setSimdLevel(levels[i])) {
+            results.push_back({name, "не поддерживается процессором или сборкой", 0, 0, ""});
+            continue;
+        }
+
+        const int lanes = tracer.simdLanes();
+        const std::string singleName = levels[i] == SIMD_SCALAR
+            ? name : name + ": 1 луч x " + std::to_string(lanes) + " примитивов";
+
+        double ms = singleRays(primary);
+        results.push_back({singleName, primaryParams, ms, primary.size() / (ms / 1000.0), "лучей"});
+        ms = singleRays(secondary);
+        results.push_back({singleName, secondaryParams, ms, secondary.size() / (ms / 1000.0), "лучей"});
+
+        // Тень через поиск ближайшего пересечения и через обход с выходом на первом
+        ms = measureMilliseconds([&] {
+            RtHit hit;
+            for (const ShadowRay& s : shadow) hitCount += tracer.intersect(s.ray, hit, s.tMax);
+        });
+        results.push_back({name + ": тень, ближайшее пересечение", shadowParams, ms,
+                           shadow.size() / (ms / 1000.0), "лучей"});
+        ms = measureMilliseconds([&] {
+            for (const ShadowRay& s : shadow) hitCount += tracer.occluded(s.ray, s.tMax);
+        });
+        results.push_back({name + ": тень, любое пересечение", shadowParams, ms,
+                           shadow.size() / (ms / 1000.0), "лучей"});
+
+        if (levels[i] == SIMD_SCALAR) continue;
+
+        ms = measureMilliseconds([&] {
+            RtHit hits[SIMD_MAX_LANES];
+            bool found[SIMD_MAX_LANES];
+            for (size_t start = 0; start < primary.size(); start += lanes) {
+                int count = int(std::min(primary.size() - start, size_t(lanes)));
+                tracer.intersectPacket(&primary[start], count, hits, found);
+                hitCount += found[0];
+            }
+        });
+        results.push_back({name + ": пакеты по " + std::to_string(lanes) + " лучей", primaryParams, ms,
+                           primary.size() / (ms / 1000.0), "лучей"});
+    }
+
+    if (hitCount < 0) results.clear();
+    return results;
+}
@@ -0,0 +1,12 @@
+#ifndef RAYTRACINGBENCHMARK_H
+#define RAYTRACINGBENCHMARK_H
+
+#include "benchmark.h"
+
+// Скорость пересечения лучей со сценой комнаты для скалярного обхода
+// и каждого доступного набора SIMD-ядер: первичные (когерентные) лучи
+// по одному и пакетами, вторичные (некогерентные) - по одному; теневые -
+// поиском ближайшего пересечения и обходом с выходом на первом препятствии
+std::vector<BenchmarkResult> runRayTracingBenchmark(int width = 512, int height = 512);
+
+#endif // RAYTRACINGBENCHMARK_H
@@ -0,0 +1,96 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <cstddef>
+#include <cstdint>
+
+// PCG32 (O'Neill): маленький быстрый генератор. stream выбирает одну из
+// 2^63 последовательностей (приращение LCG) с периодом 2^64. Разные stream
+// дают разные последовательности, но не независимые: при одном seed они
+// коррелированы. Независимые генераторы берутся через RandomStreams,
+// который вместе с потоком меняет и seed
+class Pcg32
+{
+public:
+    explicit Pcg32(uint64_t seed = 0x853c49e6748fea9bULL, uint64_t stream = 0xda3e39cb94b95bdbULL)
+    {
+        state = 0;
+        increment = (stream << 1u) | 1u;
+        nextUInt();
+        state += seed;
+        nextUInt();
+    }
+
+    uint32_t nextUInt()
+    {
+        uint64_t old = state;
+        state = old * 6364136223846793005ULL + increment;
+        uint32_t xorshifted = uint32_t(((old >> 18u) ^ old) >> 27u);
+        uint32_t rot = uint32_t(old >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((-rot) & 31));
+    }
+
+    // Равномерно в [0, 1)
+    double nextDouble()
+    {
+        return (nextUInt() >> 5) * (1.0 / 134217728.0);
+    }
+
+private:
+    uint64_t state;
+    uint64_t increment;
+};
+
+// Перемешивание SplitMix64: соседние числа дают несвязанные на вид значения
+inline uint64_t mixSeed(uint64_t value)
+{
+    value += 0x9E3779B97F4A7C15ULL;
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+    return value ^ (value >> 31);
+}
+
+// Номера потоков генераторов: у каждого свой, поэтому изменение одного
+// генератора не сдвигает последовательности остальных
+enum RandomStreamId : uint64_t {
+    RANDOM_STREAM_LINES = 1,
+    RANDOM_STREAM_ZBUFFER_SCENE,
+    RANDOM_STREAM_VISUALIZATION_RAYS,
+    RANDOM_STREAM_PATH_TRACING,
+    RANDOM_STREAM_BENCHMARK
+};
+
+const uint64_t defaultRandomSeed = 0x5EED;
+
+// Источник случайности всех генераторов: один seed задает все
+// последовательности программы. stream(id) - генератор потока id,
+// split(id) - независимый источник для подзадачи (очередной генерации,
+// блока параллельной генерации). Результат зависит только от seed и
+// номеров, а не от числа потоков и порядка вычислений
+class RandomStreams
+{
+public:
+    explicit RandomStreams(uint64_t seed = defaultRandomSeed) : rootSeed(seed) {}
+
+    uint64_t seed() const { return rootSeed; }
+
+    Pcg32 stream(uint64_t id) const
+    {
+        // Разные и seed, и поток PCG: потоки с общим seed коррелированы
+        return Pcg32(mixSeed(rootSeed ^ mixSeed(id)), id);
+    }
+
+    RandomStreams split(uint64_t id) const
+    {
+        return RandomStreams(mixSeed(rootSeed + mixSeed(~id)));
+    }
+
+private:
+    uint64_t rootSeed;
+};
+
+// Элементов на блок при параллельной генерации. Блок получает свой поток
+// (RandomStreams::stream(номер блока)); размер не зависит от числа потоков
+const size_t randomBlockSize = 4096;
+
+#endif // RNG_H
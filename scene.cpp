@@ -0,0 +1,108 @@
+#include "scene.h"
+#include <atomic>
+#include <cmath>
+
+namespace {
+
+std::atomic<uint64_t> lastSceneVersion(0);
+
+// Прямоугольник abcd двумя треугольниками
+IndexedMesh makeQuadMesh(const Point3D& a, const Point3D& b, const Point3D& c, const Point3D& d)
+{
+    IndexedMesh mesh;
+    mesh.vertices = {a, b, c, d};
+    mesh.indices = {0, 1, 2, 0, 2, 3};
+    return mesh;
+}
+
+} // namespace
+
+int Scene::addMesh(IndexedMesh mesh)
+{
+    meshes.push_back(std::move(mesh));
+    touch();
+    return int(meshes.size()) - 1;
+}
+
+int Scene::addMaterial(const SceneMaterial& material)
+{
+    materials.push_back(material);
+    touch();
+    return int(materials.size()) - 1;
+}
+
+void Scene::addObject(SceneObject::Shape shape, int mesh, const SceneTransform& transform, int material)
+{
+    objects.push_back({shape, mesh, transform, material});
+    touch();
+}
+
+void Scene::clear()
+{
+    meshes.clear();
+    materials.clear();
+    objects.clear();
+    touch();
+}
+
+void Scene::touch()
+{
+    version = ++lastSceneVersion;
+}
+
+size_t Scene::triangleCount() const
+{
+    size_t count = 0;
+    for (const SceneObject& object : objects) {
+        if (object.shape == SceneObject::MESH) count += meshes[object.mesh].triangleCount();
+    }
+    return count;
+}
+
+Scene makeRayTracingRoomScene()
+{
+    Scene scene;
+    const int floor = scene.addMaterial({Point3D(0.2, 0.6, 0.2), SceneMaterial::DIFFUSE, 1.0});
+    const int backWall = scene.addMaterial({Point3D(0.2, 0.2, 0.8), SceneMaterial::DIFFUSE, 1.0});
+    const int rightWall = scene.addMaterial({Point3D(0.8, 0.2, 0.2), SceneMaterial::DIFFUSE, 1.0});
+    const int mirror = scene.addMaterial({Point3D(0.9, 0.9, 0.9), SceneMaterial::MIRROR, 1.0});
+    const int cube = scene.addMaterial({Point3D(0.9, 0.9, 0.2), SceneMaterial::DIFFUSE, 1.0});
+    const int glass = scene.addMaterial({Point3D(0.7, 0.7, 1.0), SceneMaterial::GLASS, 1.5});
+
+    // Комната
+    const SceneTransform identity;
+    scene.addObject(SceneObject::MESH,
+                    scene.addMesh(makeQuadMesh(Point3D(-5, -5, -5), Point3D(5, -5, -5),
+                                               Point3D(5, 5, -5), Point3D(-5, 5, -5))),
+                    identity, floor);
+    scene.addObject(SceneObject::MESH,
+                    scene.addMesh(makeQuadMesh(Point3D(-5, -5, -5), Point3D(-5, -5, 5),
+                                               Point3D(-5, 5, 5), Point3D(-5, 5, -5))),
+                    identity, backWall);
+    scene.addObject(SceneObject::MESH,
+                    scene.addMesh(makeQuadMesh(Point3D(-5, -5, -5), Point3D(5, -5, -5),
+                                               Point3D(5, -5, 5), Point3D(-5, -5, 5))),
+                    identity, rightWall);
+
+    // Сфера радиуса 1 и куб со стороной 1
+    scene.addObject(SceneObject::SPHERE, -1, {Point3D(-2, 0, -2), 1.0}, mirror);
+    scene.addObject(SceneObject::BOX, -1, {Point3D(2, -1, -3), 0.5}, cube);
+
+    // Пирамида: основание 2x2 в плоскости z = -2, вершина на высоте 2
+    scene.addObject(SceneObject::MESH, scene.addMesh(makePyramidMesh(Point3D(0, 2, -2), 1.0)),
+                    identity, glass);
+
+    // Источник света
+    // Яркость сферы подобрана так, что освещенность вдали совпадает с
+    // точечным источником силы lightPower
+    const Point3D lightPower = Point3D(1.0, 1.0, 0.5) * 40.0;
+    scene.lightPosition = Point3D(0, 0, 4);
+    scene.lightRadius = 0.5;
+    scene.lightMaterial = scene.addMaterial({Point3D(1.0, 1.0, 0.5), SceneMaterial::EMISSIVE, 1.0,
+                                             lightPower * (1.0 / (M_PI * scene.lightRadius * scene.lightRadius))});
+    scene.addObject(SceneObject::SPHERE, -1, {scene.lightPosition, scene.lightRadius}, scene.lightMaterial);
+
+    scene.background = Point3D(0.0, 0.0, 0.1);
+    scene.ambient = Point3D(0.08, 0.08, 0.08);
+    return scene;
+}
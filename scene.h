@@ -0,0 +1,72 @@
+#ifndef SCENE_H
+#define SCENE_H
+
+#include "mesh.h"
+#include <cstdint>
+#include <vector>
+
+struct SceneMaterial {
+    enum Type { DIFFUSE, MIRROR, GLASS, EMISSIVE };
+
+    Point3D albedo;  // Цвет поверхности; у EMISSIVE - цвет источника в предпросмотре
+    Type type;
+    double ior;      // Показатель преломления для GLASS
+    // Яркость излучения EMISSIVE: ее берут и луч, попавший в источник,
+    // и выборка источника при прямом освещении
+    Point3D emission = Point3D(0, 0, 0);
+};
+
+// Перенос и равномерный масштаб (как у MeshInstance)
+struct SceneTransform {
+    Point3D translation;
+    double scale = 1.0;
+
+    Point3D apply(const Point3D& p) const { return translation + p * scale; }
+};
+
+// Сетка из Scene::meshes или аналитический примитив в локальных координатах:
+// SPHERE - единичная сфера, BOX - куб [-1, 1]^3. transform ставит его в сцену
+struct SceneObject {
+    enum Shape { MESH, SPHERE, BOX };
+
+    Shape shape;
+    int mesh;        // Индекс в Scene::meshes для MESH, иначе -1
+    SceneTransform transform;
+    int material;    // Индекс в Scene::materials
+};
+
+// Одна сцена для всех способов вывода: OpenGL рисует вершины сеток прямо
+// из meshes, программный Z-буфер и BSP проецируют их же, трассировщик
+// строит по объектам BVH. Потребители запоминают version и перестраивают
+// свои структуры (BVH, буферы GPU, BSP) только когда она меняется
+struct Scene {
+    std::vector<IndexedMesh> meshes;
+    std::vector<SceneMaterial> materials;
+    std::vector<SceneObject> objects;
+
+    // Сферический источник света; яркость - emission его материала
+    Point3D lightPosition;
+    double lightRadius = 0;
+    int lightMaterial = -1;
+    Point3D background;
+    Point3D ambient;
+
+    // Уникальна среди всех сцен программы; 0 - сцена еще не заполнялась
+    uint64_t version = 0;
+
+    int addMesh(IndexedMesh mesh);
+    int addMaterial(const SceneMaterial& material);
+    void addObject(SceneObject::Shape shape, int mesh, const SceneTransform& transform, int material);
+    void clear();
+
+    // Вызывается после любого изменения сцены
+    void touch();
+
+    size_t triangleCount() const;
+};
+
+// Комната, зеркальная сфера, куб, стеклянная пирамида и источник света
+// темы трассировки лучей
+Scene makeRayTracingRoomScene();
+
+#endif // SCENE_H
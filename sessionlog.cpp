@@ -0,0 +1,202 @@
+#include "sessionlog.h"
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+struct SessionEventInfo {
+    const char* name;
+    int valueCount;
+};
+
+// По порядку SessionEventType
+const SessionEventInfo sessionEventInfo[SESSION_EVENT_TYPE_COUNT] = {
+    {"rotate", 2},
+    {"theme", 1},
+    {"controlPoint", 4},
+    {"resetPoints", 0},
+    {"showPolygon", 1},
+    {"bsplineOrder", 1},
+    {"generateBSpline", 0},
+    {"clipWindow", 4},
+    {"generateLines", 0},
+    {"performClipping", 0},
+    {"zbufferObjects", 1},
+    {"generateZBuffer", 0},
+    {"loadModel", 0},
+    {"visibility", 1},
+    {"rayQuality", 1},
+    {"frameBudget", 1},
+    {"rayCount", 1},
+    {"renderRayTracing", 0},
+    {"showRayImage", 1},
+    {"showTileTimings", 1},
+    {"randomState", 3}
+};
+
+// События с текстовым аргументом в конце строки
+bool hasText(SessionEventType type)
+{
+    return type == SESSION_LOAD_MODEL || type == SESSION_RANDOM_STATE;
+}
+
+} // namespace
+
+const char* sessionEventName(SessionEventType type)
+{
+    return type >= 0 && type < SESSION_EVENT_TYPE_COUNT ? sessionEventInfo[type].name : "?";
+}
+
+int sessionEventValueCount(SessionEventType type)
+{
+    return type >= 0 && type < SESSION_EVENT_TYPE_COUNT ? sessionEventInfo[type].valueCount : 0;
+}
+
+SessionLog::SessionLog()
+    : recording(false)
+{
+}
+
+void SessionLog::start()
+{
+    log.clear();
+    startTime = Clock::now();
+    recording = true;
+}
+
+void SessionLog::stop()
+{
+    recording = false;
+}
+
+void SessionLog::record(SessionEventType type, double v0, double v1, double v2, double v3)
+{
+    if (!recording) return;
+
+    SessionEvent event;
+    event.time = std::chrono::duration<double, std::milli>(Clock::now() - startTime).count();
+    event.type = type;
+    event.values[0] = v0;
+    event.values[1] = v1;
+    event.values[2] = v2;
+    event.values[3] = v3;
+    log.push_back(event);
+}
+
+void SessionLog::recordText(SessionEventType type, const std::string& text, double v0, double v1, double v2)
+{
+    if (!recording) return;
+    record(type, v0, v1, v2);
+    log.back().text = text;
+}
+
+bool SessionLog::save(const std::string& path, std::string* error) const
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        if (error) *error = "не удалось открыть " + path;
+        return false;
+    }
+
+    fprintf(file, "# Сеанс: время, мс<TAB>событие<TAB>значения\n");
+    for (const SessionEvent& event : log) {
+        fprintf(file, "%.3f\t%s", event.time, sessionEventName(event.type));
+        // %.17g - без потери точности double
+        for (int i = 0; i < sessionEventValueCount(event.type); i++) {
+            fprintf(file, "\t%.17g", event.values[i]);
+        }
+        if (hasText(event.type)) {
+            fprintf(file, "\t%s", event.text.c_str());
+        }
+        fprintf(file, "\n");
+    }
+
+    bool ok = !ferror(file);
+    ok = (fclose(file) == 0) && ok;
+    if (!ok && error) *error = "ошибка записи " + path;
+    return ok;
+}
+
+bool SessionLog::load(const std::string& path, std::string* error)
+{
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        if (error) *error = "Не удалось открыть файл " + path;
+        return false;
+    }
+
+    std::string content;
+    char buffer[1 << 16];
+    size_t read = 0;
+    while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        content.append(buffer, read);
+    }
+    fclose(file);
+
+    std::vector<SessionEvent> events;
+    size_t lineNumber = 0;
+    size_t position = 0;
+    while (position < content.size()) {
+        size_t newline = content.find('\n', position);
+        if (newline == std::string::npos) newline = content.size();
+        std::string line = content.substr(position, newline - position);
+        position = newline + 1;
+        lineNumber++;
+
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty() || line[0] == '#') continue;
+
+        auto fail = [&](const char* message) {
+            if (error) *error = path + ":" + std::to_string(lineNumber) + ": " + message;
+            return false;
+        };
+
+        // Поля разделены табуляцией; text - последнее поле целиком
+        std::vector<std::string> fields;
+        size_t start = 0;
+        while (true) {
+            size_t tab = line.find('\t', start);
+            fields.push_back(line.substr(start, tab == std::string::npos ? std::string::npos : tab - start));
+            if (tab == std::string::npos) break;
+            start = tab + 1;
+        }
+        if (fields.size() < 2) return fail("ожидается время и событие");
+
+        SessionEvent event;
+        char* end = nullptr;
+        event.time = std::strtod(fields[0].c_str(), &end);
+        if (end == fields[0].c_str() || *end) return fail("неверное время");
+
+        int type = 0;
+        while (type < SESSION_EVENT_TYPE_COUNT && fields[1] != sessionEventInfo[type].name) type++;
+        if (type == SESSION_EVENT_TYPE_COUNT) return fail("неизвестное событие");
+        event.type = SessionEventType(type);
+
+        const size_t valueCount = size_t(sessionEventValueCount(event.type));
+        const size_t expected = 2 + valueCount + (hasText(event.type) ? 1 : 0);
+        if (fields.size() < expected) return fail("не хватает значений");
+        for (size_t i = 0; i < valueCount; i++) {
+            event.values[i] = std::strtod(fields[2 + i].c_str(), &end);
+            if (end == fields[2 + i].c_str() || *end) return fail("неверное значение");
+        }
+        if (hasText(event.type)) {
+            // Имя файла может содержать табуляцию
+            const size_t textStart = 2 + valueCount;
+            event.text = fields[textStart];
+            for (size_t i = textStart + 1; i < fields.size(); i++) {
+                event.text += '\t' + fields[i];
+            }
+        } else if (fields.size() > expected) {
+            return fail("лишние значения");
+        }
+        if (event.type == SESSION_RANDOM_STATE) {
+            std::strtoull(event.text.c_str(), &end, 10);
+            if (event.text.empty() || *end) return fail("неверный seed");
+        }
+        events.push_back(std::move(event));
+    }
+
+    log = std::move(events);
+    recording = false;
+    return true;
+}
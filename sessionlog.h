@@ -0,0 +1,80 @@
+#ifndef SESSIONLOG_H
+#define SESSIONLOG_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Журнал сеанса работы без зависимостей от Qt: действия пользователя
+// (повороты камеры, смена темы, правка точек, счетчики и кнопки панелей)
+// с временем от начала записи. GLWidget пишет события в своих методах,
+// через которые проходят и мышь, и панели MainWindow; headless-прогон
+// (--replay) повторяет журнал без пауз и замеряет задержку каждого события
+enum SessionEventType {
+    SESSION_ROTATE,              // Углы камеры X, Y
+    SESSION_THEME,               // Номер темы GLWidget::Theme
+    SESSION_CONTROL_POINT,       // Номер точки, x, y, z
+    SESSION_RESET_POINTS,
+    SESSION_SHOW_POLYGON,        // 0 / 1
+    SESSION_BSPLINE_ORDER,
+    SESSION_GENERATE_BSPLINE,
+    SESSION_CLIP_WINDOW,         // Левая, правая, нижняя, верхняя граница
+    SESSION_GENERATE_LINES,
+    SESSION_PERFORM_CLIPPING,
+    SESSION_ZBUFFER_OBJECTS,
+    SESSION_GENERATE_ZBUFFER,
+    SESSION_LOAD_MODEL,          // Файл модели в text
+    SESSION_VISIBILITY,          // GLWidget::VisibilityMode
+    SESSION_RAY_QUALITY,
+    SESSION_FRAME_BUDGET,        // мс; 0 - без бюджета
+    SESSION_RAY_COUNT,
+    SESSION_RENDER_RAY_TRACING,
+    SESSION_SHOW_RAY_IMAGE,      // 0 / 1
+    SESSION_SHOW_TILE_TIMINGS,   // 0 / 1
+    SESSION_RANDOM_STATE,        // Seed в text; номера генераций отрезков, сцены Z-буфера, лучей
+    SESSION_EVENT_TYPE_COUNT
+};
+
+const int sessionEventMaxValues = 4;
+
+struct SessionEvent {
+    double time = 0;             // мс от начала записи
+    SessionEventType type = SESSION_ROTATE;
+    double values[sessionEventMaxValues] = {};
+    std::string text;
+};
+
+// Имя события в файле журнала и число его значений
+const char* sessionEventName(SessionEventType type);
+int sessionEventValueCount(SessionEventType type);
+
+// Текстовый файл: строка на событие "время<TAB>имя<TAB>значения...",
+// для событий с text - остаток строки. Значения пишутся без потери
+// точности, поэтому повтор дает те же данные, что и запись
+class SessionLog
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    SessionLog();
+
+    // Начинает запись заново; вне записи record ничего не делает
+    void start();
+    void stop();
+    bool isRecording() const { return recording; }
+
+    void record(SessionEventType type, double v0 = 0, double v1 = 0, double v2 = 0, double v3 = 0);
+    void recordText(SessionEventType type, const std::string& text, double v0 = 0, double v1 = 0, double v2 = 0);
+
+    const std::vector<SessionEvent>& events() const { return log; }
+
+    bool save(const std::string& path, std::string* error = nullptr) const;
+    bool load(const std::string& path, std::string* error = nullptr);
+
+private:
+    bool recording;
+    Clock::time_point startTime;
+    std::vector<SessionEvent> log;
+};
+
+#endif // SESSIONLOG_H
@@ -0,0 +1,175 @@
+#include "simdbvh.h"
+#include <algorithm>
+
+// Узлы SimdBvh повторяют узлы Bvh (поддеревья только схлопываются в листья),
+// поэтому стеку ядер хватает глубины Bvh
+static_assert(SIMD_BVH_STACK_SIZE >= Bvh::traversalStackSize, "стек обхода SIMD-ядер меньше глубины BVH");
+
+void SimdBvh::clear()
+{
+    nodes.clear();
+    leaves.clear();
+    ranges.clear();
+    for (int a = 0; a < 3; a++) {
+        v0[a].clear();
+        e1[a].clear();
+        e2[a].clear();
+        sphereCenter[a].clear();
+        boxMin[a].clear();
+        boxMax[a].clear();
+    }
+    trianglePrimitive.clear();
+    sphereRadius2.clear();
+    spherePrimitive.clear();
+    boxPrimitive.clear();
+}
+
+void SimdBvh::build(const Bvh& bvh, int leafSize)
+{
+    clear();
+    if (bvh.nodeList().empty()) {
+        pad();
+        return;
+    }
+
+    // Примитивы поддерева Bvh лежат подряд, поэтому его можно
+    // схлопнуть в лист, зная только диапазон
+    ranges.resize(bvh.nodeList().size());
+    subtreeRange(bvh, 0);
+
+    nodes.reserve(bvh.nodeList().size());
+    nodes.push_back(SimdNode());
+    emitNode(bvh, 0, 0, leafSize);
+    ranges.clear();
+    pad();
+}
+
+SimdBvh::Range SimdBvh::subtreeRange(const Bvh& bvh, int node)
+{
+    const Bvh::Node& n = bvh.nodeList()[node];
+    Range range;
+    if (n.count > 0) {
+        range = {n.leftFirst, n.count};
+    } else {
+        Range left = subtreeRange(bvh, n.leftFirst);
+        Range right = subtreeRange(bvh, n.leftFirst + 1);
+        int first = std::min(left.first, right.first);
+        range = {first, left.count + right.count};
+    }
+    ranges[node] = range;
+    return range;
+}
+
+void SimdBvh::emitNode(const Bvh& bvh, int bvhNode, int simdNode, int leafSize)
+{
+    const Bvh::Node& n = bvh.nodeList()[bvhNode];
+    SimdNode& out = nodes[simdNode];
+    out.min[0] = float(n.bounds.min.x);
+    out.min[1] = float(n.bounds.min.y);
+    out.min[2] = float(n.bounds.min.z);
+    out.max[0] = float(n.bounds.max.x);
+    out.max[1] = float(n.bounds.max.y);
+    out.max[2] = float(n.bounds.max.z);
+
+    const Range& range = ranges[bvhNode];
+    if (n.count > 0 || range.count <= leafSize) {
+        emitLeaf(bvh, range, simdNode);
+        return;
+    }
+
+    // Потомки должны лежать рядом: правый - сразу за левым
+    int left = int(nodes.size());
+    nodes.push_back(SimdNode());
+    nodes.push_back(SimdNode());
+    nodes[simdNode].leftFirst = left;
+    nodes[simdNode].count = 0;
+
+    emitNode(bvh, n.leftFirst, left, leafSize);
+    emitNode(bvh, n.leftFirst + 1, left + 1, leafSize);
+}
+
+void SimdBvh::emitLeaf(const Bvh& bvh, const Range& range, int simdNode)
+{
+    SimdLeaf leaf;
+    leaf.triangleFirst = int(trianglePrimitive.size());
+    leaf.sphereFirst = int(spherePrimitive.size());
+    leaf.boxFirst = int(boxPrimitive.size());
+
+    for (int i = range.first; i < range.first + range.count; i++) {
+        const RtPrimitive& p = bvh.primitives()[i];
+        switch (p.type) {
+        case RtPrimitive::TRIANGLE: {
+            Point3D a = p.p0, b = p.p1 - p.p0, c = p.p2 - p.p0;
+            const double va[3] = {a.x, a.y, a.z}, vb[3] = {b.x, b.y, b.z}, vc[3] = {c.x, c.y, c.z};
+            for (int k = 0; k < 3; k++) {
+                v0[k].push_back(float(va[k]));
+                e1[k].push_back(float(vb[k]));
+                e2[k].push_back(float(vc[k]));
+            }
+            trianglePrimitive.push_back(i);
+            break;
+        }
+        case RtPrimitive::SPHERE:
+            sphereCenter[0].push_back(float(p.p0.x));
+            sphereCenter[1].push_back(float(p.p0.y));
+            sphereCenter[2].push_back(float(p.p0.z));
+            sphereRadius2.push_back(float(p.radius * p.radius));
+            spherePrimitive.push_back(i);
+            break;
+        case RtPrimitive::BOX: {
+            const double lo[3] = {p.p0.x, p.p0.y, p.p0.z}, hi[3] = {p.p1.x, p.p1.y, p.p1.z};
+            for (int k = 0; k < 3; k++) {
+                boxMin[k].push_back(float(lo[k]));
+                boxMax[k].push_back(float(hi[k]));
+            }
+            boxPrimitive.push_back(i);
+            break;
+        }
+        }
+    }
+
+    leaf.triangleCount = int(trianglePrimitive.size()) - leaf.triangleFirst;
+    leaf.sphereCount = int(spherePrimitive.size()) - leaf.sphereFirst;
+    leaf.boxCount = int(boxPrimitive.size()) - leaf.boxFirst;
+
+    nodes[simdNode].leftFirst = int(leaves.size());
+    nodes[simdNode].count = range.count;
+    leaves.push_back(leaf);
+}
+
+void SimdBvh::pad()
+{
+    // Ядра читают полный вектор от первого примитива листа
+    for (int a = 0; a < 3; a++) {
+        v0[a].resize(v0[a].size() + SIMD_MAX_LANES, 0.0f);
+        e1[a].resize(e1[a].size() + SIMD_MAX_LANES, 0.0f);
+        e2[a].resize(e2[a].size() + SIMD_MAX_LANES, 0.0f);
+        sphereCenter[a].resize(sphereCenter[a].size() + SIMD_MAX_LANES, 0.0f);
+        boxMin[a].resize(boxMin[a].size() + SIMD_MAX_LANES, 0.0f);
+        boxMax[a].resize(boxMax[a].size() + SIMD_MAX_LANES, 0.0f);
+    }
+    sphereRadius2.resize(sphereRadius2.size() + SIMD_MAX_LANES, 0.0f);
+    trianglePrimitive.resize(trianglePrimitive.size() + SIMD_MAX_LANES, -1);
+    spherePrimitive.resize(spherePrimitive.size() + SIMD_MAX_LANES, -1);
+    boxPrimitive.resize(boxPrimitive.size() + SIMD_MAX_LANES, -1);
+}
+
+SimdSceneView SimdBvh::view() const
+{
+    SimdSceneView v;
+    v.nodes = nodes.data();
+    v.leaves = leaves.data();
+    for (int a = 0; a < 3; a++) {
+        v.v0[a] = v0[a].data();
+        v.e1[a] = e1[a].data();
+        v.e2[a] = e2[a].data();
+        v.sphereCenter[a] = sphereCenter[a].data();
+        v.boxMin[a] = boxMin[a].data();
+        v.boxMax[a] = boxMax[a].data();
+    }
+    v.trianglePrimitive = trianglePrimitive.data();
+    v.sphereRadius2 = sphereRadius2.data();
+    v.spherePrimitive = spherePrimitive.data();
+    v.boxPrimitive = boxPrimitive.data();
+    return v;
+}
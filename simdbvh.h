@@ -0,0 +1,46 @@
+#ifndef SIMDBVH_H
+#define SIMDBVH_H
+
+#include "bvh.h"
+#include "simdkernels.h"
+#include <vector>
+
+// Копия Bvh в формате SIMD-ядер: float, примитивы листьев разложены
+// по типам в SoA-массивы. Поддеревья, в которых не больше leafSize
+// примитивов, схлопываются в один лист, чтобы лист заполнял вектор
+class SimdBvh
+{
+public:
+    void build(const Bvh& bvh, int leafSize);
+    void clear();
+
+    bool isEmpty() const { return nodes.empty(); }
+    size_t nodeCount() const { return nodes.size(); }
+
+    // Действителен до следующего build/clear
+    SimdSceneView view() const;
+
+private:
+    struct Range {
+        int first, count;
+    };
+
+    Range subtreeRange(const Bvh& bvh, int node);
+    void emitNode(const Bvh& bvh, int bvhNode, int simdNode, int leafSize);
+    void emitLeaf(const Bvh& bvh, const Range& range, int simdNode);
+    void pad();
+
+    std::vector<SimdNode> nodes;
+    std::vector<SimdLeaf> leaves;
+    std::vector<Range> ranges;  // Диапазон примитивов каждого узла Bvh
+
+    std::vector<float> v0[3], e1[3], e2[3];
+    std::vector<int> trianglePrimitive;
+    std::vector<float> sphereCenter[3];
+    std::vector<float> sphereRadius2;
+    std::vector<int> spherePrimitive;
+    std::vector<float> boxMin[3], boxMax[3];
+    std::vector<int> boxPrimitive;
+};
+
+#endif // SIMDBVH_H
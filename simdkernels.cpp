@@ -0,0 +1,33 @@
+#include "simdkernels.h"
+
+SimdLevel detectSimdLevel()
+{
+#ifdef RAYTRACER_SIMD
+    static const SimdLevel level = [] {
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("fma")) return SIMD_AVX512;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return SIMD_AVX2;
+        if (__builtin_cpu_supports("sse4.2")) return SIMD_SSE42;
+        return SIMD_SCALAR;
+    }();
+    return level;
+#else
+    return SIMD_SCALAR;
+#endif
+}
+
+const SimdKernels* simdKernels(SimdLevel level)
+{
+    // Ядра уровня выше поддерживаемого вызвали бы недопустимую инструкцию
+    if (level > detectSimdLevel()) return nullptr;
+
+#ifdef RAYTRACER_SIMD
+    switch (level) {
+    case SIMD_SSE42: return simdKernelsSse42();
+    case SIMD_AVX2: return simdKernelsAvx2();
+    case SIMD_AVX512: return simdKernelsAvx512();
+    case SIMD_SCALAR: break;
+    }
+#endif
+    return nullptr;
+}
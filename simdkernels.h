@@ -0,0 +1,97 @@
+#ifndef SIMDKERNELS_H
+#define SIMDKERNELS_H
+
+// Интерфейс SIMD-ядер пересечения лучей. Заголовок подключается в единицах
+// трансляции, собранных с -msse4.2/-mavx2/-mavx512f, поэтому в нем только
+// POD-структуры и объявления: встроенный (inline) код отсюда попал бы в
+// общий для всей программы экземпляр и мог бы содержать AVX-инструкции
+
+// Максимальная ширина SIMD (AVX-512, 16 float); массивы сцены дополнены
+// этим числом элементов, чтобы ядра читали полные векторы без проверок
+#define SIMD_MAX_LANES 16
+
+// Стек обхода в ядрах; SimdBvh не глубже исходного Bvh, поэтому хватает
+// Bvh::traversalStackSize (проверяется в simdbvh.cpp)
+#define SIMD_BVH_STACK_SIZE 64
+
+struct SimdNode {
+    float min[3];
+    int leftFirst;   // лист: индекс в leaves, иначе левый потомок (правый - следующий)
+    float max[3];
+    int count;       // 0 - внутренний узел
+};
+
+// Примитивы листа разложены по типам в SoA-массивы
+struct SimdLeaf {
+    int triangleFirst, triangleCount;
+    int sphereFirst, sphereCount;
+    int boxFirst, boxCount;
+};
+
+// Указатели на данные SimdBvh
+struct SimdSceneView {
+    const SimdNode* nodes;
+    const SimdLeaf* leaves;
+
+    // Треугольники: вершина v0 и ребра e1 = v1 - v0, e2 = v2 - v0
+    const float* v0[3];
+    const float* e1[3];
+    const float* e2[3];
+    const int* trianglePrimitive;
+
+    const float* sphereCenter[3];
+    const float* sphereRadius2;
+    const int* spherePrimitive;
+
+    const float* boxMin[3];
+    const float* boxMax[3];
+    const int* boxPrimitive;
+};
+
+// Пакет до SIMD_MAX_LANES лучей в виде SoA. t на входе - предел,
+// на выходе - ближайшее пересечение; primitive = -1, если попаданий нет
+struct SimdRayPacket {
+    float origin[3][SIMD_MAX_LANES];
+    float direction[3][SIMD_MAX_LANES];
+    float t[SIMD_MAX_LANES];
+    int primitive[SIMD_MAX_LANES];
+    int count;
+};
+
+enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE42,
+    SIMD_AVX2,
+    SIMD_AVX512
+};
+
+struct SimdKernels {
+    SimdLevel level;
+    const char* name;
+    int lanes;
+
+    // Один луч, в листе проверяется до lanes примитивов одной инструкцией.
+    // Возвращает индекс примитива Bvh или -1; t - как в SimdRayPacket
+    int (*intersect)(const SimdSceneView& scene, const float origin[3], const float direction[3],
+                     float tMin, float& t);
+
+    // Любое пересечение на (tMin, tMax) с выходом на первом найденном
+    // (теневые лучи). Возвращает индекс примитива Bvh или -1
+    int (*occluded)(const SimdSceneView& scene, const float origin[3], const float direction[3],
+                    float tMin, float tMax);
+
+    // Пакет из packet.count <= lanes когерентных лучей (первичные лучи)
+    void (*intersectPacket)(const SimdSceneView& scene, SimdRayPacket& packet, float tMin);
+};
+
+// Лучший уровень, поддерживаемый процессором и собранный в программу
+SimdLevel detectSimdLevel();
+
+// Ядра уровня или nullptr, если уровень недоступен (SIMD_SCALAR - всегда nullptr)
+const SimdKernels* simdKernels(SimdLevel level);
+
+const SimdKernels* simdKernelsSse42();
+const SimdKernels* simdKernelsAvx2();
+const SimdKernels* simdKernelsAvx512();
+
+#endif // SIMDKERNELS_H
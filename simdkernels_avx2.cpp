@@ -0,0 +1,7 @@
+// Ядра для AVX2: собирается с -mavx2 -mfma (см. CMakeLists.txt)
+#define SIMD_LANES 8
+#define SIMD_LEVEL SIMD_AVX2
+#define SIMD_NAME "AVX2"
+#define SIMD_FACTORY simdKernelsAvx2
+
+#include "simdkernelsimpl.h"
@@ -0,0 +1,7 @@
+// Ядра для AVX-512: собирается с -mavx512f -mfma (см. CMakeLists.txt)
+#define SIMD_LANES 16
+#define SIMD_LEVEL SIMD_AVX512
+#define SIMD_NAME "AVX-512"
+#define SIMD_FACTORY simdKernelsAvx512
+
+#include "simdkernelsimpl.h"
@@ -0,0 +1,7 @@
+// Ядра для SSE4.2: собирается с -msse4.2 (см. CMakeLists.txt)
+#define SIMD_LANES 4
+#define SIMD_LEVEL SIMD_SSE42
+#define SIMD_NAME "SSE4.2"
+#define SIMD_FACTORY simdKernelsSse42
+
+#include "simdkernelsimpl.h"
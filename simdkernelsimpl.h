@@ -0,0 +1,435 @@
+// Общая реализация SIMD-ядер на векторных расширениях GCC/Clang.
+// Подключается только из simdkernels_*.cpp, каждый из которых задает
+// SIMD_LANES, SIMD_LEVEL, SIMD_NAME, SIMD_FACTORY и собирается со своим
+// набором инструкций. Весь код - во внутреннем пространстве имен, чтобы
+// компоновщик не подменил им общие функции из других единиц трансляции
+
+#include "simdkernels.h"
+#include <immintrin.h>
+
+namespace {
+
+typedef float Vf __attribute__((vector_size(SIMD_LANES * 4)));
+typedef int Vi __attribute__((vector_size(SIMD_LANES * 4)));
+
+const float triangleEpsilon = 1e-12f;
+
+inline Vf load(const float* p)
+{
+    Vf v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline Vi loadInt(const int* p)
+{
+    Vi v;
+    __builtin_memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void store(float* p, Vf v)
+{
+    __builtin_memcpy(p, &v, sizeof(v));
+}
+
+inline void storeInt(int* p, Vi v)
+{
+    __builtin_memcpy(p, &v, sizeof(v));
+}
+
+inline Vf splat(float x)
+{
+    return Vf{} + x;
+}
+
+inline Vi splatInt(int x)
+{
+    return Vi{} + x;
+}
+
+inline Vi laneIndex()
+{
+    Vi index;
+    for (int i = 0; i < SIMD_LANES; i++) index[i] = i;
+    return index;
+}
+
+inline Vf select(Vi mask, Vf a, Vf b)
+{
+    return (Vf)(((Vi)a & mask) | ((Vi)b & ~mask));
+}
+
+inline Vi selectInt(Vi mask, Vi a, Vi b)
+{
+    return (a & mask) | (b & ~mask);
+}
+
+inline Vf vmin(Vf a, Vf b) { return select(a < b, a, b); }
+inline Vf vmax(Vf a, Vf b) { return select(a > b, a, b); }
+
+inline Vf vsqrt(Vf v)
+{
+#if SIMD_LANES == 4
+    return (Vf)_mm_sqrt_ps((__m128)v);
+#elif SIMD_LANES == 8
+    return (Vf)_mm256_sqrt_ps((__m256)v);
+#else
+    return (Vf)_mm512_maskz_sqrt_ps(0xFFFF, (__m512)v);
+#endif
+}
+
+inline bool any(Vi mask)
+{
+    int bits = 0;
+    for (int i = 0; i < SIMD_LANES; i++) bits |= mask[i];
+    return bits != 0;
+}
+
+inline float minf(float a, float b) { return a < b ? a : b; }
+inline float maxf(float a, float b) { return a > b ? a : b; }
+
+// Тройка векторов: SoA-координаты
+struct Vec3 {
+    Vf x, y, z;
+};
+
+inline Vec3 loadVec3(const float* const p[3], int index)
+{
+    return {load(p[0] + index), load(p[1] + index), load(p[2] + index)};
+}
+
+inline Vec3 splatVec3(const float* const p[3], int index)
+{
+    return {splat(p[0][index]), splat(p[1][index]), splat(p[2][index])};
+}
+
+inline Vf dot(const Vec3& a, const Vec3& b)
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline Vec3 cross(const Vec3& a, const Vec3& b)
+{
+    return {a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x};
+}
+
+inline Vec3 sub(const Vec3& a, const Vec3& b)
+{
+    return {a.x - b.x, a.y - b.y, a.z - b.z};
+}
+
+// Пересечения, векторизованные либо по примитивам (один луч размножен
+// по всем компонентам), либо по лучам (примитив размножен).
+// Возвращают маску попаданий в (tMin, tBest) и расстояние t
+
+inline Vi intersectTriangles(const Vec3& o, const Vec3& d, const Vec3& v0, const Vec3& e1, const Vec3& e2,
+                             Vf tMin, Vf tBest, Vf& t)
+{
+    Vec3 pv = cross(d, e2);
+    Vf det = dot(e1, pv);
+    Vi valid = (det > triangleEpsilon) | (det < -triangleEpsilon);
+    Vf invDet = 1.0f / select(valid, det, splat(1.0f));
+
+    Vec3 tv = sub(o, v0);
+    Vf u = dot(tv, pv) * invDet;
+    valid &= (u >= 0.0f) & (u <= 1.0f);
+
+    Vec3 qv = cross(tv, e1);
+    Vf v = dot(d, qv) * invDet;
+    valid &= (v >= 0.0f) & (u + v <= 1.0f);
+
+    t = dot(e2, qv) * invDet;
+    return valid & (t > tMin) & (t < tBest);
+}
+
+// Направление нормировано
+inline Vi intersectSpheres(const Vec3& o, const Vec3& d, const Vec3& center, Vf radius2,
+                           Vf tMin, Vf tBest, Vf& t)
+{
+    Vec3 oc = sub(o, center);
+    Vf b = dot(oc, d);
+    Vf c = dot(oc, oc) - radius2;
+    Vf disc = b * b - c;
+    Vi valid = disc >= 0.0f;
+    Vf sq = vsqrt(select(valid, disc, splat(0.0f)));
+
+    Vf tNear = -b - sq;
+    Vf tFar = -b + sq;
+    Vi nearOk = (tNear > tMin) & (tNear < tBest);
+    t = select(nearOk, tNear, tFar);
+    return valid & (nearOk | ((tFar > tMin) & (tFar < tBest)));
+}
+
+inline Vi intersectBoxes(const Vec3& o, const Vec3& invD, const Vec3& boxMin, const Vec3& boxMax,
+                         Vf tMin, Vf tBest, Vf& t)
+{
+    Vf tx1 = (boxMin.x - o.x) * invD.x, tx2 = (boxMax.x - o.x) * invD.x;
+    Vf ty1 = (boxMin.y - o.y) * invD.y, ty2 = (boxMax.y - o.y) * invD.y;
+    Vf tz1 = (boxMin.z - o.z) * invD.z, tz2 = (boxMax.z - o.z) * invD.z;
+    Vf tEnter = vmax(vmax(vmin(tx1, tx2), vmin(ty1, ty2)), vmin(tz1, tz2));
+    Vf tExit = vmin(vmin(vmax(tx1, tx2), vmax(ty1, ty2)), vmax(tz1, tz2));
+    t = select(tEnter > tMin, tEnter, tExit);
+    return (tEnter <= tExit) & (t > tMin) & (t < tBest);
+}
+
+// Первое попадание по маске
+inline int firstHit(Vi hits, const int* primitives, int first)
+{
+    for (int i = 0; i < SIMD_LANES; i++) {
+        if (hits[i]) return primitives[first + i];
+    }
+    return -1;
+}
+
+// Ближайшее из попаданий по маске, компоненты - примитивы
+inline void takeClosest(Vi hits, Vf t, const int* primitives, int first, float& best, int& primitive)
+{
+    for (int i = 0; i < SIMD_LANES; i++) {
+        if (hits[i] && t[i] < best) {
+            best = t[i];
+            primitive = primitives[first + i];
+        }
+    }
+}
+
+inline bool hitNode(const SimdNode& node, const float o[3], const float invD[3],
+                    float tMin, float tMax, float& tNear)
+{
+    float t0 = tMin, t1 = tMax;
+    for (int a = 0; a < 3; a++) {
+        float ta = (node.min[a] - o[a]) * invD[a];
+        float tb = (node.max[a] - o[a]) * invD[a];
+        t0 = maxf(t0, minf(ta, tb));
+        t1 = minf(t1, maxf(ta, tb));
+    }
+    tNear = t0;
+    return t0 <= t1;
+}
+
+int intersect(const SimdSceneView& scene, const float origin[3], const float direction[3],
+              float tMin, float& t)
+{
+    const float invD[3] = {1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2]};
+    const Vec3 o = {splat(origin[0]), splat(origin[1]), splat(origin[2])};
+    const Vec3 d = {splat(direction[0]), splat(direction[1]), splat(direction[2])};
+    const Vec3 inv = {splat(invD[0]), splat(invD[1]), splat(invD[2])};
+    const Vf tMinV = splat(tMin);
+    const Vi lanes = laneIndex();
+
+    int primitive = -1;
+    int stack[SIMD_BVH_STACK_SIZE];
+    int stackSize = 0;
+    float tNear;
+
+    if (!hitNode(scene.nodes[0], origin, invD, tMin, t, tNear)) return -1;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const SimdNode& node = scene.nodes[stack[--stackSize]];
+
+        if (node.count > 0) {
+            const SimdLeaf& leaf = scene.leaves[node.leftFirst];
+            Vf tHit;
+
+            for (int k = 0; k < leaf.triangleCount; k += SIMD_LANES) {
+                int first = leaf.triangleFirst + k;
+                Vi inLeaf = lanes < splatInt(leaf.triangleCount - k);
+                Vi hits = inLeaf & intersectTriangles(o, d, loadVec3(scene.v0, first), loadVec3(scene.e1, first),
+                                                      loadVec3(scene.e2, first), tMinV, splat(t), tHit);
+                if (any(hits)) takeClosest(hits, tHit, scene.trianglePrimitive, first, t, primitive);
+            }
+            for (int k = 0; k < leaf.sphereCount; k += SIMD_LANES) {
+                int first = leaf.sphereFirst + k;
+                Vi inLeaf = lanes < splatInt(leaf.sphereCount - k);
+                Vi hits = inLeaf & intersectSpheres(o, d, loadVec3(scene.sphereCenter, first),
+                                                    load(scene.sphereRadius2 + first), tMinV, splat(t), tHit);
+                if (any(hits)) takeClosest(hits, tHit, scene.spherePrimitive, first, t, primitive);
+            }
+            for (int k = 0; k < leaf.boxCount; k += SIMD_LANES) {
+                int first = leaf.boxFirst + k;
+                Vi inLeaf = lanes < splatInt(leaf.boxCount - k);
+                Vi hits = inLeaf & intersectBoxes(o, inv, loadVec3(scene.boxMin, first),
+                                                  loadVec3(scene.boxMax, first), tMinV, splat(t), tHit);
+                if (any(hits)) takeClosest(hits, tHit, scene.boxPrimitive, first, t, primitive);
+            }
+            continue;
+        }
+
+        // Сначала ближний потомок
+        int left = node.leftFirst, right = node.leftFirst + 1;
+        float tLeft, tRight;
+        bool hitLeft = hitNode(scene.nodes[left], origin, invD, tMin, t, tLeft);
+        bool hitRight = hitNode(scene.nodes[right], origin, invD, tMin, t, tRight);
+        if (hitLeft && hitRight) {
+            if (tLeft > tRight) {
+                int swap = left;
+                left = right;
+                right = swap;
+            }
+            stack[stackSize++] = right;
+            stack[stackSize++] = left;
+        } else if (hitLeft) {
+            stack[stackSize++] = left;
+        } else if (hitRight) {
+            stack[stackSize++] = right;
+        }
+    }
+    return primitive;
+}
+
+int occluded(const SimdSceneView& scene, const float origin[3], const float direction[3],
+             float tMin, float tMax)
+{
+    const float invD[3] = {1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2]};
+    const Vec3 o = {splat(origin[0]), splat(origin[1]), splat(origin[2])};
+    const Vec3 d = {splat(direction[0]), splat(direction[1]), splat(direction[2])};
+    const Vec3 inv = {splat(invD[0]), splat(invD[1]), splat(invD[2])};
+    const Vf tMinV = splat(tMin), tMaxV = splat(tMax);
+    const Vi lanes = laneIndex();
+
+    int stack[SIMD_BVH_STACK_SIZE];
+    int stackSize = 0;
+    float tNear;
+
+    if (!hitNode(scene.nodes[0], origin, invD, tMin, tMax, tNear)) return -1;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const SimdNode& node = scene.nodes[stack[--stackSize]];
+
+        if (node.count > 0) {
+            const SimdLeaf& leaf = scene.leaves[node.leftFirst];
+            Vf tHit;
+
+            for (int k = 0; k < leaf.triangleCount; k += SIMD_LANES) {
+                int first = leaf.triangleFirst + k;
+                Vi inLeaf = lanes < splatInt(leaf.triangleCount - k);
+                Vi hits = inLeaf & intersectTriangles(o, d, loadVec3(scene.v0, first), loadVec3(scene.e1, first),
+                                                      loadVec3(scene.e2, first), tMinV, tMaxV, tHit);
+                if (any(hits)) return firstHit(hits, scene.trianglePrimitive, first);
+            }
+            for (int k = 0; k < leaf.sphereCount; k += SIMD_LANES) {
+                int first = leaf.sphereFirst + k;
+                Vi inLeaf = lanes < splatInt(leaf.sphereCount - k);
+                Vi hits = inLeaf & intersectSpheres(o, d, loadVec3(scene.sphereCenter, first),
+                                                    load(scene.sphereRadius2 + first), tMinV, tMaxV, tHit);
+                if (any(hits)) return firstHit(hits, scene.spherePrimitive, first);
+            }
+            for (int k = 0; k < leaf.boxCount; k += SIMD_LANES) {
+                int first = leaf.boxFirst + k;
+                Vi inLeaf = lanes < splatInt(leaf.boxCount - k);
+                Vi hits = inLeaf & intersectBoxes(o, inv, loadVec3(scene.boxMin, first),
+                                                  loadVec3(scene.boxMax, first), tMinV, tMaxV, tHit);
+                if (any(hits)) return firstHit(hits, scene.boxPrimitive, first);
+            }
+            continue;
+        }
+
+        // Порядок потомков не важен: подойдет любое пересечение
+        const int left = node.leftFirst, right = node.leftFirst + 1;
+        if (hitNode(scene.nodes[right], origin, invD, tMin, tMax, tNear)) stack[stackSize++] = right;
+        if (hitNode(scene.nodes[left], origin, invD, tMin, tMax, tNear)) stack[stackSize++] = left;
+    }
+    return -1;
+}
+
+// Узел против всех лучей пакета: маска лучей и минимальное tNear среди них
+inline Vi hitNodePacket(const SimdNode& node, const Vec3& o, const Vec3& invD, Vf tMin, Vf tBest,
+                        Vi active, float& tNear)
+{
+    Vf t0 = tMin, t1 = tBest;
+    const Vf* oc[3] = {&o.x, &o.y, &o.z};
+    const Vf* ic[3] = {&invD.x, &invD.y, &invD.z};
+    for (int a = 0; a < 3; a++) {
+        Vf ta = (splat(node.min[a]) - *oc[a]) * *ic[a];
+        Vf tb = (splat(node.max[a]) - *oc[a]) * *ic[a];
+        t0 = vmax(t0, vmin(ta, tb));
+        t1 = vmin(t1, vmax(ta, tb));
+    }
+    Vi mask = active & (t0 <= t1);
+
+    tNear = 3.0e38f;
+    for (int i = 0; i < SIMD_LANES; i++) {
+        if (mask[i]) tNear = minf(tNear, t0[i]);
+    }
+    return mask;
+}
+
+void intersectPacket(const SimdSceneView& scene, SimdRayPacket& packet, float tMin)
+{
+    const Vec3 o = {load(packet.origin[0]), load(packet.origin[1]), load(packet.origin[2])};
+    const Vec3 d = {load(packet.direction[0]), load(packet.direction[1]), load(packet.direction[2])};
+    const Vec3 inv = {1.0f / d.x, 1.0f / d.y, 1.0f / d.z};
+    const Vi active = laneIndex() < splatInt(packet.count);
+    const Vf tMinV = splat(tMin);
+
+    Vf best = load(packet.t);
+    Vi primitive = splatInt(-1);
+
+    int stack[SIMD_BVH_STACK_SIZE];
+    int stackSize = 0;
+    float tNear;
+
+    if (any(hitNodePacket(scene.nodes[0], o, inv, tMinV, best, active, tNear))) {
+        stack[stackSize++] = 0;
+    }
+
+    while (stackSize > 0) {
+        const SimdNode& node = scene.nodes[stack[--stackSize]];
+
+        if (node.count > 0) {
+            const SimdLeaf& leaf = scene.leaves[node.leftFirst];
+            Vf tHit;
+
+            for (int k = leaf.triangleFirst; k < leaf.triangleFirst + leaf.triangleCount; k++) {
+                Vi hits = active & intersectTriangles(o, d, splatVec3(scene.v0, k), splatVec3(scene.e1, k),
+                                                      splatVec3(scene.e2, k), tMinV, best, tHit);
+                best = select(hits, tHit, best);
+                primitive = selectInt(hits, splatInt(scene.trianglePrimitive[k]), primitive);
+            }
+            for (int k = leaf.sphereFirst; k < leaf.sphereFirst + leaf.sphereCount; k++) {
+                Vi hits = active & intersectSpheres(o, d, splatVec3(scene.sphereCenter, k),
+                                                    splat(scene.sphereRadius2[k]), tMinV, best, tHit);
+                best = select(hits, tHit, best);
+                primitive = selectInt(hits, splatInt(scene.spherePrimitive[k]), primitive);
+            }
+            for (int k = leaf.boxFirst; k < leaf.boxFirst + leaf.boxCount; k++) {
+                Vi hits = active & intersectBoxes(o, inv, splatVec3(scene.boxMin, k), splatVec3(scene.boxMax, k),
+                                                  tMinV, best, tHit);
+                best = select(hits, tHit, best);
+                primitive = selectInt(hits, splatInt(scene.boxPrimitive[k]), primitive);
+            }
+            continue;
+        }
+
+        int left = node.leftFirst, right = node.leftFirst + 1;
+        float tLeft, tRight;
+        bool hitLeft = any(hitNodePacket(scene.nodes[left], o, inv, tMinV, best, active, tLeft));
+        bool hitRight = any(hitNodePacket(scene.nodes[right], o, inv, tMinV, best, active, tRight));
+        if (hitLeft && hitRight) {
+            if (tLeft > tRight) {
+                int swap = left;
+                left = right;
+                right = swap;
+            }
+            stack[stackSize++] = right;
+            stack[stackSize++] = left;
+        } else if (hitLeft) {
+            stack[stackSize++] = left;
+        } else if (hitRight) {
+            stack[stackSize++] = right;
+        }
+    }
+
+    store(packet.t, best);
+    storeInt(packet.primitive, primitive);
+}
+
+} // namespace
+
+const SimdKernels* SIMD_FACTORY()
+{
+    static const SimdKernels kernels = {SIMD_LEVEL, SIMD_NAME, SIMD_LANES, &intersect, &occluded, &intersectPacket};
+    return &kernels;
+}
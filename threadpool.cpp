@@ -0,0 +1,129 @@
+#include "threadpool.h"
+#include <algorithm>
+
+ThreadPool::ThreadPool(int threadCount)
+    : currentTask(nullptr),
+    generation(0),
+    activeWorkers(0),
+    stopping(false),
+    remaining(0),
+    steals(0)
+{
+    if (threadCount <= 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int i = 0; i < threadCount; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (int i = 1; i < threadCount; i++) {
+        threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t, int)>& task)
+{
+    if (count == 0) return;
+
+    const size_t workers = queues.size();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Соседние задачи (плитки) достаются одному потоку - лучше для кэша
+        for (size_t w = 0; w < workers; w++) {
+            std::lock_guard<std::mutex> queueLock(queues[w]->mutex);
+            for (size_t i = count * w / workers; i < count * (w + 1) / workers; i++) {
+                queues[w]->items.push_back(i);
+            }
+        }
+        remaining = count;
+        steals = 0;
+        currentTask = &task;
+        generation++;
+    }
+    wake.notify_all();
+
+    runTasks(0, task);
+
+    // Ждем не только задачи, но и выход потоков из runTasks: после
+    // возврата task может быть разрушена
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return remaining.load() == 0; });
+    currentTask = nullptr;
+    done.wait(lock, [this] { return activeWorkers == 0; });
+}
+
+void ThreadPool::workerLoop(int worker)
+{
+    unsigned seenGeneration = 0;
+    for (;;) {
+        const std::function<void(size_t, int)>* task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&] {
+                return stopping || (currentTask && generation != seenGeneration);
+            });
+            if (stopping) return;
+            seenGeneration = generation;
+            task = currentTask;
+            activeWorkers++;
+        }
+
+        runTasks(worker, *task);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            activeWorkers--;
+        }
+        done.notify_all();
+    }
+}
+
+void ThreadPool::runTasks(int worker, const std::function<void(size_t, int)>& task)
+{
+    size_t index;
+    while (takeTask(worker, index)) {
+        task(index, worker);
+        if (remaining.fetch_sub(1) == 1) {
+            std::lock_guard<std::mutex> lock(mutex);
+            done.notify_all();
+        }
+    }
+}
+
+bool ThreadPool::takeTask(int worker, size_t& index)
+{
+    {
+        Queue& own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.items.empty()) {
+            index = own.items.front();
+            own.items.pop_front();
+            return true;
+        }
+    }
+
+    // Своя очередь пуста - перехватываем с конца чужой
+    const size_t workers = queues.size();
+    for (size_t k = 1; k < workers; k++) {
+        Queue& victim = *queues[(worker + k) % workers];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.items.empty()) {
+            index = victim.items.back();
+            victim.items.pop_back();
+            steals++;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,62 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул потоков с перехватом задач (work stealing). Каждый поток получает
+// непрерывный диапазон задач в свою очередь и берет их с начала; закончив
+// свои, забирает задачи с конца чужих очередей. Вызывающий поток тоже
+// выполняет задачи (как поток 0)
+class ThreadPool
+{
+public:
+    // threadCount = 0 - по числу аппаратных потоков
+    explicit ThreadPool(int threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Потоков вместе с вызывающим
+    int threadCount() const { return int(queues.size()); }
+
+    // Выполняет task(index, worker) для каждого index из [0, count)
+    // и возвращает управление после завершения всех задач
+    void parallelFor(size_t count, const std::function<void(size_t, int)>& task);
+
+    // Сколько задач было перехвачено в последнем parallelFor
+    size_t lastStealCount() const { return steals.load(); }
+
+private:
+    struct alignas(64) Queue {
+        std::mutex mutex;
+        std::deque<size_t> items;
+    };
+
+    void workerLoop(int worker);
+    void runTasks(int worker, const std::function<void(size_t, int)>& task);
+    bool takeTask(int worker, size_t& index);
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(size_t, int)>* currentTask;
+    unsigned generation;
+    int activeWorkers;
+    bool stopping;
+    std::atomic<size_t> remaining;
+    std::atomic<size_t> steals;
+};
+
+#endif // THREADPOOL_H
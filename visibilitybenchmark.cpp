@@ -0,0 +1,119 @@
+#include "visibilitybenchmark.h"
+#include "mesh.h"
+#include "rasterizer.h"
+#include "rng.h"
+
+SoftwareFramebuffer::SoftwareFramebuffer(int width, int height)
+    : w(width), h(height),
+    depth(size_t(width) * height, 1.0f),
+    color(size_t(width) * height, 0)
+{
+}
+
+void SoftwareFramebuffer::clear()
+{
+    std::fill(depth.begin(), depth.end(), 1.0f);
+    std::fill(color.begin(), color.end(), 0);
+}
+
+void SoftwareFramebuffer::drawTriangle(const ViewTransform& view, const BspTriangle& t, bool depthTest)
+{
+    Point3D p[3];
+    for (int k = 0; k < 3; k++) {
+        Point3D ndc = view.toNdc(t.v[k]);
+        p[k] = Point3D((ndc.x + 1.0) * 0.5 * w, (ndc.y + 1.0) * 0.5 * h, ndc.z);
+    }
+
+    const unsigned int rgb = (unsigned(t.r * 255) << 16) | (unsigned(t.g * 255) << 8) | unsigned(t.b * 255);
+    int minX, minY, maxX, maxY;
+    rasterizeTriangle(p[0], p[1], p[2], w, h, minX, minY, maxX, maxY,
+                      [&](int x, int y, double z) {
+                          size_t i = size_t(y) * w + x;
+                          if (depthTest) {
+                              if (z >= depth[i]) return;
+                              depth[i] = float(z);
+                          }
+                          color[i] = rgb;
+                      });
+}
+
+namespace {
+
+Scene makePyramidScene(int count, double spread, uint64_t seed)
+{
+    Pcg32 rng = RandomStreams(seed).stream(RANDOM_STREAM_BENCHMARK);
+    auto uniform = [&](double from, double to) { return from + (to - from) * rng.nextDouble(); };
+
+    // Все пирамиды - экземпляры одной сетки, как в теме Z-буфера
+    Scene scene;
+    const int unit = scene.addMesh(makePyramidMesh(Point3D(0, 0, 0), 1.0));
+    scene.objects.reserve(count);
+    scene.materials.reserve(count);
+
+    for (int i = 0; i < count; i++) {
+        // Отдельные вызовы: порядок вычисления аргументов не определен
+        double x = uniform(-spread, spread), y = uniform(-spread, spread);
+        Point3D center(x, y, (i % 10) * 0.8);
+        double size = uniform(0.5, 1.5);
+        double r = uniform(0.2, 1.0), g = uniform(0.2, 1.0), b = uniform(0.2, 1.0);
+        int material = scene.addMaterial({Point3D(r, g, b), SceneMaterial::DIFFUSE, 1.0});
+        scene.addObject(SceneObject::MESH, unit, {center, size}, material);
+    }
+    return scene;
+}
+
+} // namespace
+
+std::vector<BenchmarkResult> runVisibilityBenchmark(const std::vector<int>& objectCounts)
+{
+    struct Overlap {
+        const char* name;
+        double spread;
+    };
+    const Overlap overlaps[] = {{"слабое перекрытие", 12.0}, {"сильное перекрытие", 3.0}};
+
+    const ViewTransform view = ViewTransform::fromAngles(15.0, 15.0, 1.0);
+    SoftwareFramebuffer framebuffer(256, 256);
+    std::vector<BenchmarkResult> results;
+
+    for (int count : objectCounts) {
+        for (const Overlap& overlap : overlaps) {
+            std::vector<BspTriangle> triangles = makeBspTriangles(makePyramidScene(count, overlap.spread, defaultRandomSeed + count));
+            const std::string params = std::to_string(count) + " пирамид, " + overlap.name;
+
+            double zbufferMs = measureMilliseconds([&] {
+                framebuffer.clear();
+                for (const auto& t : triangles) framebuffer.drawTriangle(view, t, true);
+            });
+            results.push_back({"Z-буфер", params, zbufferMs,
+                               triangles.size() / (zbufferMs / 1000.0), "треуг."});
+
+            BspTree tree;
+            bool built = false;
+            auto start = std::chrono::steady_clock::now();
+            built = tree.build(triangles);
+            double buildMs = std::chrono::duration<double, std::milli>(
+                                 std::chrono::steady_clock::now() - start).count();
+
+            if (!built) {
+                results.push_back({"BSP: построение", params + ", превышен лимит разрезов",
+                                   buildMs, 0, ""});
+                continue;
+            }
+            results.push_back({"BSP: построение",
+                               params + ", " + std::to_string(tree.triangleCount()) + " треуг. после разрезов",
+                               buildMs, 0, ""});
+
+            const Point3D viewDirection = view.viewDirection();
+            double bspMs = measureMilliseconds([&] {
+                framebuffer.clear();
+                tree.traverseBackToFront(viewDirection, [&](const BspTriangle& t) {
+                    framebuffer.drawTriangle(view, t, false);
+                });
+            });
+            results.push_back({"BSP: обход", params, bspMs,
+                               tree.triangleCount() / (bspMs / 1000.0), "треуг."});
+        }
+    }
+    return results;
+}
@@ -0,0 +1,31 @@
+#ifndef VISIBILITYBENCHMARK_H
+#define VISIBILITYBENCHMARK_H
+
+#include "benchmark.h"
+#include "bsptree.h"
+
+// Программная растеризация с буфером глубины и без него (для обхода BSP)
+class SoftwareFramebuffer
+{
+public:
+    SoftwareFramebuffer(int width, int height);
+
+    void clear();
+    // Треугольник в мировых координатах; depthTest = false - алгоритм художника
+    void drawTriangle(const ViewTransform& view, const BspTriangle& t, bool depthTest);
+
+    int width() const { return w; }
+    int height() const { return h; }
+    const std::vector<unsigned int>& colors() const { return color; }
+
+private:
+    int w, h;
+    std::vector<float> depth;
+    std::vector<unsigned int> color;
+};
+
+// Сравнение обхода BSP-дерева с Z-буфером для разного числа
+// пирамид и разной степени их перекрытия
+std::vector<BenchmarkResult> runVisibilityBenchmark(const std::vector<int>& objectCounts = {10, 100, 1000, 3000});
+
+#endif // VISIBILITYBENCHMARK_H